@@ -0,0 +1,1178 @@
+/*
+Мікробенчмарки бібліотеки фігур: розбір (MakeInstance, ShapeReader, ParallelLoader;
+  файл, де половина записів помилкові, - з винятками і через коди помилок),
+  копіювання (CopyInstance, Clone), операції LinkedList, збереження і друк (ShapeWriter
+  проти колишнього виведення iostream з std::endl після кожної фігури),
+  усі методи-характеристики і ті самі для StaticShapes (з перевіркою, що
+  результати збігаються біт у біт), addStatic, векторні ShapeBatch::compute у режимах REFERENCE
+  і EXACT проти FloatBatch::compute для кожного класу, пошук (findFirst_if проти ShapeQuery), інтернування
+  (ShapeInterner, PersistentList::dedupe), журнал змін CatalogLog і паралельний
+  контейнер ConcurrentList проти LinkedList під м'ютексом.
+  Щоб порівнювати випуски, результати виводяться у форматі JSON.
+
+Для кожного розміру каталогу (типово 1e3, 1e4, ... 1e8) генерується текстовий
+ файл у форматі MakeInstance з випадковими фігурами всіх шести класів (тим самим
+ зерном - ті самі фігури), з нього читаються фігури, і з них будується список.
+ Далі кожен бенчмарк виконується спочатку --warmup разів без обліку, потім
+ --reps разів з вимірюванням. Якщо бенчмарк працює довше за --max-time секунд,
+ повторення припиняються раніше, але хоч одне вимірювання буде завжди.
+
+Бенчмарки двох видів:
+ - масові обробляють увесь каталог за один прохід (операцій = розмір);
+ - точкові виконують кілька окремих операцій зі списком у випадкових позиціях
+   (addtoEnd, insert, getShape, remove - O(n) для LinkedList, O(log n) для
+   PersistentList, а також копіювання PersistentList); після вимірювання список
+   поза обліком часу повертається до початкового стану.
+ Для кожного бенчмарку наводяться мінімум, середнє, медіана, p90, p99 і максимум
+ часу однієї операції в наносекундах за всіма вимірюваннями.
+
+Бенчмарки, що пишуть на диск, наводять ще bytes_per_op - скільки байтів записано
+ на одну операцію. Для storeOn це байти на фігуру, тож одна зміна каталогу з
+ повним перезаписом коштує bytes_per_op * size байтів; для CatalogLog - байти
+ запису журналу (з fsync після кожної зміни або групами по 1024). Відтворення
+ журналу і завантаження знімка (CatalogLog recovery) показують час відновлення
+ на одну фігуру. Журнал пишеться в тимчасовий каталог поруч з файлом фігур.
+
+ParallelLoader працює на спільному ThreadPool з --threads потоків (типово - за
+ кількістю апаратних потоків); масштабування видно, якщо запустити бенчмарк
+ з --filter Loader і --threads 1, 2, 4, ... до кількості фізичних ядер.
+
+ConcurrentList вимірюється на 1, 2, 4, ... 64 потоках незалежно від --threads:
+ addtoEnd (фігури каталогу діляться між потоками порівну), forEach (кожен потік
+ обходить увесь контейнер) і завантаження разом з читанням (T потоків додають
+ фігури, ще T тим часом обходять контейнер; час - до кінця додавання). Останнє
+ порівнюється з LinkedList, захищеним одним м'ютексом. Бенчмарк "ConcurrentList
+ stress" ще й перевіряє, що кожен обхід бачить фігури кожного потоку в порядку
+ додавання і не бачить знищених; порушення потрапляє в результати як помилка.
+
+Каталог 1e8 фігур займає понад 10 ГБ пам'яті й кілька ГБ на диску; якщо пам'яті
+ забракне, в результатах з'явиться запис з помилкою, і більші розміри пропускаються.
+
+Використання:
+  Benchmarks [--sizes 1e3,1e4,...] [--max-size N] [--reps R] [--warmup W]
+             [--max-time S] [--filter текст] [--seed N] [--threads T] [--out файл]
+*/
+#include "../VolumeShapes/CatalogLog.h"
+#include "../VolumeShapes/ConcurrentList.h"
+#include "../VolumeShapes/PersistentList.h"
+#include "../VolumeShapes/ParallelLoader.h"
+#include "../VolumeShapes/ShapeQuery.h"
+#include "../VolumeShapes/ShapeReader.h"
+#include "../VolumeShapes/StaticShapes.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+double since(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// результати обчислень потрапляють сюди, щоб компілятор не викинув виклики
+volatile double sink;
+// скільки байтів записав на диск останній запуск бенчмарку; -1 - бенчмарк не пише
+double written;
+
+struct Options
+{
+	std::vector<size_t> sizes;
+	size_t maxSize;
+	int reps;
+	int warmup;
+	double maxTime;
+	std::string filter;
+	unsigned long long seed;
+	unsigned threads;
+	std::string out;
+	Options() : maxSize(0), reps(10), warmup(2), maxTime(10.), seed(20240601), threads(0), out()
+	{
+		for (size_t n = 1000; n <= 100000000; n *= 10) sizes.push_back(n);
+	}
+};
+
+// --------------------- каталог фігур одного розміру
+class Catalog
+{
+public:
+	size_t n;
+	std::string path;
+	std::vector<VolShape*> shapes;
+	LinkedList list;
+	PersistentList persistent;
+	ShapeBatch batch;
+	FloatBatch floats;
+	std::mt19937_64 rng;
+
+	Catalog(size_t size, unsigned long long seed);
+	~Catalog()
+	{
+		for (size_t i = 0; i < shapes.size(); ++i) delete shapes[i];
+		std::remove(path.c_str());
+	}
+	// випадкова позиція в [0, bound)
+	int position(size_t bound) { return static_cast<int>(rng() % bound); }
+private:
+	Catalog(const Catalog&);
+	Catalog& operator=(const Catalog&);
+};
+
+// число з двома знаками після крапки в межах [0.01, 99.99]; без std::uniform_*,
+// розподіли яких залежать від бібліотеки, тож каталог однаковий на всіх платформах
+double dimension(std::mt19937_64& rng)
+{
+	return (1 + rng() % 9999) / 100.;
+}
+
+Catalog::Catalog(size_t size, unsigned long long seed) : n(size), rng(seed)
+{
+	std::ostringstream name;
+	name << "volshapes-bench-" << size << ".txt";
+	path = (std::filesystem::temp_directory_path() / name.str()).string();
+	{
+		FILE* f = std::fopen(path.c_str(), "w");
+		if (f == nullptr) throw std::runtime_error("Error: Cannot create " + path + "\n");
+		for (size_t i = 0; i < n; ++i)
+		{
+			double h = dimension(rng), a = dimension(rng), b = dimension(rng);
+			int y = static_cast<int>(10 + rng() % 160);
+			switch (rng() % 6)
+			{
+			case 0: std::fprintf(f, "Cylinder %.2f %.2f\n", h, a); break;
+			case 1: std::fprintf(f, "Parallelepiped %.2f %.2f %.2f\n", h, a, b); break;
+			case 2: std::fprintf(f, "TriPrizm %.2f %.2f %.2f %d\n", h, a, b, y); break;
+			case 3: std::fprintf(f, "Conus %.2f %.2f\n", h, a); break;
+			case 4: std::fprintf(f, "RectPiramid %.2f %.2f %.2f\n", h, a, b); break;
+			default: std::fprintf(f, "TriPiramid %.2f %.2f %.2f %d\n", h, a, b, y); break;
+			}
+		}
+		std::fclose(f);
+	}
+	std::ifstream fin(path);
+	shapes.reserve(n);
+	for (size_t i = 0; i < n; ++i) shapes.push_back(VolShape::MakeInstance(fin));
+	// вставка на початок - O(1), тож список будується з кінця
+	for (size_t i = n; i-- > 0; ) list.insert(shapes[i], 0);
+	persistent = PersistentList(list);
+	batch.addAll(list);
+	floats.append(batch);
+}
+
+// --------------------- бенчмарки
+// кожен повертає виміряний час у наносекундах; підготовка і прибирання не враховуються
+enum Kind { BULK, POINT };
+
+struct Benchmark
+{
+	const char* name;
+	Kind kind;
+	double (*run)(Catalog& c, size_t ops);
+};
+
+double makeInstance(Catalog& c, size_t ops)
+{
+	std::vector<VolShape*> made;
+	made.reserve(ops);
+	std::ifstream fin(c.path);
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) made.push_back(VolShape::MakeInstance(fin));
+	double ns = since(start);
+	for (size_t i = 0; i < made.size(); ++i) delete made[i];
+	return ns;
+}
+
+double readerLoad(Catalog& c, size_t)
+{
+	ShapeVector loaded;
+	Clock::time_point start = Clock::now();
+	ShapeReader::load(c.path.c_str(), loaded);
+	return since(start);
+}
+
+// текст каталогу, в якому кожен другий запис має невідоме ім'я класу
+std::string dirtyText(const Catalog& c)
+{
+	std::ifstream fin(c.path, std::ios::binary);
+	std::string text((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+	size_t p = text.find('\n');
+	while (p != std::string::npos && p + 1 < text.size())
+	{
+		text[p + 1] = '_';
+		p = text.find('\n', p + 1);
+		if (p != std::string::npos) p = text.find('\n', p + 1);
+	}
+	return text;
+}
+
+// колишній шлях для брудних файлів: виняток на кожен помилковий запис
+double dirtyLoadExceptions(Catalog& c, size_t)
+{
+	const std::string text = dirtyText(c);
+	ShapeBatch loaded;
+	Clock::time_point start = Clock::now();
+	ShapeReader in(text.data(), text.data() + text.size());
+	ShapeRecord r;
+	for (;;)
+	{
+		try
+		{
+			if (!in.next(r)) break;
+			r.addTo(loaded);
+		}
+		catch (VolShape::BadClassname&)
+		{
+		}
+	}
+	return since(start);
+}
+
+double dirtyLoadChecked(Catalog& c, size_t)
+{
+	const std::string text = dirtyText(c);
+	ShapeBatch loaded;
+	Clock::time_point start = Clock::now();
+	ShapeReader::load(text.data(), text.data() + text.size(), loaded, ShapeReader::Options());
+	return since(start);
+}
+
+double parallelLoad(Catalog& c, size_t)
+{
+	ShapeVector loaded;
+	Clock::time_point start = Clock::now();
+	ParallelLoader().load(c.path.c_str(), loaded);
+	return since(start);
+}
+
+double copyInstance(Catalog& c, size_t ops)
+{
+	std::vector<VolShape*> made;
+	made.reserve(ops);
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) made.push_back(VolShape::CopyInstance(c.shapes[i]));
+	double ns = since(start);
+	for (size_t i = 0; i < made.size(); ++i) delete made[i];
+	return ns;
+}
+
+double clone(Catalog& c, size_t ops)
+{
+	std::vector<VolShape*> made;
+	made.reserve(ops);
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) made.push_back(c.shapes[i]->Clone());
+	double ns = since(start);
+	for (size_t i = 0; i < made.size(); ++i) delete made[i];
+	return ns;
+}
+
+template<double (VolShape::*M)() const> double metric(Catalog& c, size_t ops)
+{
+	double sum = 0;
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) sum += (c.shapes[i]->*M)();
+	double ns = since(start);
+	sink = sum;
+	return ns;
+}
+
+template<double (Shape::*M)() const> double baseMetric(Catalog& c, size_t ops)
+{
+	double sum = 0;
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) sum += (c.shapes[i]->getBase()->*M)();
+	double ns = since(start);
+	sink = sum;
+	return ns;
+}
+
+// повна поверхня фігур одного класу; час перераховується на всі ops фігур каталогу,
+// тож ns_per_op - час на одну фігуру цього класу
+template<ShapeBatch::Kind K, ShapeBatch::Precision P> double batchCompute(Catalog& c, size_t ops)
+{
+	const size_t count = c.batch.size(K);
+	if (count == 0) return 0;
+	std::vector<double> out(count);
+	Clock::time_point start = Clock::now();
+	c.batch.compute(ShapeBatch::SURFACE_AREA, K, out.data(), P);
+	double ns = since(start);
+	sink = out[count - 1];
+	return ns * ops / count;
+}
+
+// ті самі фігури каталогу як StaticShapes: шість векторів за класами, а поруч - відповідні фігури VolShape
+struct StaticCatalog
+{
+	std::vector<StaticCylinder> cylinders;
+	std::vector<StaticParallelepiped> parallelepipeds;
+	std::vector<StaticTriPrizm> triPrizms;
+	std::vector<StaticConus> coni;
+	std::vector<StaticRectPiramid> rectPiramids;
+	std::vector<StaticTriPiramid> triPiramids;
+	std::vector<const VolShape*> dynamic[ShapeBatch::KIND_COUNT];
+
+	StaticCatalog(const Catalog& c, size_t ops)
+	{
+		for (size_t i = 0; i < ops; ++i)
+		{
+			const ShapeRecord r = ShapeRecord::of(*c.shapes[i]);
+			switch (r.kind)
+			{
+			case ShapeBatch::CYLINDER:       cylinders.emplace_back(r.h, r.a); break;
+			case ShapeBatch::PARALLELEPIPED: parallelepipeds.emplace_back(r.h, r.a, r.b); break;
+			case ShapeBatch::TRIPRIZM:       triPrizms.emplace_back(r.h, r.a, r.b, r.angle); break;
+			case ShapeBatch::CONUS:          coni.emplace_back(r.h, r.a); break;
+			case ShapeBatch::RECTPIRAMID:    rectPiramids.emplace_back(r.h, r.a, r.b); break;
+			default:                         triPiramids.emplace_back(r.h, r.a, r.b, r.angle); break;
+			}
+			dynamic[r.kind].push_back(c.shapes[i]);
+		}
+	}
+};
+
+// характеристика M (0 - об'єм, 1 - повна поверхня) статичної чи звичайної фігури
+template<int M, class S> double staticMetricOf(const S& s) { return M == 0 ? s.volume() : s.surfaceArea(); }
+
+template<int M, class S> double staticSum(const std::vector<S>& shapes)
+{
+	double sum = 0;
+	for (size_t i = 0; i < shapes.size(); ++i) sum += staticMetricOf<M>(shapes[i]);
+	return sum;
+}
+
+// StaticShapes обіцяють ті самі біти, що й віртуальні методи; звірка - поза обліком часу
+template<int M, class S> void staticCheck(const std::vector<S>& shapes, const std::vector<const VolShape*>& dynamic)
+{
+	for (size_t i = 0; i < shapes.size(); ++i)
+		if (staticMetricOf<M>(shapes[i]) != staticMetricOf<M>(*dynamic[i]))
+			throw std::logic_error("Error: StaticShapes differ from the virtual methods\n");
+}
+
+// пара до VolShape::volume і VolShape::surfaceArea: ті самі фігури без віртуальних викликів
+template<int M> double staticMetric(Catalog& c, size_t ops)
+{
+	const StaticCatalog s(c, ops);
+	Clock::time_point start = Clock::now();
+	double sum = staticSum<M>(s.cylinders) + staticSum<M>(s.parallelepipeds) + staticSum<M>(s.triPrizms)
+		+ staticSum<M>(s.coni) + staticSum<M>(s.rectPiramids) + staticSum<M>(s.triPiramids);
+	double ns = since(start);
+	sink = sum;
+	staticCheck<M>(s.cylinders, s.dynamic[ShapeBatch::CYLINDER]);
+	staticCheck<M>(s.parallelepipeds, s.dynamic[ShapeBatch::PARALLELEPIPED]);
+	staticCheck<M>(s.triPrizms, s.dynamic[ShapeBatch::TRIPRIZM]);
+	staticCheck<M>(s.coni, s.dynamic[ShapeBatch::CONUS]);
+	staticCheck<M>(s.rectPiramids, s.dynamic[ShapeBatch::RECTPIRAMID]);
+	staticCheck<M>(s.triPiramids, s.dynamic[ShapeBatch::TRIPIRAMID]);
+	return ns;
+}
+
+// addStatic у ShapeVector: фігури будуються прямо в комірках вектора
+double staticAddToVector(Catalog& c, size_t ops)
+{
+	const StaticCatalog s(c, ops);
+	ShapeVector v;
+	v.reserve(ops);
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < s.cylinders.size(); ++i) addStatic(v, s.cylinders[i]);
+	for (size_t i = 0; i < s.parallelepipeds.size(); ++i) addStatic(v, s.parallelepipeds[i]);
+	for (size_t i = 0; i < s.triPrizms.size(); ++i) addStatic(v, s.triPrizms[i]);
+	for (size_t i = 0; i < s.coni.size(); ++i) addStatic(v, s.coni[i]);
+	for (size_t i = 0; i < s.rectPiramids.size(); ++i) addStatic(v, s.rectPiramids[i]);
+	for (size_t i = 0; i < s.triPiramids.size(); ++i) addStatic(v, s.triPiramids[i]);
+	return since(start);
+}
+
+template<ShapeBatch::Kind K> double floatCompute(Catalog& c, size_t ops)
+{
+	const size_t count = c.floats.size(K);
+	if (count == 0) return 0;
+	std::vector<float> out(count);
+	Clock::time_point start = Clock::now();
+	c.floats.compute(ShapeBatch::SURFACE_AREA, K, out.data());
+	double ns = since(start);
+	sink = out[count - 1];
+	return ns * ops / count;
+}
+
+double listAddToEnd(Catalog& c, size_t ops)
+{
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) c.list.addtoEnd(c.shapes[i]);
+	double ns = since(start);
+	for (size_t i = 0; i < ops; ++i) c.list.remove(static_cast<int>(c.n));
+	return ns;
+}
+
+double listInsert(Catalog& c, size_t ops)
+{
+	std::vector<int> at(ops);
+	for (size_t i = 0; i < ops; ++i) at[i] = c.position(c.n + i + 1);
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) c.list.insert(c.shapes[i], at[i]);
+	double ns = since(start);
+	// вилучення у зворотному порядку повертає список до початкового
+	for (size_t i = ops; i-- > 0; ) c.list.remove(at[i]);
+	return ns;
+}
+
+double listGetShape(Catalog& c, size_t ops)
+{
+	std::vector<int> at(ops);
+	for (size_t i = 0; i < ops; ++i) at[i] = c.position(c.n);
+	double sum = 0;
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) sum += c.list.getShape(at[i]).high();
+	double ns = since(start);
+	sink = sum;
+	return ns;
+}
+
+double listRemove(Catalog& c, size_t ops)
+{
+	// позиції за спаданням: вилучення не зсуває ще не вилучених, тож на позиції
+	// at[i] стоїть копія shapes[at[i]], і вставка за зростанням відновлює список
+	std::vector<int> at(ops);
+	for (size_t i = 0; i < ops; ++i) at[i] = c.position(c.n);
+	std::sort(at.begin(), at.end());
+	at.erase(std::unique(at.begin(), at.end()), at.end());
+	Clock::time_point start = Clock::now();
+	for (size_t i = at.size(); i-- > 0; ) c.list.remove(at[i]);
+	double ns = since(start);
+	for (size_t i = 0; i < at.size(); ++i) c.list.insert(c.shapes[at[i]], at[i]);
+	// повторені позиції трапляються рідко; час перераховується на повну кількість операцій
+	return ns * ops / at.size();
+}
+
+double listCopy(Catalog& c, size_t)
+{
+	Clock::time_point start = Clock::now();
+	LinkedList* copy = new LinkedList(c.list);
+	double ns = since(start);
+	delete copy;
+	return ns;
+}
+
+double listStoreOn(Catalog& c, size_t)
+{
+	std::string target = c.path + ".out";
+	double ns;
+	{
+		std::ofstream fout(target);
+		Clock::time_point start = Clock::now();
+		c.list.storeOn(fout);
+		fout.flush();
+		ns = since(start);
+	}
+	written = static_cast<double>(std::filesystem::file_size(target));
+	std::remove(target.c_str());
+	return ns;
+}
+
+// колишній LinkedList::storeOn: storeOn кожної фігури і std::endl - для порівняння з ShapeWriter
+double iostreamStoreOn(Catalog& c, size_t)
+{
+	std::string target = c.path + ".out";
+	double ns;
+	{
+		std::ofstream fout(target);
+		Clock::time_point start = Clock::now();
+		for (const LinkedList::Node* curr = c.list.first(); curr != nullptr; curr = curr->next)
+		{
+			curr->data->storeOn(fout);
+			fout << std::endl;
+		}
+		fout.flush();
+		ns = since(start);
+	}
+	written = static_cast<double>(std::filesystem::file_size(target));
+	std::remove(target.c_str());
+	return ns;
+}
+
+double persistentAddToEnd(Catalog& c, size_t ops)
+{
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) c.persistent.addtoEnd(c.shapes[i]);
+	double ns = since(start);
+	for (size_t i = 0; i < ops; ++i) c.persistent.remove(static_cast<int>(c.n));
+	return ns;
+}
+
+double persistentInsert(Catalog& c, size_t ops)
+{
+	std::vector<int> at(ops);
+	for (size_t i = 0; i < ops; ++i) at[i] = c.position(c.n + i + 1);
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) c.persistent.insert(c.shapes[i], at[i]);
+	double ns = since(start);
+	for (size_t i = ops; i-- > 0; ) c.persistent.remove(at[i]);
+	return ns;
+}
+
+double persistentGetShape(Catalog& c, size_t ops)
+{
+	std::vector<int> at(ops);
+	for (size_t i = 0; i < ops; ++i) at[i] = c.position(c.n);
+	double sum = 0;
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) sum += c.persistent.getShape(at[i]).high();
+	double ns = since(start);
+	sink = sum;
+	return ns;
+}
+
+double persistentRemove(Catalog& c, size_t ops)
+{
+	// як і для LinkedList: вилучення за спаданням позицій, відновлення - за зростанням
+	std::vector<int> at(ops);
+	for (size_t i = 0; i < ops; ++i) at[i] = c.position(c.n);
+	std::sort(at.begin(), at.end());
+	at.erase(std::unique(at.begin(), at.end()), at.end());
+	Clock::time_point start = Clock::now();
+	for (size_t i = at.size(); i-- > 0; ) c.persistent.remove(at[i]);
+	double ns = since(start);
+	for (size_t i = 0; i < at.size(); ++i) c.persistent.insert(c.shapes[at[i]], at[i]);
+	return ns * ops / at.size();
+}
+
+// умова, якій не відповідає жодна фігура: обидва пошуки переглядають увесь каталог
+bool hollow(VolShape* v)
+{
+	return v->volume() < 0;
+}
+
+double listFindFirst(Catalog& c, size_t)
+{
+	Clock::time_point start = Clock::now();
+	const LinkedList::Node* found = c.list.findFirst_if(hollow);
+	double ns = since(start);
+	sink = found != nullptr;
+	return ns;
+}
+
+double queryCount(Catalog& c, size_t)
+{
+	Clock::time_point start = Clock::now();
+	ShapeQuery q(c.batch);
+	size_t found = q.where(ShapeQuery::column(ShapeQuery::VOLUME) < 0.).count();
+	double ns = since(start);
+	sink = static_cast<double>(found);
+	return ns;
+}
+
+double queryTop(Catalog& c, size_t)
+{
+	Clock::time_point start = Clock::now();
+	ShapeQuery q(c.batch);
+	std::vector<ShapeQuery::Row> found = q.top(ShapeQuery::SURFACE_AREA, 100);
+	double ns = since(start);
+	sink = static_cast<double>(found.size());
+	return ns;
+}
+
+double persistentCopy(Catalog& c, size_t ops)
+{
+	std::vector<PersistentList> copies;
+	copies.reserve(ops);
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < ops; ++i) copies.push_back(c.persistent);
+	return since(start);
+}
+
+double internShapes(Catalog& c, size_t)
+{
+	ShapeInterner interner;
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < c.shapes.size(); ++i) interner.intern(*c.shapes[i]);
+	return since(start);
+}
+
+double persistentDedupe(Catalog& c, size_t)
+{
+	// фігури каталогу майже всі різні, тож вимірюється переважно пошук; список
+	// після dedupe рівний початковому
+	Clock::time_point start = Clock::now();
+	c.persistent.dedupe();
+	return since(start);
+}
+
+// файли журналу CatalogLog з іменем c.path + ".wal"
+std::string logPath(const Catalog& c)
+{
+	return c.path + ".wal";
+}
+
+void dropLog(const Catalog& c)
+{
+	const std::filesystem::path path = logPath(c);
+	const std::string prefix = path.filename().string();
+	std::vector<std::filesystem::path> files;
+	for (const auto& e : std::filesystem::directory_iterator(path.parent_path()))
+		if (e.path().filename().string().compare(0, prefix.size(), prefix) == 0) files.push_back(e.path());
+	for (size_t i = 0; i < files.size(); ++i) std::filesystem::remove(files[i]);
+}
+
+// журнал з усіма фігурами каталогу, записаний без fsync; compacted - ще й стиснений у знімок
+void writeLog(Catalog& c, bool compacted)
+{
+	dropLog(c);
+	ShapeVector shapes;
+	CatalogLog::Options o;
+	o.sync = false;
+	CatalogLog log(logPath(c).c_str(), shapes, o);
+	for (size_t i = 0; i < c.shapes.size(); ++i) log.addtoEnd(*c.shapes[i]);
+	log.commit();
+	if (compacted)
+	{
+		log.compact();
+		log.waitCompaction();
+	}
+}
+
+// кожна фігура дописується в журнал порожнього каталогу; groupRecords = 1 - fsync після кожної
+double logAddToEnd(Catalog& c, size_t ops, size_t groupRecords)
+{
+	dropLog(c);
+	double ns;
+	{
+		ShapeVector shapes;
+		CatalogLog::Options o;
+		o.groupRecords = groupRecords;
+		CatalogLog log(logPath(c).c_str(), shapes, o);
+		const uint64_t before = log.stats().logBytes;
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < ops; ++i) log.addtoEnd(*c.shapes[i]);
+		log.commit();
+		ns = since(start);
+		written = static_cast<double>(log.stats().logBytes - before);
+	}
+	dropLog(c);
+	return ns;
+}
+
+double logAddToEndSynced(Catalog& c, size_t ops)
+{
+	return logAddToEnd(c, ops, 1);
+}
+
+double logAddToEndGrouped(Catalog& c, size_t ops)
+{
+	return logAddToEnd(c, ops, CatalogLog::Options().groupRecords);
+}
+
+double logCompact(Catalog& c, size_t)
+{
+	writeLog(c, false);
+	double ns;
+	{
+		ShapeVector shapes;
+		CatalogLog log(logPath(c).c_str(), shapes);
+		Clock::time_point start = Clock::now();
+		log.compact();
+		log.waitCompaction();
+		ns = since(start);
+		written = static_cast<double>(log.stats().snapshotBytes);
+	}
+	dropLog(c);
+	return ns;
+}
+
+double logRecover(Catalog& c, bool compacted)
+{
+	writeLog(c, compacted);
+	double ns;
+	{
+		ShapeVector shapes;
+		Clock::time_point start = Clock::now();
+		CatalogLog log(logPath(c).c_str(), shapes);
+		ns = since(start);
+		sink = static_cast<double>(shapes.size());
+	}
+	dropLog(c);
+	return ns;
+}
+
+double logReplay(Catalog& c, size_t)
+{
+	return logRecover(c, false);
+}
+
+double logLoadSnapshot(Catalog& c, size_t)
+{
+	return logRecover(c, true);
+}
+
+// --------------------- ConcurrentList
+// запускає body(t) на T потоках і чекає на всі
+template<class F> void onThreads(unsigned T, F body)
+{
+	std::vector<std::thread> threads;
+	threads.reserve(T);
+	for (unsigned t = 0; t < T; ++t) threads.emplace_back(body, t);
+	for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+}
+
+// фігури каталогу, які додає потік t з T: t, t + T, t + 2T, ...
+template<unsigned T> double concurrentAddToEnd(Catalog& c, size_t ops)
+{
+	ConcurrentList* list = new ConcurrentList;
+	Clock::time_point start = Clock::now();
+	onThreads(T, [&](unsigned t) { for (size_t i = t; i < ops; i += T) list->addtoEnd(c.shapes[i]); });
+	double ns = since(start);
+	delete list;
+	return ns;
+}
+
+template<unsigned T> double concurrentForEach(Catalog& c, size_t)
+{
+	ConcurrentList list;
+	for (size_t i = 0; i < c.shapes.size(); ++i) list.addtoEnd(c.shapes[i]);
+	std::vector<double> sums(T);
+	Clock::time_point start = Clock::now();
+	onThreads(T, [&](unsigned t) { list.forEach([&](const VolShape& v) { sums[t] += v.high(); }); });
+	double ns = since(start);
+	sink = sums[0];
+	// час перераховується на одну фігуру одного обходу
+	return ns / T;
+}
+
+// T потоків додають фігури, ще T поки що обходять контейнер
+template<unsigned T> double concurrentLoadRead(Catalog& c, size_t ops)
+{
+	ConcurrentList* list = new ConcurrentList;
+	std::atomic<unsigned> loading(T);
+	std::vector<double> sums(T);
+	Clock::time_point start = Clock::now();
+	onThreads(2 * T, [&](unsigned t)
+	{
+		if (t < T)
+		{
+			for (size_t i = t; i < ops; i += T) list->addtoEnd(c.shapes[i]);
+			--loading;
+		}
+		else while (loading != 0) list->forEach([&](const VolShape& v) { sums[t - T] += v.high(); });
+	});
+	double ns = since(start);
+	sink = sums[0];
+	delete list;
+	return ns;
+}
+
+// те саме з LinkedList під одним м'ютексом: вставка на початок - O(1), обхід - ForEach
+template<unsigned T> double mutexLoadRead(Catalog& c, size_t ops)
+{
+	LinkedList* list = new LinkedList;
+	std::mutex lock;
+	std::atomic<unsigned> loading(T);
+	std::vector<double> sums(T);
+	Clock::time_point start = Clock::now();
+	onThreads(2 * T, [&](unsigned t)
+	{
+		if (t < T)
+		{
+			for (size_t i = t; i < ops; i += T)
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				list->insert(c.shapes[i], 0);
+			}
+			--loading;
+		}
+		else while (loading != 0)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			for (const LinkedList::Node* curr = list->first(); curr != nullptr; curr = curr->next)
+				sums[t - T] += curr->data->high();
+		}
+	});
+	double ns = since(start);
+	sink = sums[0];
+	delete list;
+	return ns;
+}
+
+// T потоків додають циліндри з висотою - номером потоку і радіусом - номером по
+// порядку; T потоків обходять контейнер, перевіряють, що радіуси кожного потоку
+// зростають, і вилучають випадкові фігури
+template<unsigned T> double concurrentStress(Catalog& c, size_t ops)
+{
+	ConcurrentList* list = new ConcurrentList;
+	std::atomic<unsigned> loading(T);
+	std::atomic<size_t> broken(0), removed(0);
+	Clock::time_point start = Clock::now();
+	onThreads(2 * T, [&](unsigned t)
+	{
+		if (t < T)
+		{
+			for (size_t i = t; i < ops; i += T)
+				list->addtoEnd(std::unique_ptr<VolShape>(new Cylinder(t, static_cast<double>(i + 1))));
+			--loading;
+			return;
+		}
+		std::mt19937_64 rng(c.n + t);
+		while (loading != 0)
+		{
+			ConcurrentList::Reader view(*list);
+			std::vector<double> last(T, 0.);
+			for (size_t i = 0; i < view.size(); ++i)
+			{
+				const VolShape* v = view[i];
+				if (v == nullptr) continue;
+				const unsigned from = static_cast<unsigned>(v->high());
+				const double r = static_cast<const Circle*>(v->getBase())->radius();
+				if (from >= T || r <= last[from]) ++broken;
+				else last[from] = r;
+			}
+			for (int k = 0; k < 16 && view.size() != 0; ++k)
+				if (list->remove(static_cast<size_t>(rng() % view.size()))) ++removed;
+		}
+	});
+	double ns = since(start);
+	size_t live = 0;
+	list->forEach([&](const VolShape&) { ++live; });
+	const bool lost = list->extent() != ops || live + removed != ops || list->size() != live;
+	delete list;
+	Epoch::flush();
+	if (broken != 0 || lost) throw std::logic_error("Error: ConcurrentList stress found an inconsistent view\n");
+	return ns;
+}
+
+// потік, що нічого не записує: вимірюється форматування, а не консоль
+class NullBuffer : public std::streambuf
+{
+protected:
+	virtual int overflow(int c) override { return c; }
+	virtual std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+double listPrintAll(Catalog& c, size_t)
+{
+	NullBuffer null;
+	std::streambuf* console = std::cout.rdbuf(&null);
+	Clock::time_point start = Clock::now();
+	c.list.printAll();
+	double ns = since(start);
+	std::cout.rdbuf(console);
+	return ns;
+}
+
+// колишній LinkedList::printAll: operator<< кожної фігури і std::endl
+double iostreamPrintAll(Catalog& c, size_t)
+{
+	NullBuffer null;
+	std::streambuf* console = std::cout.rdbuf(&null);
+	Clock::time_point start = Clock::now();
+	for (const LinkedList::Node* curr = c.list.first(); curr != nullptr; curr = curr->next)
+	{
+		std::cout << *curr->data << " ";
+		std::cout << std::endl;
+	}
+	double ns = since(start);
+	std::cout.rdbuf(console);
+	return ns;
+}
+
+const Benchmark benchmarks[] =
+{
+	{ "VolShape::MakeInstance", BULK, makeInstance },
+	{ "ShapeReader::load", BULK, readerLoad },
+	{ "ShapeReader::next (half bad, exceptions)", BULK, dirtyLoadExceptions },
+	{ "ShapeReader::load (half bad, error codes)", BULK, dirtyLoadChecked },
+	{ "ParallelLoader::load", BULK, parallelLoad },
+	{ "VolShape::CopyInstance", BULK, copyInstance },
+	{ "VolShape::Clone", BULK, clone },
+	{ "VolShape::baseArea", BULK, metric<&VolShape::baseArea> },
+	{ "VolShape::sideArea", BULK, metric<&VolShape::sideArea> },
+	{ "VolShape::surfaceArea", BULK, metric<&VolShape::surfaceArea> },
+	{ "VolShape::volume", BULK, metric<&VolShape::volume> },
+	{ "StaticShapes volume", BULK, staticMetric<0> },
+	{ "StaticShapes surfaceArea", BULK, staticMetric<1> },
+	{ "addStatic (ShapeVector)", BULK, staticAddToVector },
+	{ "Shape::area", BULK, baseMetric<&Shape::area> },
+	{ "Shape::perim", BULK, baseMetric<&Shape::perim> },
+	{ "ShapeBatch::compute (Cylinder, reference)", BULK, batchCompute<ShapeBatch::CYLINDER, ShapeBatch::REFERENCE> },
+	{ "ShapeBatch::compute (Cylinder, exact)", BULK, batchCompute<ShapeBatch::CYLINDER, ShapeBatch::EXACT> },
+	{ "FloatBatch::compute (Cylinder)", BULK, floatCompute<ShapeBatch::CYLINDER> },
+	{ "ShapeBatch::compute (Parallelepiped, reference)", BULK, batchCompute<ShapeBatch::PARALLELEPIPED, ShapeBatch::REFERENCE> },
+	{ "ShapeBatch::compute (Parallelepiped, exact)", BULK, batchCompute<ShapeBatch::PARALLELEPIPED, ShapeBatch::EXACT> },
+	{ "FloatBatch::compute (Parallelepiped)", BULK, floatCompute<ShapeBatch::PARALLELEPIPED> },
+	{ "ShapeBatch::compute (TriPrizm, reference)", BULK, batchCompute<ShapeBatch::TRIPRIZM, ShapeBatch::REFERENCE> },
+	{ "ShapeBatch::compute (TriPrizm, exact)", BULK, batchCompute<ShapeBatch::TRIPRIZM, ShapeBatch::EXACT> },
+	{ "FloatBatch::compute (TriPrizm)", BULK, floatCompute<ShapeBatch::TRIPRIZM> },
+	{ "ShapeBatch::compute (Conus, reference)", BULK, batchCompute<ShapeBatch::CONUS, ShapeBatch::REFERENCE> },
+	{ "ShapeBatch::compute (Conus, exact)", BULK, batchCompute<ShapeBatch::CONUS, ShapeBatch::EXACT> },
+	{ "FloatBatch::compute (Conus)", BULK, floatCompute<ShapeBatch::CONUS> },
+	{ "ShapeBatch::compute (RectPiramid, reference)", BULK, batchCompute<ShapeBatch::RECTPIRAMID, ShapeBatch::REFERENCE> },
+	{ "ShapeBatch::compute (RectPiramid, exact)", BULK, batchCompute<ShapeBatch::RECTPIRAMID, ShapeBatch::EXACT> },
+	{ "FloatBatch::compute (RectPiramid)", BULK, floatCompute<ShapeBatch::RECTPIRAMID> },
+	{ "ShapeBatch::compute (TriPiramid, reference)", BULK, batchCompute<ShapeBatch::TRIPIRAMID, ShapeBatch::REFERENCE> },
+	{ "ShapeBatch::compute (TriPiramid, exact)", BULK, batchCompute<ShapeBatch::TRIPIRAMID, ShapeBatch::EXACT> },
+	{ "FloatBatch::compute (TriPiramid)", BULK, floatCompute<ShapeBatch::TRIPIRAMID> },
+	{ "LinkedList::addtoEnd", POINT, listAddToEnd },
+	{ "LinkedList::insert", POINT, listInsert },
+	{ "LinkedList::getShape", POINT, listGetShape },
+	{ "LinkedList::remove", POINT, listRemove },
+	{ "LinkedList::LinkedList(const LinkedList&)", BULK, listCopy },
+	{ "LinkedList::findFirst_if", BULK, listFindFirst },
+	{ "ShapeQuery::count", BULK, queryCount },
+	{ "ShapeQuery::top", BULK, queryTop },
+	{ "LinkedList::storeOn", BULK, listStoreOn },
+	{ "LinkedList::printAll", BULK, listPrintAll },
+	{ "LinkedList::storeOn (iostream, std::endl)", BULK, iostreamStoreOn },
+	{ "LinkedList::printAll (iostream, std::endl)", BULK, iostreamPrintAll },
+	{ "PersistentList::addtoEnd", POINT, persistentAddToEnd },
+	{ "PersistentList::insert", POINT, persistentInsert },
+	{ "PersistentList::getShape", POINT, persistentGetShape },
+	{ "PersistentList::remove", POINT, persistentRemove },
+	{ "PersistentList::PersistentList(const PersistentList&)", POINT, persistentCopy },
+	{ "ShapeInterner::intern", BULK, internShapes },
+	{ "PersistentList::dedupe", BULK, persistentDedupe },
+	{ "CatalogLog::addtoEnd (fsync per op)", POINT, logAddToEndSynced },
+	{ "CatalogLog::addtoEnd (group commit)", BULK, logAddToEndGrouped },
+	{ "CatalogLog::compact", BULK, logCompact },
+	{ "CatalogLog recovery (log replay)", BULK, logReplay },
+	{ "CatalogLog recovery (snapshot)", BULK, logLoadSnapshot },
+	{ "ConcurrentList::addtoEnd (1 thread)", BULK, concurrentAddToEnd<1> },
+	{ "ConcurrentList::addtoEnd (2 threads)", BULK, concurrentAddToEnd<2> },
+	{ "ConcurrentList::addtoEnd (4 threads)", BULK, concurrentAddToEnd<4> },
+	{ "ConcurrentList::addtoEnd (8 threads)", BULK, concurrentAddToEnd<8> },
+	{ "ConcurrentList::addtoEnd (16 threads)", BULK, concurrentAddToEnd<16> },
+	{ "ConcurrentList::addtoEnd (32 threads)", BULK, concurrentAddToEnd<32> },
+	{ "ConcurrentList::addtoEnd (64 threads)", BULK, concurrentAddToEnd<64> },
+	{ "ConcurrentList::forEach (1 thread)", BULK, concurrentForEach<1> },
+	{ "ConcurrentList::forEach (2 threads)", BULK, concurrentForEach<2> },
+	{ "ConcurrentList::forEach (4 threads)", BULK, concurrentForEach<4> },
+	{ "ConcurrentList::forEach (8 threads)", BULK, concurrentForEach<8> },
+	{ "ConcurrentList::forEach (16 threads)", BULK, concurrentForEach<16> },
+	{ "ConcurrentList::forEach (32 threads)", BULK, concurrentForEach<32> },
+	{ "ConcurrentList::forEach (64 threads)", BULK, concurrentForEach<64> },
+	{ "ConcurrentList load + forEach (1+1 threads)", BULK, concurrentLoadRead<1> },
+	{ "ConcurrentList load + forEach (2+2 threads)", BULK, concurrentLoadRead<2> },
+	{ "ConcurrentList load + forEach (4+4 threads)", BULK, concurrentLoadRead<4> },
+	{ "ConcurrentList load + forEach (8+8 threads)", BULK, concurrentLoadRead<8> },
+	{ "ConcurrentList load + forEach (16+16 threads)", BULK, concurrentLoadRead<16> },
+	{ "ConcurrentList load + forEach (32+32 threads)", BULK, concurrentLoadRead<32> },
+	{ "ConcurrentList load + forEach (64+64 threads)", BULK, concurrentLoadRead<64> },
+	{ "LinkedList + mutex load + ForEach (1+1 threads)", BULK, mutexLoadRead<1> },
+	{ "LinkedList + mutex load + ForEach (2+2 threads)", BULK, mutexLoadRead<2> },
+	{ "LinkedList + mutex load + ForEach (4+4 threads)", BULK, mutexLoadRead<4> },
+	{ "LinkedList + mutex load + ForEach (8+8 threads)", BULK, mutexLoadRead<8> },
+	{ "LinkedList + mutex load + ForEach (16+16 threads)", BULK, mutexLoadRead<16> },
+	{ "LinkedList + mutex load + ForEach (32+32 threads)", BULK, mutexLoadRead<32> },
+	{ "LinkedList + mutex load + ForEach (64+64 threads)", BULK, mutexLoadRead<64> },
+	{ "ConcurrentList stress (8+8 threads)", BULK, concurrentStress<8> },
+};
+
+// точкових операцій в одному вимірюванні тим більше, чим менший список,
+// щоб вимірювання не було коротшим за точність годинника
+size_t pointOps(size_t n)
+{
+	return std::max<size_t>(1, std::min<size_t>(1000, 100000 / n));
+}
+
+// --------------------- статистика і JSON
+struct Summary
+{
+	double min, mean, p50, p90, p99, max;
+};
+
+// перцентиль за найближчим рангом
+double percentile(const std::vector<double>& sorted, double p)
+{
+	size_t rank = static_cast<size_t>(p / 100. * sorted.size() + 0.999999);
+	return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+Summary summarize(std::vector<double> perOp)
+{
+	std::sort(perOp.begin(), perOp.end());
+	double sum = 0;
+	for (size_t i = 0; i < perOp.size(); ++i) sum += perOp[i];
+	Summary s = { perOp.front(), sum / perOp.size(), percentile(perOp, 50), percentile(perOp, 90),
+		percentile(perOp, 99), perOp.back() };
+	return s;
+}
+
+std::string quoted(const std::string& text)
+{
+	std::string q = "\"";
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		if (text[i] == '"' || text[i] == '\\') q += '\\';
+		q += text[i];
+	}
+	return q + '"';
+}
+
+class Report
+{
+	std::ostream& os;
+	bool first;
+public:
+	Report(std::ostream& out, const Options& opt) : os(out), first(true)
+	{
+		char date[32];
+		std::time_t now = std::time(nullptr);
+		std::strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+#if defined(__VERSION__)
+		std::string compiler = __VERSION__;
+#elif defined(_MSC_VER)
+		std::string compiler = "MSVC " + std::to_string(_MSC_VER);
+#else
+		std::string compiler = "unknown";
+#endif
+#ifdef SHAPES_CACHE_METRICS
+		const char* cache = "true";
+#else
+		const char* cache = "false";
+#endif
+#ifdef NDEBUG
+		const char* build = "release";
+#else
+		const char* build = "debug";
+#endif
+		os << "{\n  \"suite\": \"VolumeShapes\",\n  \"config\": {"
+			<< "\"date\": " << quoted(date)
+			<< ", \"compiler\": " << quoted(compiler)
+			<< ", \"build\": " << quoted(build)
+			<< ", \"cache_metrics\": " << cache
+			<< ", \"instrument\": " << (Instrument::enabled() ? "true" : "false")
+			<< ", \"hardware_threads\": " << std::thread::hardware_concurrency()
+			<< ", \"threads\": " << ThreadPool::shared().size()
+			<< ", \"reps\": " << opt.reps
+			<< ", \"warmup\": " << opt.warmup
+			<< ", \"max_time\": " << opt.maxTime
+			<< ", \"seed\": " << opt.seed << "},\n  \"results\": [";
+	}
+	// bytesPerOp < 0 - бенчмарк не пише на диск
+	void result(const char* name, size_t size, size_t ops, int warmup, const std::vector<double>& perOp, double bytesPerOp)
+	{
+		Summary s = summarize(perOp);
+		next();
+		// printAll залишає в std::cout свій формат чисел, тож формат задається щоразу
+		os << std::fixed << std::setprecision(2);
+		os << "{\"name\": " << quoted(name) << ", \"size\": " << size << ", \"ops_per_sample\": " << ops
+			<< ", \"warmup\": " << warmup << ", \"samples\": " << perOp.size()
+			<< ", \"ns_per_op\": {\"min\": " << s.min << ", \"mean\": " << s.mean << ", \"p50\": " << s.p50
+			<< ", \"p90\": " << s.p90 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "}";
+		if (bytesPerOp >= 0) os << ", \"bytes_per_op\": " << bytesPerOp;
+		os << "}";
+		os.flush();
+	}
+	void error(size_t size, const std::string& what)
+	{
+		next();
+		os << "{\"size\": " << size << ", \"error\": " << quoted(what) << "}";
+		os.flush();
+	}
+	~Report()
+	{
+		// лічильники SHAPES_INSTRUMENT за весь прогін (без нього - нулі)
+		os << "\n  ],\n  \"instrument\": " << Instrument::stats().json() << "\n}\n";
+	}
+private:
+	void next()
+	{
+		os << (first ? "\n    " : ",\n    ");
+		first = false;
+	}
+};
+
+void usage()
+{
+	std::cerr << "usage: Benchmarks [--sizes 1e3,1e4,...] [--max-size N] [--reps R] [--warmup W]\n"
+		"                  [--max-time S] [--filter text] [--seed N] [--threads T] [--out file]\n";
+	std::exit(2);
+}
+
+Options parse(int argc, char* argv[])
+{
+	Options opt;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string key = argv[i];
+		if (i + 1 == argc) usage();
+		std::string value = argv[++i];
+		if (key == "--sizes")
+		{
+			opt.sizes.clear();
+			std::istringstream list(value);
+			std::string item;
+			while (std::getline(list, item, ',')) opt.sizes.push_back(static_cast<size_t>(std::stod(item)));
+		}
+		else if (key == "--max-size") opt.maxSize = static_cast<size_t>(std::stod(value));
+		else if (key == "--reps") opt.reps = std::max(1, std::atoi(value.c_str()));
+		else if (key == "--warmup") opt.warmup = std::max(0, std::atoi(value.c_str()));
+		else if (key == "--max-time") opt.maxTime = std::stod(value);
+		else if (key == "--filter") opt.filter = value;
+		else if (key == "--seed") opt.seed = std::stoull(value);
+		else if (key == "--threads") opt.threads = static_cast<unsigned>(std::max(0, std::atoi(value.c_str())));
+		else if (key == "--out") opt.out = value;
+		else usage();
+	}
+	return opt;
+}
+}
+
+int main(int argc, char* argv[])
+{
+	Options opt = parse(argc, argv);
+	ThreadPool::setSharedThreads(opt.threads);
+	std::ofstream file;
+	if (!opt.out.empty()) file.open(opt.out);
+	Report report(opt.out.empty() ? std::cout : file, opt);
+
+	for (size_t s = 0; s < opt.sizes.size(); ++s)
+	{
+		const size_t n = opt.sizes[s];
+		if (n == 0 || (opt.maxSize != 0 && n > opt.maxSize)) continue;
+		try
+		{
+			std::cerr << "size " << n << ": building catalog\n";
+			Catalog catalog(n, opt.seed);
+			for (const Benchmark& b : benchmarks)
+			{
+				if (!opt.filter.empty() && std::string(b.name).find(opt.filter) == std::string::npos) continue;
+				std::cerr << "size " << n << ": " << b.name << '\n';
+				const size_t ops = b.kind == BULK ? n : pointOps(n);
+				const double budget = opt.maxTime * 1e9;
+				double spent = 0;
+				int warmed = 0;
+				written = -1;
+				for (; warmed < opt.warmup && spent < budget; ++warmed) spent += b.run(catalog, ops);
+				std::vector<double> perOp;
+				spent = 0;
+				while (perOp.size() < static_cast<size_t>(opt.reps) && (perOp.empty() || spent < budget))
+				{
+					double ns = b.run(catalog, ops);
+					spent += ns;
+					perOp.push_back(ns / ops);
+				}
+				report.result(b.name, n, ops, warmed, perOp, written < 0 ? -1 : written / ops);
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			report.error(n, "out of memory");
+			break;
+		}
+		catch (const std::exception& e)
+		{
+			report.error(n, e.what());
+			break;
+		}
+	}
+	return 0;
+}
@@ -1,5 +1,5 @@
 #include "FlatShapes.h"
-#include <sstream>
+#include "TextWriter.h"
 
 ostream& operator<<(ostream& os, const Shape& s)
 {
@@ -9,20 +9,36 @@ ostream& operator<<(ostream& os, const Shape& s)
 
 string Shape::toStr() const
 {
-	std::ostringstream target;
-	this->printOn(target);
-	return target.str();
+	string target;
+	TextWriter(target).print(*this);
+	return target;
+}
+
+const char* Shape::getClassName() const
+{
+	return ShapeRegistry::type(typeTag()).name;
+}
+
+// параметри в тому порядку, в якому їх пише storeOn (після літери основи)
+template<> void ShapeRegistry::builtins(ShapeRegistry& r)
+{
+	r.enroll<Rectangle>("Rectangle", [](std::istream& in) -> Shape* { double a, b; in >> a >> b; return new Rectangle(a, b); });
+	r.enroll<Circle>("Circle", [](std::istream& in) -> Shape* { double radius; in >> radius; return new Circle(radius); });
+	r.enroll<Triangle>("Triangle", [](std::istream& in) -> Shape* { double a, b; int y; in >> a >> b >> y; return new Triangle(a, b, y); });
+	r.enroll<area>("area", [](std::istream& in) -> Shape* { double a; in >> a; return new area(a); });
 }
 
 //-----------------------------------------------------------
 
 double Rectangle::area() const
 {
+	SHAPES_COUNT(SHAPE_AREA);
 	return a * b;
 }
 
 double Rectangle::perim() const
 {
+	SHAPES_COUNT(SHAPE_PERIM);
 	return (a + b) * 2.;
 }
 
@@ -37,15 +53,28 @@ void Rectangle::storeOn(ofstream& fout) const
 	fout << "R " << a << ' ' << b;
 }
 
+size_t Rectangle::hash() const
+{
+	return ShapeHash::mix(ShapeHash::mix(typeTag(), ShapeHash::of(a)), ShapeHash::of(b));
+}
+
+bool Rectangle::sameAs(const Shape& s) const
+{
+	const Rectangle& r = static_cast<const Rectangle&>(s);
+	return a == r.a && b == r.b;
+}
+
 //-----------------------------------------------------------
 
 double Circle::area() const
 {
+	SHAPES_COUNT(SHAPE_AREA);
 	return M_PI*r*r;
 }
 
 double Circle::perim() const
 {
+	SHAPES_COUNT(SHAPE_PERIM);
 	return 2.*M_PI*r;
 }
 
@@ -60,16 +89,28 @@ void Circle::storeOn(ofstream& fout) const
 	fout << "C " << r;
 }
 
+size_t Circle::hash() const
+{
+	return ShapeHash::mix(typeTag(), ShapeHash::of(r));
+}
+
+bool Circle::sameAs(const Shape& s) const
+{
+	return r == static_cast<const Circle&>(s).r;
+}
+
 //-----------------------------------------------------------
 
 double Triangle::area() const
 {
-	return 0.5*a*b*std::sin(angle());
+	SHAPES_COUNT(SHAPE_AREA);
+	return cached(CACHED_AREA, [this] { return 0.5*a*b*MetricStats::sin(angle()); });
 }
 
 double Triangle::perim() const
 {
-	return a+b+std::sqrt(a*a+b*b-2.*a*b*std::cos(angle()));
+	SHAPES_COUNT(SHAPE_PERIM);
+	return cached(CACHED_PERIM, [this] { return a+b+MetricStats::sqrt(a*a+b*b-2.*a*b*MetricStats::cos(angle())); });
 }
 
 void Triangle::printOn(ostream& os) const
@@ -83,6 +124,17 @@ void Triangle::storeOn(ofstream& fout) const
 	fout << "T " << a << ' ' << b << ' ' << y;
 }
 
+size_t Triangle::hash() const
+{
+	return ShapeHash::mix(ShapeHash::mix(ShapeHash::mix(typeTag(), ShapeHash::of(a)), ShapeHash::of(b)), ShapeHash::of(y));
+}
+
+bool Triangle::sameAs(const Shape& s) const
+{
+	const Triangle& t = static_cast<const Triangle&>(s);
+	return a == t.a && b == t.b && y == t.y;
+}
+
 //-----------------------------------------------------------
 
 void area::printOn(ostream& os) const
@@ -1,9 +1,9 @@
 /*
-:     (, , , )
-      ,         .
- в:   ,    .    Shape 
-    . ϳ Rectangle, Circle, Triangle   .  -  
-   ,  ""    ,  area -  Rectangle
+ЗАВДАННЯ: Змоделюйте плоскі геометричні фігури (прямокутник, квадрат, круг, трикутник)
+   Вони мають певні розміри, вміють друкувати себе та повідомляти власні площу та периметр.
+ РІШЕННЯ: Оголосити ієрархію класів, що моделюють згадані фігури. Базовий абстрактний клас Shape задає
+   загальний інтерфейс. Підкласи Rectangle, Circle, Triangle моделюють різні фігури. Квадрат - це особливий
+   прямокутник, квадрат "є" прямокутник з рівними сторонами, тому area - підклас Rectangle
 */
 #ifndef _FlatShapesHeader_
 #define _FlatShapesHeader_
@@ -15,33 +15,78 @@
 #include <string>
 
 #include <cmath>
+#include <cstring>
+#include "ShapeArena.h"
+#include "MetricCache.h"
+#include "Instrument.h"
+#include "TypeRegistry.h"
 using std::ostream;
 using std::ofstream;
 using std::string;
 
-//   ,    ( )  
-//   ,        
-//     
+// хеш параметрів фігур: ShapeHash::mix(ShapeHash::mix(тег, of(a)), of(b)) і т.д.
+struct ShapeHash
+{
+	// рівні числа мають рівний хеш, зокрема 0. і -0.
+	static size_t of(double x)
+	{
+		if (x == 0.) x = 0.;
+		unsigned long long bits;
+		std::memcpy(&bits, &x, sizeof bits);
+		return of(bits);
+	}
+	static size_t of(int x) { return of(static_cast<unsigned long long>(static_cast<unsigned>(x))); }
+	static size_t of(unsigned long long x)
+	{
+		// завершальне перемішування splitmix64
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		return static_cast<size_t>(x ^ (x >> 31));
+	}
+	static size_t mix(size_t seed, size_t h)
+	{
+		return seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+	}
+};
+
+// абстрактний клас повідомляє, що вміють робити (мусять вміти) його підкласи
+// деструктор оголошено віртуальним, щоб всі деструктори були віртуальними і правильно працювали
+//   в поліморфних колекціях
 class Shape
 {
 public:
 	virtual ~Shape() {}
+	// розміщення в поточному пулі ShapeArena, якщо він є
+	static void* operator new(size_t size) { return ShapeArena::allocate(size); }
+	static void operator delete(void* p) { ShapeArena::deallocate(p); }
 	virtual double area() const = 0;
 	virtual double perim() const = 0;
 	virtual void printOn(ostream&) const = 0;
 	virtual void storeOn(ofstream&) const = 0;
 	virtual string toStr() const;
+	// тег і стале ім'я класу з ShapeRegistry
+	virtual int typeTag() const = 0;
+	const char* getClassName() const;
 	bool operator>(const Shape& s)
 	{
 		return this->area() > s.area();
 	}
+	// фігури рівні, якщо вони одного класу і з рівними параметрами; хеш
+	// рівних фігур однаковий. sameAs викликається лише для фігури того самого класу
+	virtual size_t hash() const = 0;
+	virtual bool sameAs(const Shape& s) const = 0;
+	bool operator==(const Shape& s) const { return this == &s || (typeTag() == s.typeTag() && sameAs(s)); }
+	bool operator!=(const Shape& s) const { return !(*this == s); }
 };
 
-//     񳺿 
+// єдиний оператор виведення для всієї ієрархії
 ostream& operator<<(ostream& os, const Shape& s);
 
-//   ,        ,
-//        
+typedef TypeRegistry<Shape> ShapeRegistry;
+template<> void ShapeRegistry::builtins(ShapeRegistry& r);
+
+// конструктор з параметрами, в якого всі параметри мають значення за замовчанням,
+//   стає також і конструктором за замовчанням
 class Rectangle : public Shape
 {
 protected:
@@ -53,6 +98,12 @@ public:
 	virtual double perim() const;
 	virtual void printOn(ostream&) const;
 	virtual void storeOn(ofstream&) const;
+	virtual int typeTag() const override { return ShapeRegistry::tagOf<Rectangle>(); }
+	// і для квадрата, і для підкласів без власних параметрів
+	virtual size_t hash() const override;
+	virtual bool sameAs(const Shape& s) const override;
+	double sideA() const { return a; }
+	double sideB() const { return b; }
 };
 
 class Circle : public Shape
@@ -65,15 +116,20 @@ public:
 	virtual double perim() const;
 	virtual void printOn(ostream&) const;
 	virtual void storeOn(ofstream&) const;
+	virtual int typeTag() const override { return ShapeRegistry::tagOf<Circle>(); }
+	virtual size_t hash() const override;
+	virtual bool sameAs(const Shape& s) const override;
 	double radius() const { return r; }
 };
 
-class Triangle : public Shape
+// площа і периметр потребують тригонометрії, тому запам'ятовуються (див. MetricCache)
+class Triangle : public Shape, private MetricCache<2>
 {
 private:
-	double a; //  
+	enum { CACHED_AREA, CACHED_PERIM };
+	double a; // сторони трикутника
 	double b;
-	int y;    //    
+	int y;    // і кут у градусах
 	double angle() const { return 3.14*y/180; }
 public:
 	Triangle(double sideA=3., double sideB=4., int angle=90) : a(sideA), b(sideB), y(angle) {}
@@ -81,15 +137,22 @@ public:
 	virtual double perim() const;
 	virtual void printOn(ostream&) const;
 	virtual void storeOn(ofstream&) const;
+	virtual int typeTag() const override { return ShapeRegistry::tagOf<Triangle>(); }
+	virtual size_t hash() const override;
+	virtual bool sameAs(const Shape& s) const override;
+	double sideA() const { return a; }
+	double sideB() const { return b; }
+	int degrees() const { return y; }
 };
 
-//          
+// особливість квадрата у способі конструювання та ще виведення на друк
 class area : public Rectangle
 {
 public:
 	area(double side=1.) : Rectangle(side,side) {};
 	virtual void printOn(ostream&) const;
 	virtual void storeOn(ofstream&) const;
+	virtual int typeTag() const override { return ShapeRegistry::tagOf<area>(); }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "Instrument.h"
+#include <sstream>
+
+namespace
+{
+const char* const counterNames[Instrument::COUNTER_COUNT] =
+{
+	"cylinder_created", "parallelepiped_created", "triprizm_created",
+	"conus_created", "rectpiramid_created", "tripiramid_created",
+	"copy_instance", "clone",
+	"base_area", "side_area", "surface_area", "volume", "shape_area", "shape_perim",
+	"records_parsed", "bad_classname", "bytes_stored",
+	"list_traversals", "list_steps", "list_longest"
+};
+const char* const timerNames[Instrument::TIMER_COUNT] = { "parse", "copy", "store" };
+}
+
+#ifdef SHAPES_INSTRUMENT
+#include "PerThreadCounters.h"
+
+namespace
+{
+// лічильники, потім час і кількість вимірювань кожного таймера
+enum
+{
+	NS = Instrument::COUNTER_COUNT,
+	TIMED = NS + Instrument::TIMER_COUNT,
+	SLOTS = TIMED + Instrument::TIMER_COUNT
+};
+
+// LIST_LONGEST підсумовується як найбільше, решта - як сума
+struct Merge
+{
+	static unsigned long long merge(size_t i, unsigned long long total, unsigned long long v)
+	{
+		if (i == Instrument::LIST_LONGEST) return v > total ? v : total;
+		return total + v;
+	}
+};
+typedef PerThreadCounters<SLOTS, Merge> Threads;
+}
+
+bool Instrument::enabled()
+{
+	return true;
+}
+
+void Instrument::add(Counter c, unsigned long long n)
+{
+	Threads::local().add(c, n);
+}
+
+void Instrument::traversed(unsigned long long steps)
+{
+	Threads::Local& t = Threads::local();
+	t.add(LIST_TRAVERSALS, 1);
+	t.add(LIST_STEPS, steps);
+	t.raise(LIST_LONGEST, steps);
+}
+
+void Instrument::time(Timer t, unsigned long long ns)
+{
+	Threads::Local& c = Threads::local();
+	c.add(NS + t, ns);
+	c.add(TIMED + t, 1);
+}
+
+Instrument::Scope::~Scope()
+{
+	time(t, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+Instrument::Output::~Output()
+{
+	// tellp повертає -1, якщо потік у стані помилки
+	std::streamoff end = os.tellp();
+	if (begin >= 0 && end >= begin) add(BYTES_STORED, static_cast<unsigned long long>(end - begin));
+}
+
+Instrument::Stats Instrument::stats()
+{
+	unsigned long long sum[SLOTS];
+	Threads::total(sum);
+	Stats s;
+	for (int i = 0; i < COUNTER_COUNT; ++i) s.counter[i] = sum[i];
+	for (int i = 0; i < TIMER_COUNT; ++i)
+	{
+		s.ns[i] = sum[NS + i];
+		s.timed[i] = sum[TIMED + i];
+	}
+	return s;
+}
+
+void Instrument::reset()
+{
+	Threads::reset();
+}
+#else
+bool Instrument::enabled()
+{
+	return false;
+}
+
+Instrument::Stats Instrument::stats()
+{
+	return Stats();
+}
+
+void Instrument::reset()
+{
+}
+#endif
+
+const char* Instrument::name(Counter c)
+{
+	return counterNames[c];
+}
+
+const char* Instrument::name(Timer t)
+{
+	return timerNames[t];
+}
+
+std::string Instrument::Stats::text() const
+{
+	std::ostringstream os;
+	for (int i = 0; i < COUNTER_COUNT; ++i) os << counterNames[i] << ' ' << counter[i] << '\n';
+	for (int i = 0; i < TIMER_COUNT; ++i)
+		os << timerNames[i] << "_ns " << ns[i] << '\n' << timerNames[i] << "_count " << timed[i] << '\n';
+	return os.str();
+}
+
+std::string Instrument::Stats::json() const
+{
+	std::ostringstream os;
+	os << "{\"enabled\": " << (enabled() ? "true" : "false") << ", \"counters\": {";
+	for (int i = 0; i < COUNTER_COUNT; ++i)
+		os << (i ? ", \"" : "\"") << counterNames[i] << "\": " << counter[i];
+	os << "}, \"timers\": {";
+	for (int i = 0; i < TIMER_COUNT; ++i)
+		os << (i ? ", \"" : "\"") << timerNames[i] << "\": {\"ns\": " << ns[i] << ", \"count\": " << timed[i] << '}';
+	os << "}}";
+	return os.str();
+}
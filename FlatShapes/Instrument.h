@@ -0,0 +1,115 @@
+/*
+Облік подій бібліотеки фігур. Коли програма працює повільно, лічильники
+  показують, на що пішов час: на розбір файла, копіювання фігур, обчислення
+  характеристик чи проходи списком.
+
+Режим вмикається макросом SHAPES_INSTRUMENT, заданим однаково для FlatShapes
+ і всіх проєктів, що з ним компонуються (як і SHAPES_CACHE_METRICS). Без нього
+ макроси SHAPES_COUNT, SHAPES_COUNT_N, SHAPES_TRAVERSED, SHAPES_TIME і
+ SHAPES_STORED нічого не роблять, а stats() повертає нулі.
+
+Що рахується:
+ - створені фігури кожного класу VolShape (усі конструктори, зокрема
+   копіювання), виклики CopyInstance і Clone;
+ - виклики baseArea, sideArea, surfaceArea, volume і area, perim основ;
+ - записи, прочитані MakeInstance і ShapeReader (разом з відхиленими), і
+   винятки BadClassname;
+ - байти, записані storeOn контейнерів;
+ - проходи LinkedList до позиції (addtoEnd, insert, getShape, remove):
+   кількість, пройдені вузли і найдовший прохід.
+ Час (в наносекундах) і кількість вимірювань - для розбору MakeInstance,
+ копіювання CopyInstance/Clone і storeOn контейнерів.
+
+Кожен потік рахує окремо, без блокувань; stats() підсумовує всі потоки, зокрема
+ вже завершені.
+*/
+#ifndef _InstrumentHeader_
+#define _InstrumentHeader_
+
+#include <string>
+
+#ifdef SHAPES_INSTRUMENT
+#include <chrono>
+#include <ostream>
+#ifdef _MSC_VER
+#pragma detect_mismatch("SHAPES_INSTRUMENT", "1")
+#endif
+#elif defined(_MSC_VER)
+#pragma detect_mismatch("SHAPES_INSTRUMENT", "0")
+#endif
+
+class Instrument
+{
+public:
+	enum Counter
+	{
+		CYLINDER_CREATED, PARALLELEPIPED_CREATED, TRIPRIZM_CREATED,
+		CONUS_CREATED, RECTPIRAMID_CREATED, TRIPIRAMID_CREATED,
+		COPY_INSTANCE, CLONE,
+		BASE_AREA, SIDE_AREA, SURFACE_AREA, VOLUME, SHAPE_AREA, SHAPE_PERIM,
+		RECORDS_PARSED, BAD_CLASSNAME, BYTES_STORED,
+		LIST_TRAVERSALS, LIST_STEPS, LIST_LONGEST,
+		COUNTER_COUNT
+	};
+	enum Timer { PARSE_TIME, COPY_TIME, STORE_TIME, TIMER_COUNT };
+
+	struct Stats
+	{
+		unsigned long long counter[COUNTER_COUNT];
+		unsigned long long ns[TIMER_COUNT];     // сумарний час
+		unsigned long long timed[TIMER_COUNT];  // кількість вимірювань
+		// рядки "назва значення" і об'єкт JSON з тими самими назвами
+		std::string text() const;
+		std::string json() const;
+	};
+	// підсумок усіх потоків; reset слід викликати, коли інші потоки не працюють з фігурами
+	static Stats stats();
+	static void reset();
+	static bool enabled();
+	static const char* name(Counter c);
+	static const char* name(Timer t);
+
+#ifdef SHAPES_INSTRUMENT
+	// службове для макросів
+	static void add(Counter c, unsigned long long n);
+	static void traversed(unsigned long long steps);
+	static void time(Timer t, unsigned long long ns);
+
+	class Scope
+	{
+	public:
+		explicit Scope(Timer timer) : t(timer), start(std::chrono::steady_clock::now()) {}
+		~Scope();
+	private:
+		Timer t;
+		std::chrono::steady_clock::time_point start;
+	};
+	// час і кількість байтів, записаних у потік за час існування
+	class Output
+	{
+	public:
+		explicit Output(std::ostream& stream) : os(stream), scope(STORE_TIME), begin(stream.tellp()) {}
+		~Output();
+	private:
+		std::ostream& os;
+		Scope scope;
+		std::streamoff begin;
+	};
+#endif
+};
+
+#ifdef SHAPES_INSTRUMENT
+#define SHAPES_COUNT(c) Instrument::add(Instrument::c, 1)
+#define SHAPES_COUNT_N(c, n) Instrument::add(Instrument::c, (n))
+#define SHAPES_TRAVERSED(steps) Instrument::traversed(steps)
+#define SHAPES_TIME(t) Instrument::Scope shapesTimer(Instrument::t)
+#define SHAPES_STORED(os) Instrument::Output shapesOutput(os)
+#else
+#define SHAPES_COUNT(c) ((void)0)
+#define SHAPES_COUNT_N(c, n) ((void)(n))
+#define SHAPES_TRAVERSED(steps) ((void)(steps))
+#define SHAPES_TIME(t) ((void)0)
+#define SHAPES_STORED(os) ((void)(os))
+#endif
+
+#endif
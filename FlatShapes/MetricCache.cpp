@@ -0,0 +1,62 @@
+#include "MetricCache.h"
+
+#ifdef SHAPES_CACHE_METRICS
+#include "PerThreadCounters.h"
+
+namespace
+{
+// SPENT - викликані й заощаджені потоком: з різниці до і після обчислення
+// MetricCache дізнається його повну ціну; у get не потрапляє
+enum { TRANSCENDENTAL, COMPUTED, HITS, SAVED, SPENT, COUNTERS };
+typedef PerThreadCounters<COUNTERS> Threads;
+}
+
+void MetricStats::count()
+{
+	Threads::Local& c = Threads::local();
+	c.add(SPENT, 1);
+	c.add(TRANSCENDENTAL, 1);
+}
+
+unsigned long long MetricStats::spent()
+{
+	return Threads::local().get(SPENT);
+}
+
+void MetricStats::computed()
+{
+	Threads::local().add(COMPUTED, 1);
+}
+
+void MetricStats::hit(unsigned cost)
+{
+	Threads::Local& c = Threads::local();
+	c.add(HITS, 1);
+	if (cost == 0) return;
+	c.add(SPENT, cost);
+	c.add(SAVED, cost);
+}
+
+MetricStats::Counters MetricStats::get()
+{
+	unsigned long long sum[COUNTERS];
+	Threads::total(sum);
+	Counters c = { sum[TRANSCENDENTAL], sum[COMPUTED], sum[HITS], sum[SAVED] };
+	return c;
+}
+
+void MetricStats::reset()
+{
+	Threads::reset();
+}
+#else
+MetricStats::Counters MetricStats::get()
+{
+	Counters c = { 0, 0, 0, 0 };
+	return c;
+}
+
+void MetricStats::reset()
+{
+}
+#endif
@@ -0,0 +1,129 @@
+/*
+Запам'ятовування обчислених характеристик фігур. Площа і периметр трикутника
+  щоразу викликають sin, cos і sqrt, бічна поверхня пірамід і конуса - sqrt
+  твірної чи апофеми, а ще й площу та периметр основи. Звіт, що питає в фігури
+  об'єм, площу поверхні і бічну площу, повторює все це кілька разів.
+
+Режим вмикається макросом SHAPES_CACHE_METRICS, заданим однаково для FlatShapes
+ і всіх проєктів, що з ним компонуються (MSVC перевіряє це під час компонування).
+ Тоді клас, що успадковує MetricCache<N>, обчислює кожне з N значень при першому
+ запиті через cached(i, обчислення) і далі віддає збережене. Значення зберігаються
+ підряд, разом з N байтами "ціни" - скільки трансцендентних викликів коштувало
+ обчислення. Оператори присвоєння, що змінюють фігуру, викликають invalidate().
+
+Без макроса MetricCache<N> - порожній базовий клас, cached просто обчислює
+ значення, і ні розмір об'єктів, ні швидкодія не змінюються.
+
+Лічильники MetricStats (лише в режимі кешу): скільки трансцендентних функцій
+ справді викликано через MetricStats::sin/cos/sqrt, скільки значень обчислено,
+ скільки взято з кешу і скільки трансцендентних викликів завдяки цьому не
+ відбулося - разом з тими, що мали б відбутися у вкладених обчисленнях, якби
+ кешу не було зовсім.
+
+Збережене значення записується і читається атомарно, тож паралельні обходи
+ можуть безпечно звертатися до тієї самої фігури.
+*/
+#ifndef _MetricCacheHeader_
+#define _MetricCacheHeader_
+
+#include <cmath>
+
+#ifdef SHAPES_CACHE_METRICS
+#include <atomic>
+#include <limits>
+#ifdef _MSC_VER
+#pragma detect_mismatch("SHAPES_CACHE_METRICS", "1")
+#endif
+#elif defined(_MSC_VER)
+#pragma detect_mismatch("SHAPES_CACHE_METRICS", "0")
+#endif
+
+class MetricStats
+{
+public:
+	struct Counters
+	{
+		unsigned long long transcendental; // викликано sin, cos, sqrt
+		unsigned long long computed;       // значень обчислено
+		unsigned long long hits;           // значень взято з кешу
+		unsigned long long saved;          // трансцендентних викликів заощаджено
+	};
+	// лічильники всіх потоків разом; без SHAPES_CACHE_METRICS - нулі.
+	// Кожен потік рахує окремо, тож лічильники не гальмують паралельні обходи;
+	// reset слід викликати, коли інші потоки не обчислюють
+	static Counters get();
+	static void reset();
+
+	// математика формул фігур; в режимі кешу ще й рахує виклики
+	static double sin(double x) { count(); return std::sin(x); }
+	static double cos(double x) { count(); return std::cos(x); }
+	static double sqrt(double x) { count(); return std::sqrt(x); }
+
+#ifdef SHAPES_CACHE_METRICS
+	// службове для MetricCache
+	static void count();
+	// ціна обчислень цього потоку від його початку: викликані й заощаджені виклики
+	static unsigned long long spent();
+	static void computed();
+	static void hit(unsigned cost);
+#else
+	static void count() {}
+#endif
+};
+
+#ifdef SHAPES_CACHE_METRICS
+template<int N> class MetricCache
+{
+public:
+	MetricCache() { invalidate(); }
+	MetricCache(const MetricCache& other) { copy(other); }
+	MetricCache& operator=(const MetricCache& other)
+	{
+		copy(other);
+		return *this;
+	}
+protected:
+	template<class F> double cached(int i, F compute) const
+	{
+		double v = value[i].load(std::memory_order_relaxed);
+		// NaN - ще не обчислено
+		if (v == v)
+		{
+			MetricStats::hit(cost[i].load(std::memory_order_relaxed));
+			return v;
+		}
+		const unsigned long long before = MetricStats::spent();
+		v = compute();
+		const unsigned long long c = MetricStats::spent() - before;
+		cost[i].store(static_cast<unsigned char>(c < 255 ? c : 255), std::memory_order_relaxed);
+		value[i].store(v, std::memory_order_relaxed);
+		MetricStats::computed();
+		return v;
+	}
+	void invalidate()
+	{
+		for (int i = 0; i < N; ++i)
+			value[i].store(std::numeric_limits<double>::quiet_NaN(), std::memory_order_relaxed);
+	}
+private:
+	void copy(const MetricCache& other)
+	{
+		for (int i = 0; i < N; ++i)
+		{
+			cost[i].store(other.cost[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			value[i].store(other.value[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+	}
+	mutable std::atomic<double> value[N];
+	mutable std::atomic<unsigned char> cost[N];
+};
+#else
+template<int N> class MetricCache
+{
+protected:
+	template<class F> double cached(int, F compute) const { return compute(); }
+	void invalidate() {}
+};
+#endif
+
+#endif
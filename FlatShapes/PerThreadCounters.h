@@ -0,0 +1,127 @@
+/*
+Лічильники подій, які кожен потік веде окремо, без блокувань (для MetricStats
+  і Instrument). Кожен потік при першому звертанні отримує власний набір з N
+  лічильників; пише в нього лише сам потік, тож додавання - звичайне, без
+  блокування шини, а атомарність потрібна тільки для читання з total().
+
+total() підсумовує живі потоки і ті, що вже завершилися (набір потоку, що
+ завершується, додається до спільного підсумку). Merge::merge(i, підсумок,
+ значення) задає, як лічильник i потрапляє в підсумок: типово (SumOf) - як
+ сума, а, наприклад, найдовший прохід - як найбільше.
+
+Кожне окреме N і Merge - окремий набір лічильників. reset() слід викликати,
+ коли інші потоки не рахують.
+*/
+#ifndef _PerThreadCountersHeader_
+#define _PerThreadCountersHeader_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+struct SumOf
+{
+	static unsigned long long merge(size_t, unsigned long long total, unsigned long long v) { return total + v; }
+};
+
+template<size_t N, class Merge = SumOf> class PerThreadCounters
+{
+public:
+	// лічильники одного потоку
+	class Local
+	{
+	public:
+		void add(size_t i, unsigned long long n)
+		{
+			value[i].store(value[i].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+		// для лічильників-максимумів
+		void raise(size_t i, unsigned long long v)
+		{
+			if (v > value[i].load(std::memory_order_relaxed)) value[i].store(v, std::memory_order_relaxed);
+		}
+		unsigned long long get(size_t i) const { return value[i].load(std::memory_order_relaxed); }
+	private:
+		friend class PerThreadCounters;
+		Local()
+		{
+			clear();
+			Shared& s = shared();
+			std::lock_guard<std::mutex> guard(s.lock);
+			s.threads.push_back(this);
+		}
+		~Local()
+		{
+			Shared& s = shared();
+			std::lock_guard<std::mutex> guard(s.lock);
+			for (size_t i = 0; i < N; ++i) s.retired[i] = Merge::merge(i, s.retired[i], value[i].load());
+			for (size_t t = 0; t < s.threads.size(); ++t)
+				if (s.threads[t] == this)
+				{
+					s.threads.erase(s.threads.begin() + t);
+					break;
+				}
+		}
+		Local(const Local&);
+		Local& operator=(const Local&);
+		void clear()
+		{
+			for (size_t i = 0; i < N; ++i) value[i].store(0, std::memory_order_relaxed);
+		}
+
+		std::atomic<unsigned long long> value[N];
+	};
+
+	static Local& local()
+	{
+		// звичайний вказівник дешевший у звертанні, ніж thread_local-об'єкт з
+		// конструктором; сам об'єкт створюється при першому звертанні потоку
+		if (mine == nullptr)
+		{
+			thread_local Local counters;
+			mine = &counters;
+		}
+		return *mine;
+	}
+
+	// підсумок усіх потоків, зокрема завершених
+	static void total(unsigned long long (&sum)[N])
+	{
+		Shared& s = shared();
+		std::lock_guard<std::mutex> guard(s.lock);
+		for (size_t i = 0; i < N; ++i)
+		{
+			sum[i] = s.retired[i];
+			for (size_t t = 0; t < s.threads.size(); ++t) sum[i] = Merge::merge(i, sum[i], s.threads[t]->get(i));
+		}
+	}
+
+	static void reset()
+	{
+		Shared& s = shared();
+		std::lock_guard<std::mutex> guard(s.lock);
+		for (size_t i = 0; i < N; ++i) s.retired[i] = 0;
+		for (size_t t = 0; t < s.threads.size(); ++t) s.threads[t]->clear();
+	}
+private:
+	// живі потоки і підсумок потоків, що вже завершилися
+	struct Shared
+	{
+		std::mutex lock;
+		std::vector<Local*> threads;
+		unsigned long long retired[N];
+		Shared() : retired() {}
+	};
+	static Shared& shared()
+	{
+		static Shared s;
+		return s;
+	}
+
+	static thread_local Local* mine;
+};
+
+template<size_t N, class Merge> thread_local typename PerThreadCounters<N, Merge>::Local* PerThreadCounters<N, Merge>::mine = nullptr;
+
+#endif
@@ -0,0 +1,141 @@
+#include "ShapeArena.h"
+#include <new>
+
+thread_local ShapeArena* ShapeArena::current = nullptr;
+
+namespace
+{
+// заголовок перед кожним об'єктом: пул-власник або nullptr для купи. Він займає
+// 8 байтів, тож об'єкти вирівняні на 8, а не на __STDCPP_DEFAULT_NEW_ALIGNMENT__
+// (16), як у звичайного operator new; класи з більшим вирівнюванням не реєструються
+union Header
+{
+	void* pool;
+	double align;
+};
+const size_t HEADER = sizeof(Header);
+static_assert(HEADER == ShapeArena::ALIGNMENT && alignof(Header) <= ShapeArena::ALIGNMENT, "ShapeArena header must keep objects aligned");
+const size_t MIN_SLAB = 4096;
+}
+
+ShapeArena::ShapeArena(size_t maxSlabBytes)
+	: maxSlab(maxSlabBytes < MIN_SLAB ? MIN_SLAB : maxSlabBytes), reserved(0), live(0), created(0)
+{
+}
+
+ShapeArena::~ShapeArena()
+{
+	release();
+}
+
+void* ShapeArena::allocate(size_t size)
+{
+	Header* h;
+	if (current == nullptr)
+	{
+		h = static_cast<Header*>(::operator new(size + HEADER));
+		h->pool = nullptr;
+	}
+	else
+	{
+		Pool* p = current->poolFor(size + HEADER);
+		h = static_cast<Header*>(current->take(p));
+		h->pool = p;
+	}
+	return h + 1;
+}
+
+void ShapeArena::deallocate(void* obj)
+{
+	if (obj == nullptr) return;
+	Header* h = static_cast<Header*>(obj) - 1;
+	if (h->pool == nullptr) ::operator delete(h);
+	else give(static_cast<Pool*>(h->pool), h);
+}
+
+ShapeArena* ShapeArena::owner(const void* obj)
+{
+	const Header* h = static_cast<const Header*>(obj) - 1;
+	return h->pool == nullptr ? nullptr : static_cast<Pool*>(h->pool)->owner;
+}
+
+ShapeArena::Pool* ShapeArena::poolFor(size_t slot)
+{
+	for (size_t i = 0; i < pools.size(); ++i)
+		if (pools[i]->slot == slot) return pools[i];
+	Pool* p = new Pool;
+	p->owner = this;
+	p->slot = slot;
+	p->slabBytes = MIN_SLAB;
+	p->next = p->end = nullptr;
+	p->freeList = nullptr;
+	pools.push_back(p);
+	return p;
+}
+
+void* ShapeArena::take(Pool* p)
+{
+	++live;
+	++created;
+	if (p->freeList != nullptr)
+	{
+		void* cell = p->freeList;
+		p->freeList = *static_cast<void**>(cell);
+		return cell;
+	}
+	if (p->next == nullptr || p->next + p->slot > p->end)
+	{
+		// кожен наступний блок пулу вдвічі більший, доки не досягне maxSlab
+		size_t bytes = p->slabBytes < p->slot ? p->slot : p->slabBytes;
+		char* slab = static_cast<char*>(::operator new(bytes));
+		slabs.push_back(slab);
+		reserved += bytes;
+		p->next = slab;
+		p->end = slab + bytes;
+		if (p->slabBytes < maxSlab) p->slabBytes *= 2;
+	}
+	void* cell = p->next;
+	p->next += p->slot;
+	return cell;
+}
+
+void ShapeArena::give(Pool* p, void* cell)
+{
+	*static_cast<void**>(cell) = p->freeList;
+	p->freeList = cell;
+	--p->owner->live;
+}
+
+void ShapeArena::release()
+{
+	for (size_t i = 0; i < slabs.size(); ++i) ::operator delete(slabs[i]);
+	for (size_t i = 0; i < pools.size(); ++i) delete pools[i];
+	for (size_t i = 0; i < merged.size(); ++i) delete merged[i];
+	slabs.clear();
+	pools.clear();
+	merged.clear();
+	reserved = live = 0;
+}
+
+void ShapeArena::merge(ShapeArena& other)
+{
+	if (&other == this) return;
+	for (size_t i = 0; i < other.pools.size(); ++i) other.pools[i]->owner = this;
+	for (size_t i = 0; i < other.merged.size(); ++i) other.merged[i]->owner = this;
+	merged.insert(merged.end(), other.pools.begin(), other.pools.end());
+	merged.insert(merged.end(), other.merged.begin(), other.merged.end());
+	slabs.insert(slabs.end(), other.slabs.begin(), other.slabs.end());
+	reserved += other.reserved;
+	live += other.live;
+	created += other.created;
+	other.pools.clear();
+	other.merged.clear();
+	other.slabs.clear();
+	other.reserved = other.live = other.created = 0;
+}
+
+ShapeArena::Stats ShapeArena::stats() const
+{
+	Stats s = { slabs.size(), reserved, live, created };
+	return s;
+}
@@ -0,0 +1,103 @@
+/*
+Пул пам'яті для фігур. Кожна фігура ієрархій Shape та VolShape - окремий
+  невеликий об'єкт у купі, а об'ємна фігура ще й тримає в купі свою основу.
+  Завантаження великого набору фігур перетворюється на мільйони викликів
+  malloc і розкидає пов'язані об'єкти по всій пам'яті.
+
+ShapeArena видає пам'ять з великих блоків (slab), окремих для кожного розміру
+ об'єкта - у цих ієрархіях це фактично окремий пул для кол, прямокутників,
+ трикутників, об'ємних фігур і вузлів списку. Звільнений об'єкт повертається
+ до списку вільних комірок свого пулу, а знищення самого ShapeArena звільняє
+ всі блоки разом.
+
+Класи, що підтримують пул, оголошують власні operator new/delete через
+ ShapeArena::allocate/deallocate. Пам'ять береться з пулу, поточного для
+ цього потоку (див. Scope), або зі звичайної купи, якщо такого немає. Перед
+ кожним об'єктом зберігається вказівник на пул-власник, тож delete правильно
+ звільняє об'єкт незалежно від того, який пул активний у момент видалення.
+ Через клас-специфічний operator new розміщуюче new для цих класів слід
+ записувати як ::new(p) T(...). Об'єкти вирівняні лише на ALIGNMENT (8 байтів).
+
+Пул не синхронізований: об'єкти з пулу можна створювати і знищувати лише в
+ потоці, що з ним працює (delete повертає комірку у список вільних без
+ блокувань). Тому контейнери, чиї фігури знищує будь-який потік (ConcurrentList,
+ PersistentList), розміщують їх у купі.
+*/
+#ifndef _ShapeArenaHeader_
+#define _ShapeArenaHeader_
+
+#include <cstddef>
+#include <vector>
+
+class ShapeArena
+{
+public:
+	struct Stats
+	{
+		size_t slabs;     // кількість виділених блоків
+		size_t reserved;  // байтів у блоках
+		size_t live;      // об'єктів, що зараз розміщені в пулі
+		size_t created;   // об'єктів, розміщених за весь час
+	};
+	// робить пул поточним для потоку на час свого існування
+	class Scope
+	{
+	public:
+		explicit Scope(ShapeArena* a) : prev(current) { current = a; }
+		~Scope() { current = prev; }
+	private:
+		Scope(const Scope&);
+		Scope& operator=(const Scope&);
+		ShapeArena* prev;
+	};
+
+	// вирівнювання об'єктів, які видає allocate
+	static const size_t ALIGNMENT = 8;
+
+	explicit ShapeArena(size_t maxSlabBytes = 1 << 20);
+	~ShapeArena();
+
+	// пам'ять для об'єкта розміру size з поточного пулу або з купи
+	static void* allocate(size_t size);
+	static void deallocate(void* p);
+	static ShapeArena* active() { return current; }
+	// пул, з якого allocate видав об'єкт obj, або nullptr, якщо об'єкт у купі
+	static ShapeArena* owner(const void* obj);
+
+	// звільняє всі блоки разом; об'єкти в них не знищуються, тому викликати
+	// можна лише тоді, коли їхні деструктори нічого, крім пам'яті, не звільняють
+	void release();
+	// забирає собі всі блоки other разом з розміщеними в них об'єктами (other стає
+	// порожнім): так об'єкти, створені в окремих пулах паралельно, переходять у спільний
+	void merge(ShapeArena& other);
+	Stats stats() const;
+private:
+	ShapeArena(const ShapeArena&);
+	ShapeArena& operator=(const ShapeArena&);
+
+	// пул комірок одного розміру
+	struct Pool
+	{
+		ShapeArena* owner;
+		size_t slot;       // розмір комірки разом із заголовком
+		size_t slabBytes;  // розмір наступного блоку
+		char* next;        // ще не використана частина поточного блоку
+		char* end;
+		void* freeList;    // звільнені комірки
+	};
+	Pool* poolFor(size_t slot);
+	void* take(Pool* p);
+	static void give(Pool* p, void* cell);
+
+	static thread_local ShapeArena* current;
+	std::vector<Pool*> pools;
+	// пули, забрані merge: їхні комірки лише повертаються, нові видаються з pools
+	std::vector<Pool*> merged;
+	std::vector<char*> slabs;
+	size_t maxSlab;
+	size_t reserved;
+	size_t live;
+	size_t created;
+};
+
+#endif
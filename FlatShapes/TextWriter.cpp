@@ -0,0 +1,251 @@
+#include "TextWriter.h"
+#include <charconv>
+#include <cstring>
+#include <locale>
+#include <stdexcept>
+
+TextWriter::TextWriter(ostream& os, size_t capacity) : os(&os), fileStream(nullptr), target(nullptr)
+{
+	start(capacity);
+}
+
+TextWriter::TextWriter(ofstream& os, size_t capacity) : os(&os), fileStream(&os), target(nullptr)
+{
+	start(capacity);
+}
+
+TextWriter::TextWriter(string& out, size_t capacity) : os(nullptr), fileStream(nullptr), target(&out), scratch(new std::ostringstream)
+{
+	start(capacity);
+}
+
+TextWriter::~TextWriter()
+{
+	flush();
+}
+
+void TextWriter::start(size_t size)
+{
+	// число з точністю 1 поміщається завжди; довші, якщо не вмістяться, пишуться потоком
+	capacity = size < 64 ? 64 : size;
+	buffer.reset(new char[capacity]);
+	used = 0;
+	take(stream());
+}
+
+void TextWriter::take(const std::ios_base& from)
+{
+	const std::ios_base::fmtflags f = from.flags();
+	const std::ios_base::fmtflags floatfield = f & std::ios_base::floatfield;
+	const std::ios_base::fmtflags basefield = f & std::ios_base::basefield;
+	fixedFormat = floatfield == std::ios_base::fixed;
+	precision = from.precision();
+	const std::numpunct<char>& punct = std::use_facet<std::numpunct<char> >(from.getloc());
+	// загальний формат з точністю 0 бібліотеки виводять по-різному, тож його
+	// відтворює сам потік
+	own = (fixedFormat || floatfield == 0) && (basefield == std::ios_base::dec || basefield == 0)
+		&& (f & (std::ios_base::showpos | std::ios_base::showpoint | std::ios_base::uppercase)) == 0
+		&& from.width() == 0 && (precision > 0 || (fixedFormat && precision == 0))
+		&& punct.decimal_point() == '.' && punct.grouping().empty();
+}
+
+void TextWriter::flush()
+{
+	if (used != 0)
+	{
+		if (target != nullptr) target->append(buffer.get(), used);
+		else os->write(buffer.get(), static_cast<std::streamsize>(used));
+		used = 0;
+	}
+	if (own)
+	{
+		ostream& s = stream();
+		if (fixedFormat) s.setf(std::ios_base::fixed, std::ios_base::floatfield);
+		else s.unsetf(std::ios_base::floatfield);
+		s.precision(precision);
+	}
+}
+
+char* TextWriter::room(size_t n)
+{
+	if (capacity - used < n) flush();
+	return buffer.get() + used;
+}
+
+void TextWriter::put(const char* s, size_t n)
+{
+	if (capacity - used < n)
+	{
+		flush();
+		if (n > capacity)
+		{
+			if (target != nullptr) target->append(s, n);
+			else os->write(s, static_cast<std::streamsize>(n));
+			return;
+		}
+	}
+	std::memcpy(buffer.get() + used, s, n);
+	used += n;
+}
+
+ofstream& TextWriter::file()
+{
+	if (fileStream == nullptr) throw std::invalid_argument("Error: TextWriter is not bound to a file\n");
+	return *fileStream;
+}
+
+//-----------------------------------------------------------
+
+TextWriter& TextWriter::operator<<(const char* s)
+{
+	if (own) put(s, std::strlen(s));
+	else direct([s](ostream& o) { o << s; });
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(const string& s)
+{
+	if (own) put(s.data(), s.size());
+	else direct([&s](ostream& o) { o << s; });
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(char c)
+{
+	if (!own) direct([c](ostream& o) { o << c; });
+	else
+	{
+		*room(1) = c;
+		++used;
+	}
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(int x)
+{
+	if (!own)
+	{
+		direct([x](ostream& o) { o << x; });
+		return *this;
+	}
+	char* p = room(16);
+	used = std::to_chars(p, buffer.get() + capacity, x).ptr - buffer.get();
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(size_t x)
+{
+	if (!own)
+	{
+		direct([x](ostream& o) { o << x; });
+		return *this;
+	}
+	char* p = room(24);
+	used = std::to_chars(p, buffer.get() + capacity, x).ptr - buffer.get();
+	return *this;
+}
+
+TextWriter& TextWriter::operator<<(double x)
+{
+	if (own)
+	{
+		const std::chars_format format = fixedFormat ? std::chars_format::fixed : std::chars_format::general;
+		const int digits = static_cast<int>(precision);
+		// to_chars з точністю дає той самий текст, що printf("%.*f") і "%.*g", якими
+		// числа форматує потік
+		for (int attempt = 0; attempt < 2; ++attempt)
+		{
+			std::to_chars_result r = std::to_chars(buffer.get() + used, buffer.get() + capacity, x, format, digits);
+			if (r.ec == std::errc())
+			{
+				used = r.ptr - buffer.get();
+				return *this;
+			}
+			flush();
+		}
+	}
+	direct([x](ostream& o) { o << x; });
+	return *this;
+}
+
+void TextWriter::fixed(int digits)
+{
+	if (own && digits >= 0)
+	{
+		fixedFormat = true;
+		precision = digits;
+	}
+	else direct([digits](ostream& o) { o << std::fixed << std::setprecision(digits); });
+}
+
+//-----------------------------------------------------------
+
+namespace
+{
+// теги вбудованих основ, тексти яких TextWriter формує сам
+struct FlatTags
+{
+	int rectangle, circle, triangle, square;
+	FlatTags() : rectangle(ShapeRegistry::tagOf<Rectangle>()), circle(ShapeRegistry::tagOf<Circle>()),
+		triangle(ShapeRegistry::tagOf<Triangle>()), square(ShapeRegistry::tagOf<area>()) {}
+};
+const FlatTags& flatTags()
+{
+	static const FlatTags tags;
+	return tags;
+}
+}
+
+void TextWriter::print(const Shape& s)
+{
+	const FlatTags& tags = flatTags();
+	const int tag = s.typeTag();
+	if (own && tag == tags.rectangle)
+	{
+		const Rectangle& r = static_cast<const Rectangle&>(s);
+		fixed(1);
+		*this << "Rectangle of size " << r.sideA() << " x " << r.sideB() << ';';
+	}
+	else if (own && tag == tags.circle)
+	{
+		fixed(1);
+		*this << "Circle of radius " << static_cast<const Circle&>(s).radius() << ';';
+	}
+	else if (own && tag == tags.triangle)
+	{
+		const Triangle& t = static_cast<const Triangle&>(s);
+		fixed(1);
+		*this << "Triangle of side " << t.sideA() << ',' << t.sideB() << " with angle " << t.degrees() << " degree;";
+	}
+	else if (own && tag == tags.square)
+	{
+		fixed(1);
+		*this << "area of side " << static_cast<const area&>(s).sideA() << ';';
+	}
+	else direct([&s](ostream& o) { s.printOn(o); });
+}
+
+void TextWriter::store(const Shape& s)
+{
+	const FlatTags& tags = flatTags();
+	const int tag = s.typeTag();
+	if (own && tag == tags.rectangle)
+	{
+		const Rectangle& r = static_cast<const Rectangle&>(s);
+		*this << "R " << r.sideA() << ' ' << r.sideB();
+	}
+	else if (own && tag == tags.circle)
+		*this << "C " << static_cast<const Circle&>(s).radius();
+	else if (own && tag == tags.triangle)
+	{
+		const Triangle& t = static_cast<const Triangle&>(s);
+		*this << "T " << t.sideA() << ' ' << t.sideB() << ' ' << t.degrees();
+	}
+	else if (own && tag == tags.square)
+		*this << "S " << static_cast<const area&>(s).sideA();
+	else
+	{
+		ofstream& f = file();
+		direct([&s, &f](ostream&) { s.storeOn(f); });
+	}
+}
@@ -0,0 +1,105 @@
+/*
+Швидке текстове виведення фігур. printOn і storeOn пишуть у потік через
+  форматування iostream, а контейнери ще й завершують кожен рядок std::endl,
+  тобто скиданням потоку. TextWriter збирає текст у власному буфері (64 КБ за
+  замовчанням) і передає його потокові одним write, коли буфер заповниться,
+  при flush() і в деструкторі; числа форматуються std::to_chars.
+
+Текст той самий, байт у байт, що дали б printOn і storeOn. Для цього TextWriter
+ відтворює стан формату потоку: printOn вбудованих основ вмикає std::fixed і
+ std::setprecision(1), і ці налаштування діють на всі наступні числа в потоці
+ (зокрема на висоту наступної фігури). TextWriter бере стан з потоку при
+ створенні, змінює його так само, як змінили б методи фігур, і повертає в
+ потік при кожному перенесенні буфера.
+
+Свої формати TextWriter знає лише для вбудованих класів (за тегом ShapeRegistry)
+ і лише для звичайного стану потоку: фіксований або загальний формат чисел,
+ десятковий, без width, showpos, showpoint і uppercase, з крапкою і без
+ групування розрядів у локалі. Інші фігури і будь-який інший стан потоку
+ обробляються як раніше - віртуальними методами і операторами потоку, після
+ перенесення вже зібраного тексту.
+
+Поки TextWriter існує, в його потік не можна писати інакше, ніж через нього.
+*/
+#ifndef _TextWriterHeader_
+#define _TextWriterHeader_
+
+#include "FlatShapes.h"
+#include <memory>
+#include <sstream>
+
+class TextWriter
+{
+public:
+	static const size_t DEFAULT_CAPACITY = 1 << 16;
+	explicit TextWriter(ostream& os, size_t capacity = DEFAULT_CAPACITY);
+	// для store потрібен файловий потік, як і для storeOn
+	explicit TextWriter(ofstream& os, size_t capacity = DEFAULT_CAPACITY);
+	// дописує текст у рядок; стан формату - як у нового потоку
+	explicit TextWriter(string& out, size_t capacity = DEFAULT_CAPACITY);
+	~TextWriter();
+
+	TextWriter& operator<<(const char* s);
+	TextWriter& operator<<(const string& s);
+	TextWriter& operator<<(char c);
+	TextWriter& operator<<(int x);
+	TextWriter& operator<<(size_t x);
+	TextWriter& operator<<(double x);
+	// те саме, що << std::fixed << std::setprecision(precision)
+	void fixed(int precision);
+
+	// те саме, що os << s
+	void print(const Shape& s);
+	// те саме, що s.storeOn(os); для TextWriter не з ofstream - виняток std::invalid_argument
+	void store(const Shape& s);
+
+	// переносить зібраний текст і стан формату в потік (не скидаючи сам потік)
+	void flush();
+protected:
+	// чи вміє TextWriter сам відтворити виведення в теперішньому стані
+	bool plain() const { return own; }
+	// переносить зібраний текст, викликає f(потік) для виведення старим способом і
+	// бере з потоку новий стан формату; для рядка f пише в допоміжний ostringstream
+	template<class F> void direct(F f);
+	// файловий потік для storeOn
+	ofstream& file();
+private:
+	TextWriter(const TextWriter&);
+	TextWriter& operator=(const TextWriter&);
+
+	void start(size_t capacity);
+	// потік, у який пише direct
+	ostream& stream() { return os != nullptr ? *os : *scratch; }
+	// стан формату з потоку
+	void take(const std::ios_base& from);
+	// місце для n символів у буфері
+	char* room(size_t n);
+	void put(const char* s, size_t n);
+
+	ostream* os;
+	ofstream* fileStream;
+	string* target;
+	// для рядка: зберігає стан формату між викликами direct
+	std::unique_ptr<std::ostringstream> scratch;
+	std::unique_ptr<char[]> buffer;
+	size_t capacity;
+	size_t used;
+	// відтворюваний стан формату: fixed чи загальний, точність
+	bool own;
+	bool fixedFormat;
+	std::streamsize precision;
+};
+
+template<class F> void TextWriter::direct(F f)
+{
+	flush();
+	f(stream());
+	if (target != nullptr)
+	{
+		*target += scratch->str();
+		scratch->str(string());
+	}
+	take(stream());
+}
+
+#endif
@@ -0,0 +1,166 @@
+/*
+Реєстр класів ієрархії фігур (Shape чи VolShape). Кожен конкретний клас
+  отримує компактний цілий номер - тег - і стале ім'я, що не залежить від
+  компілятора (на відміну від typeid().name()). За тегом таблиця дає функції
+  копіювання, розміщення копії чи перенесеного об'єкта в наданій пам'яті і
+  створення з потоку, тож CopyInstance, MakeInstance і storeOn не перебирають
+  класи по черзі.
+
+Тег об'єкта повертає віртуальний метод typeTag() класу:
+      int typeTag() const override { return VolShapeRegistry::tagOf<MyShape>(); }
+ Вбудовані класи ієрархії реєструються першими, при першому зверненні до
+ реєстру (builtins, визначений поряд з ієрархією), тому їхні теги сталі.
+ Новий клас реєструється статичним об'єктом у своєму .cpp, без змін у фабриках:
+      static VolShapeRegistry::Registrar<MyShape> myShape("MyShape", readMyShape);
+ Реєструвати класи слід до того, як з'являться їхні об'єкти і паралельні потоки:
+ читання таблиці не блокується.
+
+Ім'я класу шукається досконалим хешуванням: при кожній реєстрації добирається
+ таке зерно хеша, за якого всі імена потрапляють у різні комірки, тож пошук -
+ одне обчислення хеша і одне порівняння.
+*/
+#ifndef _TypeRegistryHeader_
+#define _TypeRegistryHeader_
+
+#include "ShapeArena.h"
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// тег класу T; -1, поки клас не зареєстровано
+template<class T> struct RegisteredTag
+{
+	static int value;
+};
+template<class T> int RegisteredTag<T>::value = -1;
+
+template<class Base> class TypeRegistry
+{
+public:
+	// читає з потоку параметри об'єкта (все, що йде після імені класу)
+	typedef Base* (*Make)(std::istream&);
+	struct Type
+	{
+		int tag;
+		const char* name;
+		size_t length;                       // довжина імені
+		size_t size;                         // sizeof і alignof класу
+		size_t align;
+		Base* (*copy)(const Base&);          // new T(копія) - через operator new класу
+		Base* (*place)(void*, const Base&);  // ::new(пам'ять) T(копія)
+		Base* (*move)(void*, Base&);         // ::new(пам'ять) T(перенесений об'єкт); копія, якщо
+		                                     // перенесення T може кинути виняток
+		Make make;                           // nullptr - клас не читається з потоку
+	};
+
+	// реєструє клас T і повертає його тег; повторна реєстрація нічого не змінює.
+	// Ім'я, яке вже має інший клас, - std::invalid_argument
+	template<class T> static int add(const char* name, Make make = nullptr)
+	{
+		return instance().template enroll<T>(name, make);
+	}
+	template<class T> static int tagOf()
+	{
+		instance();
+		return RegisteredTag<T>::value;
+	}
+	static size_t size() { return instance().types.size(); }
+	static const Type& type(int tag) { return instance().types[tag]; }
+	// клас за ім'ям; nullptr, якщо такого немає
+	static const Type* find(const char* name, size_t length) { return instance().lookup(name, length); }
+	static const Type* find(const std::string& name) { return find(name.data(), name.size()); }
+
+	template<class T> class Registrar
+	{
+	public:
+		explicit Registrar(const char* name, Make make = nullptr) { add<T>(name, make); }
+	};
+
+private:
+	TypeRegistry() : seed(0) { builtins(*this); }
+	TypeRegistry(const TypeRegistry&);
+	TypeRegistry& operator=(const TypeRegistry&);
+	static TypeRegistry& instance()
+	{
+		static TypeRegistry registry;
+		return registry;
+	}
+	// вбудовані класи ієрархії; визначається поряд з нею (FlatShapes.cpp, VolumeShapes.cpp)
+	static void builtins(TypeRegistry& r);
+
+	template<class T> static Base* copyOf(const Base& b) { return new T(static_cast<const T&>(b)); }
+	template<class T> static Base* placeOf(void* p, const Base& b) { return ::new(p) T(static_cast<const T&>(b)); }
+	template<class T> static Base* moveOf(void* p, Base& b) { return ::new(p) T(std::move_if_noexcept(static_cast<T&>(b))); }
+
+	template<class T> int enroll(const char* name, Make make)
+	{
+		// об'єкти класів реєстру розміщує ShapeArena (operator new Shape і VolShape)
+		static_assert(alignof(T) <= ShapeArena::ALIGNMENT, "class alignment exceeds ShapeArena::ALIGNMENT");
+		if (RegisteredTag<T>::value >= 0) return RegisteredTag<T>::value;
+		const size_t length = std::strlen(name);
+		if (lookup(name, length) != nullptr)
+			throw std::invalid_argument("Error: Class name " + std::string(name) + " is already registered\n");
+		Type t = { static_cast<int>(types.size()), name, length, sizeof(T), alignof(T), &copyOf<T>, &placeOf<T>, &moveOf<T>, make };
+		types.push_back(t);
+		rehash();
+		RegisteredTag<T>::value = t.tag;
+		return t.tag;
+	}
+
+	static uint64_t hash(const char* s, size_t n, uint64_t seed)
+	{
+		// FNV-1a з зерном і перемішуванням старших бітів у молодші
+		uint64_t h = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+		for (size_t i = 0; i < n; ++i)
+		{
+			h ^= static_cast<unsigned char>(s[i]);
+			h *= 1099511628211ull;
+		}
+		return h ^ (h >> 29);
+	}
+
+	// добирає зерно без колізій; якщо за 64 спроби не вдалося - удвічі більша таблиця
+	void rehash()
+	{
+		size_t n = 2;
+		while (n < types.size() * 2) n *= 2;
+		for (;; n *= 2)
+			for (uint64_t s = 0; s < 64; ++s)
+			{
+				std::vector<int> fresh(n, -1);
+				bool free = true;
+				for (size_t i = 0; i < types.size() && free; ++i)
+				{
+					int& slot = fresh[hash(types[i].name, types[i].length, s) & (n - 1)];
+					free = slot < 0;
+					slot = static_cast<int>(i);
+				}
+				if (free)
+				{
+					slots.swap(fresh);
+					seed = s;
+					return;
+				}
+			}
+	}
+
+	const Type* lookup(const char* name, size_t length) const
+	{
+		if (slots.empty()) return nullptr;
+		const int tag = slots[hash(name, length, seed) & (slots.size() - 1)];
+		if (tag < 0) return nullptr;
+		const Type& t = types[tag];
+		return t.length == length && std::memcmp(t.name, name, length) == 0 ? &t : nullptr;
+	}
+
+	std::vector<Type> types;
+	std::vector<int> slots;
+	uint64_t seed;
+};
+
+#endif
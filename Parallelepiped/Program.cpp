@@ -2,7 +2,7 @@
 
 int main()
 {
-	//   '
+	// Випробуємо складний об'єкт
 	Parapd R(2, 3, 4), P;
 	std::cout << R << "\n V = " << R.volume()
 		<< "\n So = " << R.baseArea()
@@ -0,0 +1,128 @@
+/*
+Потокова обробка файла фігур з командного рядка (див. StreamPipeline): читає
+  записи з файла чи stdin у форматі volShapes.txt або storage.txt, рахує
+  обрані характеристики і пише в stdout рядок на кожен запис і/або підсумки за
+  класами. Пам'ять не залежить від розміру файла, а результати з'являються,
+  поки файл ще читається:
+    ShapeStream --metrics volume volShapes.txt
+    generator | ShapeStream --totals-only --metrics all > totals.tsv
+
+Помилкові записи пропускаються; наприкінці в stderr виводяться їхні номери
+ рядків і повідомлення (перші --max-errors) та загальна кількість.
+ Код завершення: 0 - файл оброблено (навіть з помилковими записами),
+ 1 - не вдалося прочитати чи записати, 2 - неправильні аргументи.
+
+Використання:
+  ShapeStream [--metrics volume,base_area,side_area,surface_area|all] [--totals]
+              [--totals-only] [--exact] [--digits N] [--block N] [--blocks N]
+              [--max-errors N] [файл|-]
+*/
+#include "../VolumeShapes/StreamPipeline.h"
+#include <cstdlib>
+#include <sstream>
+
+namespace
+{
+struct Options
+{
+	StreamPipeline::Options pipeline;
+	int digits;         // значущих цифр; 0 - як у std::cout за замовчанням
+	std::string input;  // порожній чи "-" - stdin
+	Options() : digits(0) {}
+};
+
+void usage()
+{
+	std::cerr << "usage: ShapeStream [--metrics volume,base_area,side_area,surface_area|all] [--totals]\n"
+		"                   [--totals-only] [--exact] [--digits N] [--block N] [--blocks N]\n"
+		"                   [--max-errors N] [file|-]\n";
+	std::exit(2);
+}
+
+unsigned metrics(const std::string& value)
+{
+	if (value == "all") return CatalogStats::ALL;
+	unsigned mask = 0;
+	std::istringstream list(value);
+	std::string item;
+	while (std::getline(list, item, ','))
+	{
+		int m = 0;
+		while (m < ShapeBatch::METRIC_COUNT && item != ShapeBatch::metricName(static_cast<ShapeBatch::Metric>(m))) ++m;
+		if (m == ShapeBatch::METRIC_COUNT) usage();
+		mask |= 1u << m;
+	}
+	if (mask == 0) usage();
+	return mask;
+}
+
+size_t positive(const std::string& value)
+{
+	const long long n = std::atoll(value.c_str());
+	if (n <= 0) usage();
+	return static_cast<size_t>(n);
+}
+
+Options parse(int argc, char* argv[])
+{
+	Options opt;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string key = argv[i];
+		if (key == "--totals") opt.pipeline.totals = true;
+		else if (key == "--totals-only")
+		{
+			opt.pipeline.totals = true;
+			opt.pipeline.records = false;
+		}
+		else if (key == "--exact") opt.pipeline.precision = ShapeBatch::EXACT;
+		else if (key.compare(0, 2, "--") != 0)
+		{
+			if (!opt.input.empty()) usage();
+			opt.input = key;
+		}
+		else
+		{
+			if (i + 1 == argc) usage();
+			std::string value = argv[++i];
+			if (key == "--metrics") opt.pipeline.metrics = metrics(value);
+			else if (key == "--digits") opt.digits = static_cast<int>(positive(value));
+			else if (key == "--block") opt.pipeline.blockRecords = positive(value);
+			else if (key == "--blocks") opt.pipeline.blocks = positive(value);
+			else if (key == "--max-errors") opt.pipeline.maxErrors = static_cast<size_t>(std::atoll(value.c_str()));
+			else usage();
+		}
+	}
+	return opt;
+}
+}
+
+int main(int argc, char* argv[])
+{
+	Options opt = parse(argc, argv);
+	// усе виведення - через TextWriter стадії виведення, тож синхронізація з stdio не потрібна
+	std::ios_base::sync_with_stdio(false);
+	if (opt.digits != 0) std::cout.precision(opt.digits);
+	try
+	{
+		StreamPipeline pipeline(opt.pipeline);
+		StreamPipeline::Report report = opt.input.empty() || opt.input == "-"
+			? pipeline.run(std::cin, std::cout)
+			: pipeline.run(opt.input.c_str(), std::cout);
+		for (size_t i = 0; i < report.errors.size(); ++i)
+		{
+			const StreamPipeline::Error& e = report.errors[i];
+			if (e.badClassname) std::cerr << " !!! ERROR: Bad class name '" << e.message << "' encountered at line " << e.line << '\n';
+			else std::cerr << " !!! ERROR at line " << e.line << ": " << e.message;
+		}
+		if (report.errorCount != 0) std::cerr << report.errorCount << " bad records skipped\n";
+		if (report.declared >= 0 && static_cast<size_t>(report.declared) != report.records + report.errorCount)
+			std::cerr << "warning: " << report.declared << " records declared, " << report.records + report.errorCount << " found\n";
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what();
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,604 @@
+#include "CatalogLog.h"
+#include "ShapeReader.h"
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+const char MANIFEST_MAGIC[8] = { 'V', 'o', 'l', 'S', 'h', 'C', 'a', 't' };
+const char SEGMENT_MAGIC[8] = { 'V', 'o', 'l', 'S', 'h', 'L', 'o', 'g' };
+const size_t HEADER_SIZE = 24;
+const size_t RECORD_HEAD = 8;
+// довжини тіла записів CLEAR, REMOVE, INSERT і UPDATE
+const uint32_t CLEAR_SIZE = 8;
+const uint32_t REMOVE_SIZE = 16;
+const uint32_t SHAPE_SIZE = 40;
+
+uint32_t crcTable[256];
+
+struct CrcInit
+{
+	CrcInit()
+	{
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			crcTable[i] = c;
+		}
+	}
+} crcInit;
+
+uint32_t crc32(const unsigned char* p, size_t n)
+{
+	uint32_t c = 0xFFFFFFFFu;
+	for (size_t i = 0; i < n; ++i) c = crcTable[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+	return c ^ 0xFFFFFFFFu;
+}
+
+void put32(unsigned char* p, uint32_t v)
+{
+	for (int i = 0; i < 4; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+void put64(unsigned char* p, uint64_t v)
+{
+	for (int i = 0; i < 8; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+void putDouble(unsigned char* p, double d)
+{
+	uint64_t v;
+	std::memcpy(&v, &d, 8);
+	put64(p, v);
+}
+
+uint32_t get32(const unsigned char* p)
+{
+	uint32_t v = 0;
+	for (int i = 3; i >= 0; --i) v = (v << 8) | p[i];
+	return v;
+}
+
+uint64_t get64(const unsigned char* p)
+{
+	uint64_t v = 0;
+	for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+	return v;
+}
+
+double getDouble(const unsigned char* p)
+{
+	const uint64_t v = get64(p);
+	double d;
+	std::memcpy(&d, &v, 8);
+	return d;
+}
+
+// заголовок маніфесту чи сегмента
+void header(unsigned char* p, const char* magic, uint64_t n)
+{
+	std::memcpy(p, magic, 8);
+	put32(p + 8, CatalogLog::VERSION);
+	put32(p + 12, 0);
+	put64(p + 16, n);
+}
+
+bool checkHeader(const char* p, size_t size, const char* magic, uint64_t& n)
+{
+	if (size < HEADER_SIZE || std::memcmp(p, magic, 8) != 0) return false;
+	const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+	if (get32(u + 8) != CatalogLog::VERSION) return false;
+	n = get64(u + 16);
+	return true;
+}
+
+[[noreturn]] void failed(const char* what, const std::string& path)
+{
+	throw std::runtime_error(std::string("Error: ") + what + ' ' + path + '\n');
+}
+}
+
+//-----------------------------------------------------------
+// файл, відкритий для дописування, і операції над файлами, потрібні для
+// довговічності: fsync, обрізання, атомарне перейменування
+
+struct CatalogLog::File
+{
+	// пише файл під тимчасовим ім'ям і атомарно ставить на місце name
+	static uint64_t replace(const std::string& name, const void* p, size_t n)
+	{
+		const std::string tmp = name + ".tmp";
+		{
+			File f(tmp);
+			f.truncate(0);
+			f.write(p, n);
+			f.sync();
+		}
+		rename(tmp, name);
+		syncDirectory(name);
+		return n;
+	}
+
+#ifdef _WIN32
+	explicit File(const std::string& name, bool create = true) : name(name)
+	{
+		handle = CreateFileA(name.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+			create ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) failed("Cannot open file", name);
+	}
+	~File() { CloseHandle(handle); }
+	void truncate(uint64_t size)
+	{
+		LARGE_INTEGER at;
+		at.QuadPart = static_cast<LONGLONG>(size);
+		if (!SetFilePointerEx(handle, at, nullptr, FILE_BEGIN) || !SetEndOfFile(handle))
+			failed("Cannot truncate file", name);
+	}
+	void write(const void* p, size_t n)
+	{
+		const char* c = static_cast<const char*>(p);
+		while (n != 0)
+		{
+			DWORD part = n > 0x40000000 ? 0x40000000 : static_cast<DWORD>(n), done = 0;
+			if (!WriteFile(handle, c, part, &done, nullptr)) failed("Cannot write file", name);
+			c += done;
+			n -= done;
+		}
+	}
+	void sync()
+	{
+		if (!FlushFileBuffers(handle)) failed("Cannot sync file", name);
+	}
+	uint64_t size() const
+	{
+		LARGE_INTEGER n;
+		if (!GetFileSizeEx(handle, &n)) failed("Cannot get size of file", name);
+		return static_cast<uint64_t>(n.QuadPart);
+	}
+	static bool exists(const std::string& name)
+	{
+		return GetFileAttributesA(name.c_str()) != INVALID_FILE_ATTRIBUTES;
+	}
+	static void erase(const std::string& name)
+	{
+		if (!DeleteFileA(name.c_str()) && GetLastError() != ERROR_FILE_NOT_FOUND)
+			failed("Cannot delete file", name);
+	}
+	static void rename(const std::string& from, const std::string& to)
+	{
+		if (!MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+			failed("Cannot rename file", from);
+	}
+	// MOVEFILE_WRITE_THROUGH уже дочекався запису каталогу
+	static void syncDirectory(const std::string&) {}
+private:
+	HANDLE handle;
+	std::string name;
+#else
+	explicit File(const std::string& name, bool create = true) : name(name)
+	{
+		fd = open(name.c_str(), O_WRONLY | (create ? O_CREAT : 0), 0644);
+		if (fd < 0) failed("Cannot open file", name);
+	}
+	~File() { close(fd); }
+	void truncate(uint64_t size)
+	{
+		if (ftruncate(fd, static_cast<off_t>(size)) != 0 || lseek(fd, static_cast<off_t>(size), SEEK_SET) < 0)
+			failed("Cannot truncate file", name);
+	}
+	void write(const void* p, size_t n)
+	{
+		const char* c = static_cast<const char*>(p);
+		while (n != 0)
+		{
+			const ssize_t done = ::write(fd, c, n);
+			if (done < 0)
+			{
+				// перерваний сигналом виклик нічого не записав - повторюємо
+				if (errno == EINTR) continue;
+				failed("Cannot write file", name);
+			}
+			c += done;
+			n -= static_cast<size_t>(done);
+		}
+	}
+	void sync()
+	{
+		if (fsync(fd) != 0) failed("Cannot sync file", name);
+	}
+	uint64_t size() const
+	{
+		struct stat st;
+		if (fstat(fd, &st) != 0) failed("Cannot get size of file", name);
+		return static_cast<uint64_t>(st.st_size);
+	}
+	static bool exists(const std::string& name)
+	{
+		struct stat st;
+		return stat(name.c_str(), &st) == 0;
+	}
+	static void erase(const std::string& name)
+	{
+		if (unlink(name.c_str()) != 0 && exists(name)) failed("Cannot delete file", name);
+	}
+	static void rename(const std::string& from, const std::string& to)
+	{
+		if (::rename(from.c_str(), to.c_str()) != 0) failed("Cannot rename file", from);
+	}
+	// нове ім'я файла довговічне лише після fsync каталогу, в якому воно лежить
+	static void syncDirectory(const std::string& name)
+	{
+		const size_t slash = name.rfind('/');
+		const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : name.substr(0, slash);
+		const int d = open(dir.c_str(), O_RDONLY);
+		if (d < 0) failed("Cannot open directory", dir);
+		const int rc = fsync(d);
+		close(d);
+		if (rc != 0) failed("Cannot sync directory", dir);
+	}
+private:
+	int fd;
+	std::string name;
+#endif
+};
+
+//-----------------------------------------------------------
+
+CatalogLog::CatalogLog(const char* path, ShapeVector& catalog, Options opt)
+	: path(path), shapes(catalog), options(opt), log(nullptr), segment(0), logEnd(0), broken(false), manifestGen(0), waiting(0)
+{
+	if (options.groupRecords == 0) options.groupRecords = 1;
+	std::memset(&counters, 0, sizeof(counters));
+	recover();
+}
+
+CatalogLog::~CatalogLog()
+{
+	try
+	{
+		commit();
+	}
+	catch (...) {}
+	if (compactor.joinable()) compactor.join();
+	delete log;
+}
+
+std::string CatalogLog::segmentName(uint64_t n) const
+{
+	return path + '.' + std::to_string(n) + ".log";
+}
+
+std::string CatalogLog::snapshotName(uint64_t n) const
+{
+	return path + '.' + std::to_string(n) + ".snap";
+}
+
+uint64_t CatalogLog::generation() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return manifestGen;
+}
+
+CatalogLog::Stats CatalogLog::stats() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return counters;
+}
+
+//-----------------------------------------------------------
+
+void CatalogLog::recover()
+{
+	uint64_t g = 0;
+	if (File::exists(path))
+	{
+		MappedFile m(path.c_str());
+		if (!checkHeader(m.data(), m.size(), MANIFEST_MAGIC, g)) failed("Damaged catalog manifest", path);
+	}
+	shapes.removeAll();
+	if (g != 0)
+	{
+		CatalogSnapshot snap(snapshotName(g).c_str());
+		snap.load(shapes);
+	}
+	// залишки стиснення, перерваного після запису маніфесту
+	for (uint64_t k = g; k-- > 0;)
+	{
+		const bool s = File::exists(snapshotName(k)), l = File::exists(segmentName(k));
+		if (!s && !l) break;
+		if (s) File::erase(snapshotName(k));
+		if (l) File::erase(segmentName(k));
+	}
+	File::erase(path + ".tmp");
+	segment = g;
+	uint64_t valid = 0;
+	while (File::exists(segmentName(segment)))
+	{
+		// знімки стиснень, для яких маніфест так і не записано
+		if (segment != g) File::erase(snapshotName(segment));
+		File::erase(snapshotName(segment) + ".tmp");
+		const bool last = !File::exists(segmentName(segment + 1));
+		valid = replay(segmentName(segment), last);
+		if (last) break;
+		++segment;
+	}
+	manifestGen = g;
+	openSegment(segment, valid);
+}
+
+uint64_t CatalogLog::replay(const std::string& name, bool last)
+{
+	MappedFile m(name.c_str());
+	uint64_t n;
+	if (!checkHeader(m.data(), m.size(), SEGMENT_MAGIC, n) || n != segment)
+	{
+		// сегмент, створення якого обірвалося, ще не має жодного запису
+		if (last && m.size() < HEADER_SIZE) return 0;
+		failed("Damaged catalog log", name);
+	}
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(m.data());
+	size_t at = HEADER_SIZE;
+	while (m.size() - at >= RECORD_HEAD)
+	{
+		const uint32_t crc = get32(p + at), len = get32(p + at + 4);
+		if (len != CLEAR_SIZE && len != REMOVE_SIZE && len != SHAPE_SIZE) break;
+		if (m.size() - at - RECORD_HEAD < len) break;
+		if (crc32(p + at + 4, 4 + len) != crc) break;
+		const unsigned char* body = p + at + RECORD_HEAD;
+		const Op op = static_cast<Op>(body[0]);
+		const uint64_t index = len == CLEAR_SIZE ? 0 : get64(body + 8);
+		// контрольна сума збіглася, тож невідповідність - це журнал від іншого знімка
+		bool ok;
+		switch (op)
+		{
+		case CLEAR:  ok = len == CLEAR_SIZE; break;
+		case REMOVE: ok = len == REMOVE_SIZE && index < shapes.size(); break;
+		case INSERT: ok = len == SHAPE_SIZE && index <= shapes.size() && body[1] < ShapeBatch::KIND_COUNT; break;
+		case UPDATE: ok = len == SHAPE_SIZE && index < shapes.size() && body[1] < ShapeBatch::KIND_COUNT; break;
+		default:     ok = false;
+		}
+		if (!ok) failed("Catalog log does not match its snapshot", name);
+		switch (op)
+		{
+		case CLEAR:
+			shapes.removeAll();
+			break;
+		case REMOVE:
+			shapes.remove(static_cast<int>(index));
+			break;
+		default:
+		{
+			ShapeRecord r;
+			r.kind = static_cast<ShapeBatch::Kind>(body[1]);
+			r.angle = static_cast<int32_t>(get32(body + 4));
+			r.h = getDouble(body + 16);
+			r.a = getDouble(body + 24);
+			r.b = getDouble(body + 32);
+			std::unique_ptr<VolShape> made(r.make());
+			if (op == UPDATE) shapes.remove(static_cast<int>(index));
+			shapes.insert(std::move(made), static_cast<int>(index));
+			break;
+		}
+		}
+		++counters.replayed;
+		at += RECORD_HEAD + len;
+	}
+	if (at != m.size())
+	{
+		if (!last) failed("Damaged catalog log", name);
+		counters.discardedBytes += m.size() - at;
+	}
+	return at;
+}
+
+void CatalogLog::openSegment(uint64_t n, uint64_t validSize)
+{
+	const std::string name = segmentName(n);
+	File* f = new File(name);
+	try
+	{
+		if (validSize < HEADER_SIZE)
+		{
+			unsigned char h[HEADER_SIZE];
+			header(h, SEGMENT_MAGIC, n);
+			f->truncate(0);
+			f->write(h, HEADER_SIZE);
+			f->sync();
+			File::syncDirectory(name);
+			std::lock_guard<std::mutex> guard(lock);
+			counters.logBytes += HEADER_SIZE;
+		}
+		else
+		{
+			// відкинутий хвіст обрізається, інакше нові записи опинилися б за ним
+			f->truncate(validSize);
+			if (counters.discardedBytes != 0) f->sync();
+		}
+	}
+	catch (...)
+	{
+		delete f;
+		throw;
+	}
+	delete log;
+	log = f;
+	segment = n;
+	logEnd = validSize < HEADER_SIZE ? HEADER_SIZE : validSize;
+	broken = false;
+}
+
+//-----------------------------------------------------------
+
+void CatalogLog::record(Op op, uint64_t index, const ShapeRecord* r)
+{
+	const uint32_t len = op == CLEAR ? CLEAR_SIZE : op == REMOVE ? REMOVE_SIZE : SHAPE_SIZE;
+	unsigned char b[RECORD_HEAD + SHAPE_SIZE] = { 0 };
+	unsigned char* body = b + RECORD_HEAD;
+	put32(b + 4, len);
+	body[0] = static_cast<unsigned char>(op);
+	if (op != CLEAR) put64(body + 8, index);
+	if (r != nullptr)
+	{
+		body[1] = static_cast<unsigned char>(r->kind);
+		put32(body + 4, static_cast<uint32_t>(r->angle));
+		putDouble(body + 16, r->h);
+		putDouble(body + 24, r->a);
+		putDouble(body + 32, r->b);
+	}
+	put32(b, crc32(b + 4, 4 + len));
+	buffer.append(reinterpret_cast<const char*>(b), RECORD_HEAD + len);
+	if (++waiting >= options.groupRecords) commit();
+}
+
+void CatalogLog::addtoEnd(const VolShape& v)
+{
+	insert(v, static_cast<int>(shapes.size()));
+}
+
+void CatalogLog::insert(const VolShape& v, int index)
+{
+	const ShapeRecord r = ShapeRecord::of(v);
+	shapes.insert(std::unique_ptr<VolShape>(r.make()), index);
+	record(INSERT, static_cast<uint64_t>(index), &r);
+}
+
+void CatalogLog::update(int index, const VolShape& v)
+{
+	shapes.getShape(index);
+	const ShapeRecord r = ShapeRecord::of(v);
+	std::unique_ptr<VolShape> made(r.make());
+	shapes.remove(index);
+	shapes.insert(std::move(made), index);
+	record(UPDATE, static_cast<uint64_t>(index), &r);
+}
+
+void CatalogLog::remove(int index)
+{
+	if (shapes.empty()) return;
+	shapes.remove(index);
+	record(REMOVE, static_cast<uint64_t>(index), nullptr);
+}
+
+void CatalogLog::removeAll()
+{
+	shapes.removeAll();
+	record(CLEAR, 0, nullptr);
+}
+
+void CatalogLog::commit()
+{
+	if (buffer.empty()) return;
+	if (broken) failed("Catalog log is broken after a failed write", segmentName(segment));
+	try
+	{
+		log->write(buffer.data(), buffer.size());
+		if (options.sync) log->sync();
+	}
+	catch (...)
+	{
+		// частина групи могла вже потрапити у файл; без обрізання наступний commit
+		// дописав би групу за обірваним записом, і відтворення зупинилося б на ньому.
+		// Група лишається в buffer, тож commit можна повторити
+		try
+		{
+			log->truncate(logEnd);
+		}
+		catch (...)
+		{
+			broken = true;
+		}
+		throw;
+	}
+	logEnd += buffer.size();
+	std::lock_guard<std::mutex> guard(lock);
+	counters.records += waiting;
+	counters.logBytes += buffer.size();
+	++counters.commits;
+	if (options.sync) ++counters.syncs;
+	buffer.clear();
+	waiting = 0;
+}
+
+//-----------------------------------------------------------
+
+void CatalogLog::compact()
+{
+	waitCompaction();
+	commit();
+	// знімок стану на кінець поточного сегмента збирається тут, бо каталог далі змінюється
+	std::unique_ptr<ShapeBatch> batch(new ShapeBatch);
+	std::unique_ptr<std::vector<unsigned char>> order(new std::vector<unsigned char>);
+	order->reserve(shapes.size());
+	const ShapeVector& all = shapes;
+	for (ShapeVector::const_iterator it = all.begin(); it != all.end(); ++it)
+	{
+		batch->add(*it);
+		order->push_back(static_cast<unsigned char>(ShapeBatch::kindOf(*it)));
+	}
+	const uint64_t from = segment;
+	openSegment(segment + 1, 0);
+	compactor = std::thread(&CatalogLog::finishCompaction, this, from, segment, batch.get(), order.get());
+	batch.release();
+	order.release();
+}
+
+void CatalogLog::waitCompaction()
+{
+	if (compactor.joinable()) compactor.join();
+	if (failure)
+	{
+		std::exception_ptr e = failure;
+		failure = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+void CatalogLog::finishCompaction(uint64_t from, uint64_t to, ShapeBatch* batch, std::vector<unsigned char>* order)
+{
+	std::unique_ptr<ShapeBatch> b(batch);
+	std::unique_ptr<std::vector<unsigned char>> o(order);
+	try
+	{
+		const std::string snap = snapshotName(to), tmp = snap + ".tmp";
+		CatalogSnapshot::save(tmp.c_str(), *b, *o, options.encoding);
+		uint64_t bytes;
+		{
+			File f(tmp, false);
+			f.sync();
+			bytes = f.size();
+		}
+		File::rename(tmp, snap);
+		unsigned char h[HEADER_SIZE];
+		header(h, MANIFEST_MAGIC, to);
+		bytes += File::replace(path, h, HEADER_SIZE);
+		uint64_t old;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			counters.snapshotBytes += bytes;
+			old = manifestGen;
+			manifestGen = to;
+		}
+		// починаючи з найдавнішого: recover прибирає залишки, ідучи вниз від маніфесту до першої прогалини
+		for (uint64_t k = old; k <= from; ++k)
+		{
+			File::erase(snapshotName(k));
+			File::erase(segmentName(k));
+		}
+	}
+	catch (...)
+	{
+		failure = std::current_exception();
+	}
+}
@@ -0,0 +1,138 @@
+/*
+Журнал змін каталогу (write-ahead log). storeOn і CatalogSnapshot::save щоразу
+  переписують увесь набір фігур, тож одна вставка в каталог з мільйона фігур
+  коштує мільйон записів на диск. CatalogLog натомість дописує в кінець журналу
+  лише саму зміну - кілька десятків байтів - і періодично в фоні стискає журнал
+  у повний двійковий знімок.
+
+Файли каталогу path:
+ - path - маніфест, 24 байти: сигнатура "VolShCat", версія (u32), прапорці (u32),
+   покоління g (u64). Маніфест замінюється атомарним перейменуванням;
+ - path.<g>.snap - знімок CatalogSnapshot стану на початок журналу g (для g = 0
+   знімка немає, каталог починається порожнім);
+ - path.<g>.log, path.<g+1>.log, ... - сегменти журналу. Заголовок сегмента,
+   24 байти: сигнатура "VolShLog", версія (u32), прапорці (u32), номер (u64).
+
+Запис журналу: CRC-32 (u32) довжини і тіла, довжина тіла (u32), тіло: операція
+ (u8), клас фігури ShapeBatch::Kind (u8), 2 байти вирівнювання, кут (i32), далі
+ номер фігури (u64) і для INSERT та UPDATE - h, a, b (3 x f64). Усі числа
+ little-endian. Записуються лише фігури шести вбудованих класів.
+
+Зміни застосовуються до каталогу одразу, а на диск ідуть групами: записи
+ накопичуються в пам'яті і пишуться одним викликом write (з fsync, якщо
+ Options::sync) при commit або коли їх набралося Options::groupRecords. Отже
+ після збою втрачається щонайбільше незафіксована група.
+
+При відкритті каталог відновлюється: завантажується знімок покоління з
+ маніфесту і по черзі відтворюються сегменти журналу. Обірваний чи пошкоджений
+ хвіст останнього сегмента (збій посеред запису) відкидається й обрізається;
+ пошкодження в середині журналу - std::runtime_error.
+
+compact переходить на новий сегмент і в окремому потоці пише знімок поточного
+ стану, а тоді маніфест, після чого старі сегменти і знімок вилучаються. Якщо
+ стиснення перерветься збоєм, каталог відновиться зі старого знімка і всіх
+ сегментів.
+*/
+#ifndef _CatalogLogHeader_
+#define _CatalogLogHeader_
+
+#include "CatalogSnapshot.h"
+#include "ShapeVector.h"
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct ShapeRecord;
+
+class CatalogLog
+{
+public:
+	enum Op { INSERT = 1, REMOVE, UPDATE, CLEAR };
+	static const uint32_t VERSION = 1;
+
+	struct Options
+	{
+		// скільки записів накопичується до автоматичного commit (1 - кожна зміна окремо)
+		size_t groupRecords;
+		// fsync після кожної групи; false - лише write, дані в кеші ОС
+		bool sync;
+		// кодування стовпців знімка при стисненні
+		CatalogSnapshot::Encoding encoding;
+		Options() : groupRecords(1024), sync(true), encoding(CatalogSnapshot::RAW) {}
+	};
+
+	struct Stats
+	{
+		uint64_t records;        // записів дописано в журнал (без відтворених)
+		uint64_t logBytes;       // байтів дописано в журнал, з заголовками сегментів
+		uint64_t snapshotBytes;  // байтів записано у знімки і маніфести
+		uint64_t commits;        // викликів write
+		uint64_t syncs;          // викликів fsync
+		uint64_t replayed;       // записів відтворено при відкритті
+		uint64_t discardedBytes; // байтів обірваного хвоста, відкинутих при відкритті
+	};
+
+	// відновлює каталог з файлів path (вміст catalog замінюється) і відкриває
+	// журнал для дописування; каталогу, якого ще немає, - створює порожній
+	CatalogLog(const char* path, ShapeVector& catalog, Options opt = Options());
+	// фіксує незаписані зміни і чекає на стиснення; помилки тут не повідомляються -
+	// хто хоче їх знати, викликає commit і waitCompaction сам
+	~CatalogLog();
+	CatalogLog(const CatalogLog&) = delete;
+	CatalogLog& operator=(const CatalogLog&) = delete;
+
+	// змінюють каталог і додають запис у журнал. Фігура іншого класу -
+	// VolShape::BadClassname, неправильний номер - std::out_of_range; у журнал тоді
+	// нічого не потрапляє
+	void addtoEnd(const VolShape& v);
+	void insert(const VolShape& v, int index);
+	void update(int index, const VolShape& v);
+	void remove(int index);
+	void removeAll();
+
+	// записує накопичену групу. Якщо запис не вдався, дописане обрізається, а
+	// група лишається в пам'яті для повторного commit; якщо не вдалося й обрізати,
+	// кожен наступний commit - std::runtime_error
+	void commit();
+	// кількість записів, ще не переданих на диск
+	size_t pending() const { return waiting; }
+	// починає стиснення у фоні (попереднє спершу доводиться до кінця)
+	void compact();
+	// чекає на стиснення; якщо воно не вдалося - повторює його виняток
+	void waitCompaction();
+
+	ShapeVector& catalog() const { return shapes; }
+	// покоління останнього завершеного стиснення
+	uint64_t generation() const;
+	Stats stats() const;
+private:
+	struct File;
+
+	void record(Op op, uint64_t index, const ShapeRecord* r);
+	void recover();
+	// відтворює сегмент; повертає довжину правильної частини
+	uint64_t replay(const std::string& name, bool last);
+	void openSegment(uint64_t n, uint64_t validSize);
+	void finishCompaction(uint64_t from, uint64_t to, ShapeBatch* batch, std::vector<unsigned char>* order);
+	std::string segmentName(uint64_t n) const;
+	std::string snapshotName(uint64_t n) const;
+
+	std::string path;
+	ShapeVector& shapes;
+	Options options;
+	File* log;
+	uint64_t segment;       // номер сегмента, в який дописуємо
+	uint64_t logEnd;        // довжина записаної частини сегмента
+	bool broken;            // невдалий запис не вдалося обрізати, дописувати не можна
+	uint64_t manifestGen;   // покоління з маніфесту
+	std::string buffer;     // незаписана група
+	size_t waiting;
+	Stats counters;
+	mutable std::mutex lock; // counters.snapshotBytes і manifestGen змінює потік стиснення
+	std::thread compactor;
+	std::exception_ptr failure;
+};
+
+#endif
@@ -0,0 +1,465 @@
+#include "CatalogSnapshot.h"
+#include "ShapeVector.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+const char MAGIC[8] = { 'V', 'o', 'l', 'S', 'h', 'a', 'p', 'e' };
+const size_t HEADER_SIZE = 8 + 4 + 4 + 8 * ShapeBatch::KIND_COUNT * 2;
+const size_t COLUMN_HEADER = 16;
+// прапорець заголовка: після блоків класів записано порядок фігур (по байту класу на фігуру)
+const uint32_t HAS_ORDER = 1;
+
+enum Field { H, R, A, B, ANGLE };
+// стовпці кожного класу в порядку запису
+const int fields[ShapeBatch::KIND_COUNT][5] =
+{
+	{ H, R, -1 },           // Cylinder
+	{ H, A, B, -1 },        // Parallelepiped
+	{ H, A, B, ANGLE, -1 }, // TriPrizm
+	{ H, R, -1 },           // Conus
+	{ H, A, B, -1 },        // RectPiramid
+	{ H, A, B, ANGLE, -1 }, // TriPiramid
+};
+
+bool littleEndian()
+{
+	const uint16_t probe = 1;
+	unsigned char first;
+	std::memcpy(&first, &probe, 1);
+	return first == 1;
+}
+
+void checkHost()
+{
+	// формат little-endian, і RAW-стовпці використовуються прямо з пам'яті
+	if (!littleEndian()) throw std::runtime_error("Error: Snapshots need a little-endian host\n");
+}
+
+size_t padded(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+// бітове подання значення: словник і XOR-дельта працюють з ним, а не з числом,
+// тож -0., NaN тощо зберігаються без змін
+inline uint64_t bitsOf(double x) { uint64_t u; std::memcpy(&u, &x, 8); return u; }
+inline uint64_t bitsOf(int x) { return static_cast<uint32_t>(x); }
+inline void fromBits(uint64_t u, double& x) { std::memcpy(&x, &u, 8); }
+inline void fromBits(uint64_t u, int& x) { x = static_cast<int>(static_cast<uint32_t>(u)); }
+
+void putVarint(std::vector<char>& out, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+		v >>= 7;
+	}
+	out.push_back(static_cast<char>(v));
+}
+
+template<class T> void encodeDictionary(const T* v, size_t n, std::vector<char>& out, uint32_t& width)
+{
+	std::unordered_map<uint64_t, uint32_t> index;
+	std::vector<T> values;
+	std::vector<uint32_t> ids(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		std::pair<std::unordered_map<uint64_t, uint32_t>::iterator, bool> it =
+			index.insert(std::make_pair(bitsOf(v[i]), static_cast<uint32_t>(values.size())));
+		if (it.second) values.push_back(v[i]);
+		ids[i] = it.first->second;
+	}
+	width = values.size() <= 0x100 ? 1 : values.size() <= 0x10000 ? 2 : 4;
+	uint64_t d = values.size();
+	out.resize(8 + padded(d * sizeof(T)) + n * width);
+	char* p = out.data();
+	std::memcpy(p, &d, 8);
+	if (d != 0) std::memcpy(p + 8, values.data(), d * sizeof(T));
+	p += 8 + padded(d * sizeof(T));
+	for (size_t i = 0; i < n; ++i, p += width) std::memcpy(p, &ids[i], width);
+}
+
+void encodeDelta(const double* v, size_t n, std::vector<char>& out)
+{
+	uint64_t prev = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		uint64_t x = bitsOf(v[i]) ^ prev;
+		prev = bitsOf(v[i]);
+		int lead = 0, trail = 0;
+		if (x == 0) lead = 8;
+		else
+		{
+			while (((x >> (56 - 8 * lead)) & 0xFF) == 0) ++lead;
+			while (((x >> (8 * trail)) & 0xFF) == 0) ++trail;
+		}
+		out.push_back(static_cast<char>(lead << 4 | trail));
+		for (int b = trail; b < 8 - lead; ++b) out.push_back(static_cast<char>((x >> (8 * b)) & 0xFF));
+	}
+}
+
+void encodeDelta(const int* v, size_t n, std::vector<char>& out)
+{
+	int64_t prev = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		int64_t d = static_cast<int64_t>(v[i]) - prev;
+		prev = v[i];
+		putVarint(out, (static_cast<uint64_t>(d) << 1) ^ static_cast<uint64_t>(d >> 63));
+	}
+}
+
+void damaged()
+{
+	throw std::runtime_error("Error: Damaged shape snapshot\n");
+}
+
+template<class T> void decodeDictionary(const char* p, const char* end, uint32_t width, size_t n, T* out)
+{
+	if (end - p < 8) damaged();
+	uint64_t d;
+	std::memcpy(&d, p, 8);
+	if (static_cast<uint64_t>(end - p - 8) / sizeof(T) < d) damaged();
+	const char* values = p + 8;
+	const char* ids = values + padded(static_cast<size_t>(d) * sizeof(T));
+	if (width != 1 && width != 2 && width != 4) damaged();
+	if (ids > end || static_cast<size_t>(end - ids) / width < n) damaged();
+	for (size_t i = 0; i < n; ++i, ids += width)
+	{
+		uint32_t id = 0;
+		std::memcpy(&id, ids, width);
+		if (id >= d) damaged();
+		std::memcpy(out + i, values + id * sizeof(T), sizeof(T));
+	}
+}
+
+void decodeDelta(const char* p, const char* end, size_t n, double* out)
+{
+	uint64_t prev = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (p == end) damaged();
+		const int lead = static_cast<unsigned char>(*p) >> 4, trail = *p & 0x0F;
+		++p;
+		if (lead + trail > 8 || (lead < 8 && end - p < 8 - lead - trail)) damaged();
+		uint64_t x = 0;
+		for (int b = trail; b < 8 - lead; ++b) x |= static_cast<uint64_t>(static_cast<unsigned char>(*p++)) << (8 * b);
+		prev ^= x;
+		fromBits(prev, out[i]);
+	}
+}
+
+void decodeDelta(const char* p, const char* end, size_t n, int* out)
+{
+	int64_t prev = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		uint64_t z = 0;
+		for (int shift = 0;; shift += 7)
+		{
+			if (p == end || shift > 63) damaged();
+			const unsigned char c = static_cast<unsigned char>(*p++);
+			z |= static_cast<uint64_t>(c & 0x7F) << shift;
+			if ((c & 0x80) == 0) break;
+		}
+		prev += static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1);
+		out[i] = static_cast<int>(prev);
+	}
+}
+
+class Writer
+{
+public:
+	explicit Writer(const char* path) : out(path, std::ios::binary | std::ios::trunc), pos(0)
+	{
+		if (!out) throw std::runtime_error(std::string("Error: Cannot create file ") + path + '\n');
+	}
+	void write(const void* p, size_t n)
+	{
+		out.write(static_cast<const char*>(p), static_cast<std::streamsize>(n));
+		pos += n;
+	}
+	void pad()
+	{
+		static const char zeros[8] = { 0 };
+		write(zeros, padded(pos) - pos);
+	}
+	// заголовок стовпця і його дані в обраному кодуванні
+	template<class T> void column(const T* data, size_t n, CatalogSnapshot::Encoding enc)
+	{
+		std::vector<char> dict, delta;
+		uint32_t width = 0;
+		if (enc == CatalogSnapshot::AUTO)
+		{
+			encodeDictionary(data, n, dict, width);
+			encodeDelta(data, n, delta);
+			const size_t raw = n * sizeof(T);
+			enc = CatalogSnapshot::RAW;
+			if (dict.size() < raw && dict.size() <= delta.size()) enc = CatalogSnapshot::DICTIONARY;
+			else if (delta.size() < raw) enc = CatalogSnapshot::DELTA;
+		}
+		else if (enc == CatalogSnapshot::DICTIONARY) encodeDictionary(data, n, dict, width);
+		else if (enc == CatalogSnapshot::DELTA) encodeDelta(data, n, delta);
+
+		const char* payload = reinterpret_cast<const char*>(data);
+		size_t bytes = n * sizeof(T);
+		if (enc == CatalogSnapshot::DICTIONARY) { payload = dict.data(); bytes = dict.size(); }
+		if (enc == CatalogSnapshot::DELTA) { payload = delta.data(); bytes = delta.size(); }
+		uint32_t encoding = enc;
+		uint64_t length = padded(bytes);
+		write(&encoding, 4);
+		write(&width, 4);
+		write(&length, 8);
+		if (bytes != 0) write(payload, bytes);
+		pad();
+	}
+	uint64_t position() const { return pos; }
+	void rewind() { out.seekp(0); }
+	void finish(const char* path)
+	{
+		out.flush();
+		if (!out) throw std::runtime_error(std::string("Error: Cannot write file ") + path + '\n');
+	}
+private:
+	std::ofstream out;
+	uint64_t pos;
+};
+
+void saveBatch(const char* path, const ShapeBatch& batch, CatalogSnapshot::Encoding enc, const std::vector<unsigned char>* order)
+{
+	checkHost();
+	Writer w(path);
+	uint64_t counts[ShapeBatch::KIND_COUNT], offsets[ShapeBatch::KIND_COUNT];
+	char header[HEADER_SIZE] = { 0 };
+	w.write(header, HEADER_SIZE);
+	for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k)
+	{
+		const ShapeBatch::Columns& c = batch.columns(static_cast<ShapeBatch::Kind>(k));
+		counts[k] = c.size();
+		offsets[k] = w.position();
+		for (int f = 0; fields[k][f] >= 0; ++f)
+		{
+			switch (fields[k][f])
+			{
+			case H:     w.column(c.h.data(), c.size(), enc); break;
+			case R:     w.column(c.r.data(), c.size(), enc); break;
+			case A:     w.column(c.a.data(), c.size(), enc); break;
+			case B:     w.column(c.b.data(), c.size(), enc); break;
+			case ANGLE: w.column(c.angle.data(), c.size(), enc); break;
+			}
+		}
+	}
+	uint32_t flags = 0;
+	if (order != nullptr)
+	{
+		flags |= HAS_ORDER;
+		if (!order->empty()) w.write(order->data(), order->size());
+		w.pad();
+	}
+	w.rewind();
+	const uint32_t version = CatalogSnapshot::VERSION;
+	std::memcpy(header, MAGIC, 8);
+	std::memcpy(header + 8, &version, 4);
+	std::memcpy(header + 12, &flags, 4);
+	std::memcpy(header + 16, counts, sizeof(counts));
+	std::memcpy(header + 16 + sizeof(counts), offsets, sizeof(offsets));
+	w.write(header, HEADER_SIZE);
+	w.finish(path);
+}
+}
+
+//-----------------------------------------------------------
+
+void CatalogSnapshot::save(const char* path, const ShapeBatch& batch, Encoding enc)
+{
+	saveBatch(path, batch, enc, nullptr);
+}
+
+void CatalogSnapshot::save(const char* path, const ShapeVector& shapes, Encoding enc)
+{
+	ShapeBatch batch;
+	std::vector<unsigned char> order;
+	order.reserve(shapes.size());
+	for (ShapeVector::const_iterator it = shapes.begin(); it != shapes.end(); ++it)
+	{
+		batch.add(*it);
+		order.push_back(static_cast<unsigned char>(ShapeBatch::kindOf(*it)));
+	}
+	saveBatch(path, batch, enc, &order);
+}
+
+void CatalogSnapshot::save(const char* path, const ShapeBatch& batch, const std::vector<unsigned char>& order, Encoding enc)
+{
+	saveBatch(path, batch, enc, &order);
+}
+
+CatalogSnapshot::CatalogSnapshot(const char* path) : file(path)
+{
+	checkHost();
+	uint32_t version;
+	if (file.size() < HEADER_SIZE || std::memcmp(file.data(), MAGIC, 8) != 0)
+		throw std::runtime_error(std::string("Error: Not a shape snapshot ") + path + '\n');
+	std::memcpy(&version, file.data() + 8, 4);
+	if (version != VERSION)
+		throw std::runtime_error(std::string("Error: Unsupported snapshot version in ") + path + '\n');
+	std::memcpy(counts, file.data() + 16, sizeof(counts));
+	std::memcpy(offsets, file.data() + 16 + sizeof(counts), sizeof(offsets));
+	for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k)
+		if (offsets[k] < HEADER_SIZE || offsets[k] > file.size() || counts[k] > file.size()) damaged();
+}
+
+size_t CatalogSnapshot::size() const
+{
+	size_t n = 0;
+	for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k) n += static_cast<size_t>(counts[k]);
+	return n;
+}
+
+CatalogSnapshot::Column CatalogSnapshot::column(ShapeBatch::Kind k, int col) const
+{
+	uint64_t at = offsets[k];
+	Column c;
+	for (int i = 0;; ++i)
+	{
+		if (file.size() - at < COLUMN_HEADER) damaged();
+		const char* p = file.data() + at;
+		std::memcpy(&c.encoding, p, 4);
+		std::memcpy(&c.width, p + 4, 4);
+		std::memcpy(&c.bytes, p + 8, 8);
+		if (c.bytes > file.size() - at - COLUMN_HEADER) damaged();
+		c.payload = p + COLUMN_HEADER;
+		if (i == col) return c;
+		at += COLUMN_HEADER + c.bytes;
+	}
+}
+
+bool CatalogSnapshot::mapped(ShapeBatch::Kind k) const
+{
+	for (int f = 0; fields[k][f] >= 0; ++f)
+		if (column(k, f).encoding != RAW) return false;
+	return true;
+}
+
+ShapeBatch::View CatalogSnapshot::view(ShapeBatch::Kind k) const
+{
+	ShapeBatch::View v = { nullptr, nullptr, nullptr, nullptr, nullptr, size(k) };
+	for (int f = 0; fields[k][f] >= 0; ++f)
+	{
+		Column c = column(k, f);
+		const size_t width = fields[k][f] == ANGLE ? sizeof(int) : sizeof(double);
+		if (c.encoding != RAW)
+			throw std::logic_error("Error: Snapshot column is encoded and cannot be viewed in place\n");
+		if (c.bytes / width < v.size) damaged();
+		switch (fields[k][f])
+		{
+		case H:     v.h = reinterpret_cast<const double*>(c.payload); break;
+		case R:     v.r = reinterpret_cast<const double*>(c.payload); break;
+		case A:     v.a = reinterpret_cast<const double*>(c.payload); break;
+		case B:     v.b = reinterpret_cast<const double*>(c.payload); break;
+		case ANGLE: v.angle = reinterpret_cast<const int*>(c.payload); break;
+		}
+	}
+	return v;
+}
+
+//-----------------------------------------------------------
+
+namespace
+{
+template<class T> void decodeColumn(const char* payload, uint64_t bytes, uint32_t encoding, uint32_t width, std::vector<T>& out, size_t n)
+{
+	const char* end = payload + bytes;
+	out.resize(n);
+	if (n == 0) return;
+	switch (encoding)
+	{
+	case CatalogSnapshot::RAW:
+		if (bytes / sizeof(T) < n) damaged();
+		std::memcpy(out.data(), payload, n * sizeof(T));
+		return;
+	case CatalogSnapshot::DICTIONARY:
+		decodeDictionary(payload, end, width, n, out.data());
+		return;
+	case CatalogSnapshot::DELTA:
+		decodeDelta(payload, end, n, out.data());
+		return;
+	}
+	damaged();
+}
+}
+
+void CatalogSnapshot::load(ShapeBatch& out) const
+{
+	for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k)
+	{
+		const ShapeBatch::Kind kind = static_cast<ShapeBatch::Kind>(k);
+		ShapeBatch::Columns fresh;
+		const size_t n = size(kind);
+		for (int f = 0; fields[k][f] >= 0; ++f)
+		{
+			Column c = column(kind, f);
+			switch (fields[k][f])
+			{
+			case H:     decodeColumn(c.payload, c.bytes, c.encoding, c.width, fresh.h, n); break;
+			case R:     decodeColumn(c.payload, c.bytes, c.encoding, c.width, fresh.r, n); break;
+			case A:     decodeColumn(c.payload, c.bytes, c.encoding, c.width, fresh.a, n); break;
+			case B:     decodeColumn(c.payload, c.bytes, c.encoding, c.width, fresh.b, n); break;
+			case ANGLE: decodeColumn(c.payload, c.bytes, c.encoding, c.width, fresh.angle, n); break;
+			}
+		}
+		ShapeBatch::Columns& dest = out.columns(kind);
+		if (dest.size() == 0) std::swap(dest, fresh);
+		else
+		{
+			dest.h.insert(dest.h.end(), fresh.h.begin(), fresh.h.end());
+			dest.r.insert(dest.r.end(), fresh.r.begin(), fresh.r.end());
+			dest.a.insert(dest.a.end(), fresh.a.begin(), fresh.a.end());
+			dest.b.insert(dest.b.end(), fresh.b.begin(), fresh.b.end());
+			dest.angle.insert(dest.angle.end(), fresh.angle.begin(), fresh.angle.end());
+		}
+	}
+}
+
+void CatalogSnapshot::load(ShapeVector& out) const
+{
+	ShapeBatch batch;
+	load(batch);
+	uint32_t flags;
+	std::memcpy(&flags, file.data() + 12, 4);
+	const size_t total = size();
+	// без збереженого порядку фігури йдуть класами, у порядку запису всередині класу
+	const unsigned char* order = nullptr;
+	std::vector<unsigned char> byKind;
+	if (flags & HAS_ORDER)
+	{
+		uint64_t at = offsets[ShapeBatch::KIND_COUNT - 1];
+		for (int f = 0; fields[ShapeBatch::KIND_COUNT - 1][f] >= 0; ++f) at += COLUMN_HEADER + column(ShapeBatch::TRIPIRAMID, f).bytes;
+		if (file.size() - at < total) damaged();
+		order = reinterpret_cast<const unsigned char*>(file.data() + at);
+	}
+	else
+	{
+		for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k) byKind.insert(byKind.end(), size(static_cast<ShapeBatch::Kind>(k)), static_cast<unsigned char>(k));
+		order = byKind.data();
+	}
+	out.reserve(out.size() + total);
+	size_t next[ShapeBatch::KIND_COUNT] = { 0 };
+	for (size_t i = 0; i < total; ++i)
+	{
+		const int k = order[i];
+		if (k >= ShapeBatch::KIND_COUNT || next[k] >= size(static_cast<ShapeBatch::Kind>(k))) damaged();
+		const ShapeBatch::Columns& c = batch.columns(static_cast<ShapeBatch::Kind>(k));
+		const size_t j = next[k]++;
+		switch (k)
+		{
+		case ShapeBatch::CYLINDER:       out.emplace<Cylinder>(c.h[j], c.r[j]); break;
+		case ShapeBatch::PARALLELEPIPED: out.emplace<Parallelepiped>(c.h[j], c.a[j], c.b[j]); break;
+		case ShapeBatch::TRIPRIZM:       out.emplace<TriPrizm>(c.h[j], c.a[j], c.b[j], c.angle[j]); break;
+		case ShapeBatch::CONUS:          out.emplace<Conus>(c.h[j], c.r[j]); break;
+		case ShapeBatch::RECTPIRAMID:    out.emplace<RectPiramid>(c.h[j], c.a[j], c.b[j]); break;
+		case ShapeBatch::TRIPIRAMID:     out.emplace<TriPiramid>(c.h[j], c.a[j], c.b[j], c.angle[j]); break;
+		}
+	}
+}
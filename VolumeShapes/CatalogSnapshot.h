@@ -0,0 +1,76 @@
+/*
+Двійковий знімок набору фігур. Текстовий storeOn пише кожну фігуру окремим
+  віртуальним викликом через форматування потоку. Знімок натомість зберігає
+  стовпці ShapeBatch як є.
+
+Формат (усі числа little-endian, усі блоки вирівняні на 8 байтів):
+ - заголовок, 112 байтів: сигнатура "VolShape", версія (u32), прапорці (u32),
+   кількість фігур кожного класу (6 x u64), зміщення блоку кожного класу від
+   початку файла (6 x u64);
+ - блок класу - його стовпці в порядку h, r (Cylinder, Conus) або a, b, далі
+   angle (TriPrizm, TriPiramid). Стовпець починається 16-байтовим описом:
+   кодування (u32), ширина індексу словника (u32), довжина даних у байтах (u64).
+
+Кодування стовпця:
+ - RAW - n значень double (або int32 для кутів) підряд. Такий стовпець
+   використовується просто з відображеного файла, без розбору і копіювання;
+ - DICTIONARY - кількість різних значень (u64), самі значення і для кожної
+   фігури номер значення шириною 1, 2 або 4 байти. Вигідне, коли параметри
+   часто повторюються;
+ - DELTA - кожне значення записане як XOR з попереднім: байт-опис (кількість
+   нульових старших байтів << 4 | кількість нульових молодших) і решта байтів.
+   Повтор попереднього значення займає 1 байт. Кути - різниця з попереднім у
+   zigzag-varint.
+ AUTO обирає для кожного стовпця найкоротше з трьох.
+*/
+#ifndef _CatalogSnapshotHeader_
+#define _CatalogSnapshotHeader_
+
+#include "ShapeBatch.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <vector>
+
+class ShapeVector;
+
+class CatalogSnapshot
+{
+public:
+	enum Encoding { RAW, DICTIONARY, DELTA, AUTO };
+	static const uint32_t VERSION = 1;
+
+	// записує пакет у файл; кидає std::runtime_error при помилці запису
+	static void save(const char* path, const ShapeBatch& batch, Encoding enc = RAW);
+	static void save(const char* path, const ShapeVector& shapes, Encoding enc = RAW);
+	// пакет і порядок фігур (клас кожної фігури), як їх зібрав би save з ShapeVector
+	static void save(const char* path, const ShapeBatch& batch, const std::vector<unsigned char>& order, Encoding enc = RAW);
+
+	// відкриває знімок; кидає std::runtime_error, якщо файл не є знімком цієї версії
+	explicit CatalogSnapshot(const char* path);
+
+	size_t size(ShapeBatch::Kind k) const { return static_cast<size_t>(counts[k]); }
+	size_t size() const;
+	// чи всі стовпці класу збережені як RAW, тобто доступні без розпакування
+	bool mapped(ShapeBatch::Kind k) const;
+	// стовпці класу прямо у відображеному файлі; лише для mapped(k)
+	ShapeBatch::View view(ShapeBatch::Kind k) const;
+	// розпаковує весь знімок у контейнер
+	void load(ShapeBatch& out) const;
+	void load(ShapeVector& out) const;
+private:
+	struct Column
+	{
+		uint32_t encoding;
+		uint32_t width;
+		uint64_t bytes;
+		const char* payload;
+	};
+	// опис стовпця з номером col у блоці класу k
+	Column column(ShapeBatch::Kind k, int col) const;
+
+	MappedFile file;
+	uint64_t counts[ShapeBatch::KIND_COUNT];
+	uint64_t offsets[ShapeBatch::KIND_COUNT];
+};
+
+#endif
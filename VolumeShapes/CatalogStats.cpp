@@ -0,0 +1,149 @@
+#include "CatalogStats.h"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+}
+
+//-----------------------------------------------------------
+
+void CatalogStats::Sum::add(double x, int sign)
+{
+	size_t* special = nullptr;
+	if (x != x) special = &nan;
+	else if (x == std::numeric_limits<double>::infinity()) special = &plusInf;
+	else if (x == -std::numeric_limits<double>::infinity()) special = &minusInf;
+	if (special != nullptr)
+	{
+		if (sign > 0) ++*special;
+		else --*special;
+	}
+	else
+	{
+		if (sign < 0) x = -x;
+		const double t = sum + x;
+		// втрачена при округленні частина меншого з доданків
+		if (std::fabs(sum) >= std::fabs(x)) compensation += (sum - t) + x;
+		else compensation += (x - t) + sum;
+		sum = t;
+	}
+}
+
+double CatalogStats::Sum::value() const
+{
+	if (nan != 0 || (plusInf != 0 && minusInf != 0)) return NaN;
+	if (plusInf != 0) return std::numeric_limits<double>::infinity();
+	if (minusInf != 0) return -std::numeric_limits<double>::infinity();
+	return sum + compensation;
+}
+
+void CatalogStats::Sum::reset()
+{
+	sum = compensation = 0.;
+	nan = plusInf = minusInf = 0;
+}
+
+//-----------------------------------------------------------
+
+CatalogStats::CatalogStats(unsigned metrics) : metrics(metrics & ALL), shapes(0) {}
+
+void CatalogStats::check(ShapeBatch::Metric m) const
+{
+	if (m < 0 || m >= ShapeBatch::METRIC_COUNT || !tracked(m))
+		throw std::invalid_argument("Error: Metric is not tracked by CatalogStats\n");
+}
+
+size_t CatalogStats::count(int tag) const
+{
+	return tag >= 0 && static_cast<size_t>(tag) < types.size() ? types[tag].count : 0;
+}
+
+CatalogStats::Summary CatalogStats::of(int tag, ShapeBatch::Metric m) const
+{
+	check(m);
+	Summary s = { 0, 0., NaN, NaN };
+	if (tag < 0 || static_cast<size_t>(tag) >= types.size() || types[tag].count == 0) return s;
+	const Type& t = types[tag];
+	const Column& c = t.column[m];
+	s.count = t.count;
+	s.sum = c.sum.value();
+	if (!c.values.empty())
+	{
+		s.min = c.values.begin()->first;
+		s.max = c.values.rbegin()->first;
+	}
+	return s;
+}
+
+CatalogStats::Summary CatalogStats::total(ShapeBatch::Metric m) const
+{
+	check(m);
+	Summary s = { shapes, shapes != 0 ? totals[m].value() : 0., NaN, NaN };
+	for (size_t tag = 0; tag < types.size(); ++tag)
+	{
+		const std::map<double, size_t>& values = types[tag].column[m].values;
+		if (values.empty()) continue;
+		// NaN у s.min і s.max означає, що значень ще не було
+		if (!(s.min <= values.begin()->first)) s.min = values.begin()->first;
+		if (!(s.max >= values.rbegin()->first)) s.max = values.rbegin()->first;
+	}
+	return s;
+}
+
+//-----------------------------------------------------------
+
+void CatalogStats::change(const VolShape& v, int sign)
+{
+	const int tag = v.typeTag();
+	if (static_cast<size_t>(tag) >= types.size()) types.resize(tag + 1);
+	Type& t = types[tag];
+	if (sign > 0)
+	{
+		++t.count;
+		++shapes;
+	}
+	else
+	{
+		if (t.count == 0) return;
+		--t.count;
+		--shapes;
+	}
+	for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+	{
+		if (!tracked(static_cast<ShapeBatch::Metric>(m))) continue;
+		Column& c = t.column[m];
+		const double x = metricOf(v, static_cast<ShapeBatch::Metric>(m));
+		// останнє вилучення обнуляє суму точно, без залишку округлення
+		if (t.count == 0) c.sum.reset();
+		else c.sum.add(x, sign);
+		if (shapes == 0) totals[m].reset();
+		else totals[m].add(x, sign);
+		if (x != x) continue;
+		if (sign > 0) ++c.values[x];
+		else
+		{
+			std::map<double, size_t>::iterator i = c.values.find(x);
+			if (i != c.values.end() && --i->second == 0) c.values.erase(i);
+		}
+	}
+}
+
+void CatalogStats::added(const VolShape& v)
+{
+	change(v, +1);
+}
+
+void CatalogStats::removed(const VolShape& v)
+{
+	change(v, -1);
+}
+
+void CatalogStats::cleared()
+{
+	shapes = 0;
+	types.clear();
+	for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m) totals[m].reset();
+}
@@ -0,0 +1,104 @@
+/*
+Підсумки набору фігур, що оновлюються разом з ним. Досі загальний об'єм, площу
+  поверхні і кількість фігур кожного класу рахували обходом усього списку
+  (ForEach); CatalogStats - спостерігач контейнера (ShapeObserver), тож після
+  list.attach(&stats) кожне addtoEnd, insert, remove, removeAll і присвоєння
+  змінює підсумки лише на одну фігуру.
+
+Для кожної обраної характеристики (ShapeBatch::Metric, типово об'єм і площа
+ поверхні) і кожного класу фігури (тег VolShapeRegistry, тож і класи поза
+ вбудованими) зберігаються кількість, сума, найменше і найбільше значення.
+ Сума - компенсована (Ноймаєр): похибка округлення накопичується окремо, тож
+ сума мільйонів додавань і вилучень не "пливе". Найменше і найбільше
+ тримаються в упорядкованій таблиці значень з кратністю, тож після вилучення
+ крайньої фігури наступне за нею значення відоме без перегляду всіх фігур.
+
+Читання підсумків класу - O(1), загальних - O(кількості класів у реєстрі);
+ додавання і вилучення фігури - O(log n).
+
+Як і MetricIndex, значення береться з фігури при додаванні і вилученні. Фігуру,
+ змінену на місці (через operator[] чи getShape), слід вилучити до зміни і
+ вставити знову, інакше підсумки розійдуться з вмістом.
+*/
+#ifndef _CatalogStatsHeader_
+#define _CatalogStatsHeader_
+
+#include "ShapeBatch.h"
+#include "ShapeObserver.h"
+#include <map>
+#include <vector>
+
+class CatalogStats : public ShapeObserver
+{
+public:
+	// набір характеристик - бітова маска з 1 << ShapeBatch::Metric, як у MetricIndex
+	static const unsigned DEFAULT = (1u << ShapeBatch::VOLUME) | (1u << ShapeBatch::SURFACE_AREA);
+	static const unsigned ALL = (1u << ShapeBatch::METRIC_COUNT) - 1;
+
+	// для порожнього набору sum = 0, а min і max - NaN. Значення NaN входять
+	// у count, роблять NaN суму, але не беруть участі в min і max
+	struct Summary
+	{
+		size_t count;
+		double sum;
+		double min;
+		double max;
+		double mean() const { return sum / count; }
+	};
+
+	explicit CatalogStats(unsigned metrics = DEFAULT);
+
+	bool tracked(ShapeBatch::Metric m) const { return (metrics & (1u << m)) != 0; }
+	size_t count() const { return shapes; }
+	size_t count(int tag) const;
+	template<class T> size_t count() const { return count(VolShapeRegistry::tagOf<T>()); }
+
+	// підсумки неврахованої характеристики кидають std::invalid_argument
+	// усі фігури
+	Summary total(ShapeBatch::Metric m) const;
+	// фігури класу з тегом tag
+	Summary of(int tag, ShapeBatch::Metric m) const;
+	template<class T> Summary of(ShapeBatch::Metric m) const { return of(VolShapeRegistry::tagOf<T>(), m); }
+
+	virtual void added(const VolShape& v) override;
+	virtual void removed(const VolShape& v) override;
+	virtual void cleared() override;
+	// підсумки не залежать від адрес фігур
+	virtual void moved(const VolShape*, const VolShape*, std::ptrdiff_t) override {}
+private:
+	// компенсована сума; нескінченні значення і NaN рахуються окремо, щоб
+	// вилучення такого значення повертало суму до скінченної
+	class Sum
+	{
+	public:
+		Sum() { reset(); }
+		void add(double x, int sign);
+		double value() const;
+		void reset();
+	private:
+		double sum, compensation;
+		size_t nan, plusInf, minusInf;
+	};
+	// одна характеристика фігур одного класу
+	struct Column
+	{
+		Sum sum;
+		std::map<double, size_t> values;  // значення (крім NaN) і кількість фігур з ним
+	};
+	struct Type
+	{
+		size_t count;
+		Column column[ShapeBatch::METRIC_COUNT];
+		Type() : count(0) {}
+	};
+
+	void check(ShapeBatch::Metric m) const;
+	void change(const VolShape& v, int sign);
+
+	unsigned metrics;
+	size_t shapes;
+	Sum totals[ShapeBatch::METRIC_COUNT];
+	std::vector<Type> types;  // за тегом класу
+};
+
+#endif
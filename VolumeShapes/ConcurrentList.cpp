@@ -0,0 +1,124 @@
+#include "ConcurrentList.h"
+#include <stdexcept>
+
+namespace
+{
+// розмір першого блоку; кожен наступний удвічі більший
+const size_t FIRST = 256;
+
+// позначка комірки, з якої фігуру вилучено; nullptr - у комірку ще не записано
+char tombstone;
+VolShape* const REMOVED = reinterpret_cast<VolShape*>(&tombstone);
+
+// номер старшого одиничного біта, x != 0
+unsigned highBit(size_t x)
+{
+	unsigned k = 0;
+	while (x >>= 1) ++k;
+	return k;
+}
+}
+
+const size_t ConcurrentList::MAX_SLOTS = FIRST * ((size_t(1) << BLOCKS) - 1);
+
+ConcurrentList::ConcurrentList() : reserved(0), published(0), live(0)
+{
+	for (size_t k = 0; k < BLOCKS; ++k) blocks[k].store(nullptr, std::memory_order_relaxed);
+}
+
+ConcurrentList::~ConcurrentList()
+{
+	const size_t n = reserved.load();
+	for (size_t k = 0; k < BLOCKS; ++k)
+	{
+		Slot* b = blocks[k].load();
+		if (b == nullptr) continue;
+		const size_t first = FIRST * ((size_t(1) << k) - 1), length = FIRST << k;
+		for (size_t i = 0; i < length && first + i < n; ++i)
+		{
+			VolShape* v = b[i].load();
+			if (v != nullptr && v != REMOVED) delete v;
+		}
+		delete[] b;
+	}
+}
+
+void ConcurrentList::locate(size_t index, size_t& block, size_t& offset)
+{
+	block = highBit(index / FIRST + 1);
+	offset = index - FIRST * ((size_t(1) << block) - 1);
+}
+
+ConcurrentList::Slot& ConcurrentList::slot(size_t index) const
+{
+	size_t k, offset;
+	locate(index, k, offset);
+	Slot* b = blocks[k].load(std::memory_order_acquire);
+	if (b == nullptr)
+	{
+		// блок виділяє той, хто перший до нього дійде; решта свої копії знищують
+		Slot* fresh = new Slot[FIRST << k]();
+		if (blocks[k].compare_exchange_strong(b, fresh)) b = fresh;
+		else delete[] fresh;
+	}
+	return b[offset];
+}
+
+const VolShape* ConcurrentList::get(size_t index) const
+{
+	const VolShape* v = slot(index).load(std::memory_order_acquire);
+	return v == REMOVED ? nullptr : v;
+}
+
+size_t ConcurrentList::publish(VolShape* v)
+{
+	const size_t index = reserved.fetch_add(1);
+	if (index >= MAX_SLOTS)
+	{
+		delete v;
+		throw std::length_error("Error: ConcurrentList is full\n");
+	}
+	slot(index).store(v);
+	live.fetch_add(1, std::memory_order_relaxed);
+	// опублікований початок просуває кожен, хто додав фігуру: якщо попередня комірка
+	// ще порожня, його комірку опублікує той, хто запише в попередню
+	size_t p = published.load();
+	while (p < reserved.load())
+	{
+		size_t k, offset;
+		locate(p, k, offset);
+		Slot* b = blocks[k].load(std::memory_order_acquire);
+		if (b == nullptr || b[offset].load() == nullptr) break;
+		if (published.compare_exchange_weak(p, p + 1)) ++p;
+	}
+	return index;
+}
+
+size_t ConcurrentList::addtoEnd(VolShape* val)
+{
+	ShapeArena::Scope scope(nullptr);
+	return publish(VolShape::CopyInstance(val));
+}
+
+size_t ConcurrentList::addtoEnd(std::unique_ptr<VolShape> val)
+{
+	if (!val->placedIn(nullptr)) return addtoEnd(val.get());
+	return publish(val.release());
+}
+
+bool ConcurrentList::remove(size_t index)
+{
+	if (index >= extent()) return false;
+	VolShape* v = slot(index).exchange(REMOVED);
+	if (v == REMOVED) return false;
+	live.fetch_sub(1, std::memory_order_relaxed);
+	Epoch::retire(v);
+	return true;
+}
+
+void ConcurrentList::ForEach(void (*do_something)(VolShape*)) const
+{
+	// як у LinkedList, функція отримує змінну фігуру; змінювати фігуру, яку
+	// можуть читати інші потоки, вона не повинна
+	forEach([do_something](const VolShape& v) { do_something(const_cast<VolShape*>(&v)); });
+}
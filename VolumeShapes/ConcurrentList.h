@@ -0,0 +1,97 @@
+/*
+Контейнер фігур для одночасного завантаження і читання з багатьох потоків.
+  LinkedList не синхронізований зовсім, і обгортка з одним м'ютексом
+  вишиковує в чергу і тих, хто додає, і тих, хто лише обходить список.
+  ConcurrentList не має блокувань:
+ - addtoEnd резервує номер комірки одним fetch_add і записує в неї фігуру.
+   Комірки лежать у блоках, що подвоюються (256, 512, 1024, ...), блоки ніколи
+   не переміщуються, тож запис в одну комірку не заважає читанню інших;
+ - опублікованим вважається суцільний початок комірок, у які вже записано
+   фігури. Читач (Reader) бере довжину цього початку один раз і обходить лише
+   його, тож бачить узгоджений стан - кожну фігуру, додану до початку обходу, у
+   порядку номерів - і завершує обхід за обмежену кількість кроків, хоч би що
+   робили інші потоки;
+ - remove замінює фігуру в комірці позначкою вилученої і передає фігуру в
+   Epoch::retire. Фігура знищується, лише коли жоден Reader, що міг її бачити,
+   вже не існує. Номери решти фігур не змінюються.
+
+Фігури і їхні основи розміщуються у звичайній купі, а не в ShapeArena, бо їх
+ знищує той потік, якому це випаде. Спостерігачів (ShapeObserver) контейнер
+ не підтримує: сповіщення з багатьох потоків без синхронізації не мають сенсу.
+
+Знищувати контейнер можна, лише коли з ним уже ніхто не працює.
+*/
+#ifndef _ConcurrentListHeader_
+#define _ConcurrentListHeader_
+
+#include "Epoch.h"
+#include "VolumeShapes.h"
+#include <atomic>
+#include <memory>
+
+class ConcurrentList
+{
+public:
+	// найбільша кількість комірок за всю історію контейнера
+	static const size_t MAX_SLOTS;
+
+	ConcurrentList();
+	~ConcurrentList();
+	ConcurrentList(const ConcurrentList&) = delete;
+	ConcurrentList& operator=(const ConcurrentList&) = delete;
+
+	// додає копію фігури (як LinkedList::addtoEnd) і повертає номер її комірки
+	size_t addtoEnd(VolShape* val);
+	// фігура переходить у власність контейнера; фігура чи основа з ShapeArena копіюється в купу
+	size_t addtoEnd(std::unique_ptr<VolShape> val);
+	// вилучає фігуру з комірки index; false, якщо комірка ще не опублікована
+	// або фігуру з неї вже вилучено
+	bool remove(size_t index);
+
+	// кількість фігур, не вилучених
+	size_t size() const { return live.load(std::memory_order_relaxed); }
+	// довжина опублікованого початку, разом з вилученими комірками
+	size_t extent() const { return published.load(std::memory_order_acquire); }
+
+	// погляд на опублікований початок на мить створення. Поки Reader існує, жодна
+	// фігура, яку він може повернути, не знищується
+	class Reader
+	{
+	public:
+		explicit Reader(const ConcurrentList& list) : list(list), count(list.extent()) {}
+		size_t size() const { return count; }
+		// фігура з комірки i < size() або nullptr, якщо її вилучено
+		const VolShape* operator[](size_t i) const { return list.get(i); }
+		template<class F> void forEach(F f) const
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				const VolShape* v = list.get(i);
+				if (v != nullptr) f(*v);
+			}
+		}
+	private:
+		Epoch::Guard guard;
+		const ConcurrentList& list;
+		size_t count;
+	};
+
+	template<class F> void forEach(F f) const { Reader(*this).forEach(f); }
+	void ForEach(void (*do_something)(VolShape*)) const;
+private:
+	typedef std::atomic<VolShape*> Slot;
+	// комірка, в якій номер блоку і зміщення в ньому
+	static void locate(size_t index, size_t& block, size_t& offset);
+	Slot& slot(size_t index) const;
+	const VolShape* get(size_t index) const;
+	size_t publish(VolShape* v);
+
+	// блоки по 256 << k комірок; загальна кількість комірок вміщується в size_t
+	static const size_t BLOCKS = sizeof(size_t) * 8 - 9;
+	mutable std::atomic<Slot*> blocks[BLOCKS];
+	std::atomic<size_t> reserved;  // комірок видано тим, хто додає
+	std::atomic<size_t> published; // суцільний початок, у який уже записано
+	std::atomic<size_t> live;
+};
+
+#endif
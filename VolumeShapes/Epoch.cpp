@@ -0,0 +1,182 @@
+#include "Epoch.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+struct Retired
+{
+	void* p;
+	void (*destroy)(void*);
+	uint64_t epoch;
+};
+
+// запис потоку; записи не знищуються до кінця програми, а потоки, що
+// завершилися, звільняють свої для нових
+struct Participant
+{
+	std::atomic<uint64_t> active; // епоха, в яку ввійшов потік; 0 - неактивний
+	std::atomic<bool> used;
+	Participant* next;
+	unsigned nesting;
+	std::vector<Retired> garbage; // у порядку зростання епох
+	Participant() : active(0), used(true), next(nullptr), nesting(0) {}
+};
+
+struct Domain
+{
+	std::atomic<uint64_t> epoch;
+	std::atomic<Participant*> head;
+	std::atomic<size_t> waiting;
+	std::mutex lock;
+	std::vector<Retired> orphans; // відкладене потоками, що завершилися
+	Domain() : epoch(1), head(nullptr), waiting(0) {}
+	~Domain()
+	{
+		for (size_t i = 0; i < orphans.size(); ++i) orphans[i].destroy(orphans[i].p);
+		for (Participant* p = head.load(); p != nullptr; )
+		{
+			Participant* next = p->next;
+			for (size_t i = 0; i < p->garbage.size(); ++i) p->garbage[i].destroy(p->garbage[i].p);
+			delete p;
+			p = next;
+		}
+	}
+
+	// епоха просувається, коли кожен активний потік уже ввійшов у поточну
+	void advance()
+	{
+		uint64_t e = epoch.load();
+		for (Participant* p = head.load(); p != nullptr; p = p->next)
+		{
+			const uint64_t a = p->active.load();
+			if (a != 0 && a != e) return;
+		}
+		epoch.compare_exchange_strong(e, e + 1);
+	}
+
+	// знищує з початку list усе, відкладене щонайменше дві епохи тому
+	void release(std::vector<Retired>& list)
+	{
+		const uint64_t e = epoch.load();
+		size_t n = 0;
+		while (n < list.size() && list[n].epoch + 2 <= e) ++n;
+		if (n == 0) return;
+		for (size_t i = 0; i < n; ++i) list[i].destroy(list[i].p);
+		list.erase(list.begin(), list.begin() + n);
+		waiting -= n;
+	}
+};
+
+Domain& domain()
+{
+	static Domain d;
+	return d;
+}
+
+Participant* acquire()
+{
+	Domain& d = domain();
+	for (Participant* p = d.head.load(); p != nullptr; p = p->next)
+	{
+		bool free = false;
+		if (!p->used.load() && p->used.compare_exchange_strong(free, true)) return p;
+	}
+	Participant* p = new Participant;
+	Participant* first = d.head.load();
+	do p->next = first;
+	while (!d.head.compare_exchange_weak(first, p));
+	return p;
+}
+
+struct Local
+{
+	Participant* p;
+	Local() : p(nullptr) {}
+	~Local()
+	{
+		if (p == nullptr) return;
+		Domain& d = domain();
+		if (!p->garbage.empty())
+		{
+			std::lock_guard<std::mutex> guard(d.lock);
+			d.orphans.insert(d.orphans.end(), p->garbage.begin(), p->garbage.end());
+			p->garbage.clear();
+		}
+		p->active.store(0);
+		p->nesting = 0;
+		p->used.store(false);
+	}
+	Participant& get()
+	{
+		if (p == nullptr) p = acquire();
+		return *p;
+	}
+};
+
+thread_local Local local;
+
+// після кожних COLLECT_EVERY відкладених об'єктів потік пробує звільнити накопичене
+const size_t COLLECT_EVERY = 64;
+}
+
+//-----------------------------------------------------------
+
+void Epoch::enter()
+{
+	Participant& me = local.get();
+	if (me.nesting++ != 0) return;
+	me.active.store(domain().epoch.load());
+	// подальші читання спільної структури не можуть випередити оголошення активності
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void Epoch::leave()
+{
+	Participant& me = local.get();
+	if (--me.nesting == 0) me.active.store(0, std::memory_order_release);
+}
+
+void Epoch::retire(void* p, void (*destroy)(void*))
+{
+	Domain& d = domain();
+	Participant& me = local.get();
+	Retired r = { p, destroy, d.epoch.load() };
+	me.garbage.push_back(r);
+	++d.waiting;
+	if (me.garbage.size() % COLLECT_EVERY == 0) collect();
+}
+
+void Epoch::collect()
+{
+	Domain& d = domain();
+	Participant& me = local.get();
+	d.advance();
+	d.release(me.garbage);
+	std::unique_lock<std::mutex> guard(d.lock, std::try_to_lock);
+	if (guard.owns_lock()) d.release(d.orphans);
+}
+
+void Epoch::flush()
+{
+	Domain& d = domain();
+	Participant& me = local.get();
+	// власний Guard не дав би епосі просунутися
+	if (me.nesting != 0) return;
+	d.advance();
+	d.advance();
+	d.release(me.garbage);
+	std::lock_guard<std::mutex> guard(d.lock);
+	d.release(d.orphans);
+}
+
+size_t Epoch::pending()
+{
+	return domain().waiting.load();
+}
+
+uint64_t Epoch::current()
+{
+	return domain().epoch.load();
+}
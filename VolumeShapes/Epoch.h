@@ -0,0 +1,57 @@
+/*
+Відкладене звільнення пам'яті за епохами (epoch-based reclamation). Потік, що
+  читає спільну структуру без блокувань, не може знати, чи не вилучив хтось
+  інший об'єкт, на який він щойно отримав вказівник. Тому вилучений об'єкт не
+  знищується одразу, а передається в retire і знищується пізніше - коли жоден
+  потік, що міг його бачити, вже не читає.
+
+Читач оголошує себе активним об'єктом Epoch::Guard на весь час роботи з
+ вказівниками. Guard запам'ятовує глобальну епоху; епоха просувається, лише
+ коли всі активні потоки побачили поточну. Об'єкт, вилучений в епоху e, вже
+ недосяжний для тих, хто ввійшов в епоху e + 1, тож після переходу до e + 2
+ його можна знищити.
+
+Guard, retire і collect не блокують читачів: активність і епоха - атомарні
+ змінні, а відкладені об'єкти кожен потік тримає у власному списку. М'ютекс є
+ лише в рідкісних шляхах - реєстрація нового потоку й передача відкладених
+ об'єктів потоку, що завершується.
+*/
+#ifndef _EpochHeader_
+#define _EpochHeader_
+
+#include <cstddef>
+#include <cstdint>
+
+class Epoch
+{
+public:
+	// потік активний, поки живе хоч один Guard; вкладені Guard дешеві
+	class Guard
+	{
+	public:
+		Guard() { enter(); }
+		~Guard() { leave(); }
+	private:
+		Guard(const Guard&);
+		Guard& operator=(const Guard&);
+	};
+
+	// знищить p викликом destroy(p), коли жоден активний потік не зможе його бачити.
+	// p має бути вже недосяжним для нових читачів
+	static void retire(void* p, void (*destroy)(void*));
+	template<class T> static void retire(T* p) { retire(p, &destroyAs<T>); }
+	// пробує просунути епоху і знищує відкладені об'єкти цього потоку, час яких настав
+	static void collect();
+	// знищує все, що відклали цей потік і потоки, які вже завершилися; решта потоків
+	// при цьому не повинна бути активною
+	static void flush();
+	// кількість відкладених, але ще не знищених об'єктів усіх потоків
+	static size_t pending();
+	static uint64_t current();
+private:
+	static void enter();
+	static void leave();
+	template<class T> static void destroyAs(void* p) { delete static_cast<T*>(p); }
+};
+
+#endif
@@ -0,0 +1,82 @@
+#include "MappedFile.h"
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+MappedFile::MappedFile(const char* path) : begin(""), length(0), file(INVALID_HANDLE_VALUE), mapping(nullptr)
+{
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error(std::string("Error: Cannot open file ") + path + '\n');
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		throw std::runtime_error(std::string("Error: Cannot get size of file ") + path + '\n');
+	}
+	// порожній файл відобразити не можна, але й не потрібно
+	if (size.QuadPart == 0) return;
+	if (static_cast<unsigned long long>(size.QuadPart) > static_cast<size_t>(-1))
+	{
+		CloseHandle(file);
+		throw std::runtime_error(std::string("Error: File is too large to map ") + path + '\n');
+	}
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error(std::string("Error: Cannot map file ") + path + '\n');
+	}
+	begin = static_cast<const char*>(view);
+	length = static_cast<size_t>(size.QuadPart);
+}
+
+MappedFile::~MappedFile()
+{
+	if (length != 0) UnmapViewOfFile(begin);
+	if (mapping) CloseHandle(mapping);
+	CloseHandle(file);
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const char* path) : begin(""), length(0), fd(-1)
+{
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error(std::string("Error: Cannot open file ") + path + '\n');
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		throw std::runtime_error(std::string("Error: Cannot get size of file ") + path + '\n');
+	}
+	if (st.st_size == 0) return;
+	void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	if (view == MAP_FAILED)
+	{
+		close(fd);
+		throw std::runtime_error(std::string("Error: Cannot map file ") + path + '\n');
+	}
+	madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+	begin = static_cast<const char*>(view);
+	length = static_cast<size_t>(st.st_size);
+}
+
+MappedFile::~MappedFile()
+{
+	if (length != 0) munmap(const_cast<char*>(begin), length);
+	close(fd);
+}
+#endif
@@ -0,0 +1,33 @@
+/*
+Файл, відображений у пам'ять лише для читання. Вміст доступний як звичайний
+  масив символів без копіювання в буфери потоку; операційна система сама
+  підвантажує сторінки під час послідовного читання.
+*/
+#ifndef _MappedFileHeader_
+#define _MappedFileHeader_
+
+#include <cstddef>
+
+class MappedFile
+{
+public:
+	// кидає std::runtime_error, якщо файл не вдалося відкрити чи відобразити
+	explicit MappedFile(const char* path);
+	~MappedFile();
+	const char* data() const { return begin; }
+	const char* end() const { return begin + length; }
+	size_t size() const { return length; }
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+	const char* begin;
+	size_t length;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int fd;
+#endif
+};
+
+#endif
@@ -0,0 +1,632 @@
+#include "MetricIndex.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+
+namespace
+{
+struct Entry
+{
+	double key;
+	const VolShape* shape;
+};
+
+// NaN вважається більшим за будь-яке число, щоб порядок залишався повним
+inline bool keyLess(double a, double b) { return a < b || (b != b && a == a); }
+
+inline bool entryLess(const Entry& a, const Entry& b)
+{
+	if (keyLess(a.key, b.key)) return true;
+	if (keyLess(b.key, a.key)) return false;
+	return std::less<const VolShape*>()(a.shape, b.shape);
+}
+
+const int LEAF_MAX = 64;
+const int INNER_MAX = 64;
+// вузол, менший за чверть, зливається з сусідом або позичає в нього
+const int LEAF_MIN = LEAF_MAX / 4;
+const int INNER_MIN = INNER_MAX / 4;
+
+struct Node
+{
+	bool leaf;
+	int n;
+};
+
+// на одну пару більше за LEAF_MAX: вставка спершу переповнює вузол, потім ділить
+struct Leaf : Node
+{
+	Leaf* prev;
+	Leaf* next;
+	Entry e[LEAF_MAX + 1];
+};
+
+// low[i] - найменша пара піддерева child[i], sizes[i] - кількість пар у ньому
+struct Inner : Node
+{
+	Entry low[INNER_MAX + 1];
+	size_t sizes[INNER_MAX + 1];
+	Node* child[INNER_MAX + 1];
+};
+
+Leaf* newLeaf()
+{
+	Leaf* l = new Leaf;
+	l->leaf = true;
+	l->n = 0;
+	l->prev = l->next = nullptr;
+	return l;
+}
+
+Inner* newInner()
+{
+	Inner* p = new Inner;
+	p->leaf = false;
+	p->n = 0;
+	return p;
+}
+
+const Entry& minOf(const Node* node)
+{
+	return node->leaf ? static_cast<const Leaf*>(node)->e[0] : static_cast<const Inner*>(node)->low[0];
+}
+
+size_t sizeOf(const Node* node)
+{
+	if (node->leaf) return node->n;
+	const Inner* p = static_cast<const Inner*>(node);
+	size_t s = 0;
+	for (int i = 0; i < p->n; ++i) s += p->sizes[i];
+	return s;
+}
+
+// номер піддерева, куди належить пара x
+int childFor(const Inner* p, const Entry& x)
+{
+	return static_cast<int>(std::upper_bound(p->low + 1, p->low + p->n, x, entryLess) - p->low) - 1;
+}
+
+void destroy(Node* node)
+{
+	if (!node->leaf)
+	{
+		Inner* p = static_cast<Inner*>(node);
+		for (int i = 0; i < p->n; ++i) destroy(p->child[i]);
+		delete p;
+	}
+	else delete static_cast<Leaf*>(node);
+}
+}
+
+//-----------------------------------------------------------
+// лічильне B+-дерево пар (значення, фігура)
+
+class MetricIndex::Tree
+{
+public:
+	Tree() : root(newLeaf()), total(0) { head = tail = static_cast<Leaf*>(root); }
+	~Tree() { destroy(root); }
+	size_t size() const { return total; }
+
+	void insert(const Entry& x);
+	// false, якщо такої пари немає
+	bool erase(const Entry& x);
+	// вилучає пару фігури, шукаючи її серед усіх; для фігур, змінених на місці
+	bool eraseShape(const VolShape* v);
+	void clear();
+	// замінює вміст дерева парами entries
+	void build(std::vector<Entry>& entries);
+	void append(std::vector<Entry>& out) const;
+	void rebase(std::uintptr_t first, std::uintptr_t last, std::ptrdiff_t delta);
+
+	// кількість пар зі значенням, меншим за key (upper = false) або не більшим (upper = true),
+	// і листок з номером першої пари після них
+	size_t bound(double key, bool upper, const Leaf*& leaf, int& i) const;
+	// пара з рангом r < size()
+	const Entry& select(size_t r) const;
+	const Leaf* first() const { return head; }
+	const Leaf* last() const { return tail; }
+private:
+	Node* insertInto(Node* node, const Entry& x);
+	bool eraseFrom(Node* node, const Entry& x);
+	void rebalance(Inner* p, int i);
+	void rebalanceLeaves(Inner* p, int l);
+	void rebalanceInners(Inner* p, int l);
+	static void rebase(Node* node, std::uintptr_t first, std::uintptr_t last, std::ptrdiff_t delta);
+
+	Node* root;
+	Leaf* head;
+	Leaf* tail;
+	size_t total;
+};
+
+void MetricIndex::Tree::insert(const Entry& x)
+{
+	Node* right = insertInto(root, x);
+	++total;
+	if (right == nullptr) return;
+	Inner* p = newInner();
+	p->n = 2;
+	p->child[0] = root;
+	p->child[1] = right;
+	p->low[0] = minOf(root);
+	p->low[1] = minOf(right);
+	p->sizes[0] = sizeOf(root);
+	p->sizes[1] = sizeOf(right);
+	root = p;
+}
+
+Node* MetricIndex::Tree::insertInto(Node* node, const Entry& x)
+{
+	if (node->leaf)
+	{
+		Leaf* l = static_cast<Leaf*>(node);
+		Entry* pos = std::upper_bound(l->e, l->e + l->n, x, entryLess);
+		std::copy_backward(pos, l->e + l->n, l->e + l->n + 1);
+		*pos = x;
+		if (++l->n <= LEAF_MAX) return nullptr;
+		// переповнений листок ділиться навпіл
+		Leaf* r = newLeaf();
+		const int half = l->n / 2;
+		r->n = l->n - half;
+		std::copy(l->e + half, l->e + l->n, r->e);
+		l->n = half;
+		r->prev = l;
+		r->next = l->next;
+		if (r->next != nullptr) r->next->prev = r;
+		else tail = r;
+		l->next = r;
+		return r;
+	}
+	Inner* p = static_cast<Inner*>(node);
+	const int i = childFor(p, x);
+	Node* right = insertInto(p->child[i], x);
+	++p->sizes[i];
+	if (entryLess(x, p->low[i])) p->low[i] = x;
+	if (right == nullptr) return nullptr;
+	// нащадок поділився: праву половину вставляємо за ним
+	for (int j = p->n; j > i + 1; --j)
+	{
+		p->child[j] = p->child[j - 1];
+		p->low[j] = p->low[j - 1];
+		p->sizes[j] = p->sizes[j - 1];
+	}
+	p->child[i + 1] = right;
+	p->low[i + 1] = minOf(right);
+	p->sizes[i + 1] = sizeOf(right);
+	p->sizes[i] -= p->sizes[i + 1];
+	if (++p->n <= INNER_MAX) return nullptr;
+	Inner* r = newInner();
+	const int half = p->n / 2;
+	r->n = p->n - half;
+	std::copy(p->child + half, p->child + p->n, r->child);
+	std::copy(p->low + half, p->low + p->n, r->low);
+	std::copy(p->sizes + half, p->sizes + p->n, r->sizes);
+	p->n = half;
+	return r;
+}
+
+bool MetricIndex::Tree::erase(const Entry& x)
+{
+	if (!eraseFrom(root, x)) return false;
+	--total;
+	// корінь з одним нащадком не потрібен
+	while (!root->leaf && root->n == 1)
+	{
+		Inner* p = static_cast<Inner*>(root);
+		root = p->child[0];
+		delete p;
+	}
+	return true;
+}
+
+bool MetricIndex::Tree::eraseFrom(Node* node, const Entry& x)
+{
+	if (node->leaf)
+	{
+		Leaf* l = static_cast<Leaf*>(node);
+		Entry* pos = std::lower_bound(l->e, l->e + l->n, x, entryLess);
+		if (pos == l->e + l->n || pos->shape != x.shape) return false;
+		std::copy(pos + 1, l->e + l->n, pos);
+		--l->n;
+		return true;
+	}
+	Inner* p = static_cast<Inner*>(node);
+	const int i = childFor(p, x);
+	if (!eraseFrom(p->child[i], x)) return false;
+	--p->sizes[i];
+	Node* c = p->child[i];
+	if (c->n > 0) p->low[i] = minOf(c);
+	if (c->n < (c->leaf ? LEAF_MIN : INNER_MIN) && p->n > 1) rebalance(p, i);
+	return true;
+}
+
+void MetricIndex::Tree::rebalance(Inner* p, int i)
+{
+	// недобір нащадка i закривається разом з лівим сусідом, а в першого - з правим
+	const int l = i > 0 ? i - 1 : i;
+	if (p->child[l]->leaf) rebalanceLeaves(p, l);
+	else rebalanceInners(p, l);
+}
+
+void MetricIndex::Tree::rebalanceLeaves(Inner* p, int l)
+{
+	Leaf* a = static_cast<Leaf*>(p->child[l]);
+	Leaf* b = static_cast<Leaf*>(p->child[l + 1]);
+	if (a->n + b->n <= LEAF_MAX)
+	{
+		std::copy(b->e, b->e + b->n, a->e + a->n);
+		a->n += b->n;
+		a->next = b->next;
+		if (a->next != nullptr) a->next->prev = a;
+		else tail = a;
+		delete b;
+		p->low[l] = minOf(a);
+		p->sizes[l] += p->sizes[l + 1];
+		for (int j = l + 1; j + 1 < p->n; ++j)
+		{
+			p->child[j] = p->child[j + 1];
+			p->low[j] = p->low[j + 1];
+			p->sizes[j] = p->sizes[j + 1];
+		}
+		--p->n;
+		return;
+	}
+	// розподіляємо порівну
+	const int want = (a->n + b->n) / 2;
+	if (a->n > want)
+	{
+		const int m = a->n - want;
+		std::copy_backward(b->e, b->e + b->n, b->e + b->n + m);
+		std::copy(a->e + want, a->e + a->n, b->e);
+		a->n = want;
+		b->n += m;
+	}
+	else
+	{
+		const int m = want - a->n;
+		std::copy(b->e, b->e + m, a->e + a->n);
+		std::copy(b->e + m, b->e + b->n, b->e);
+		a->n = want;
+		b->n -= m;
+	}
+	p->sizes[l] = a->n;
+	p->sizes[l + 1] = b->n;
+	p->low[l] = a->e[0];
+	p->low[l + 1] = b->e[0];
+}
+
+void MetricIndex::Tree::rebalanceInners(Inner* p, int l)
+{
+	Inner* a = static_cast<Inner*>(p->child[l]);
+	Inner* b = static_cast<Inner*>(p->child[l + 1]);
+	if (a->n + b->n <= INNER_MAX)
+	{
+		std::copy(b->child, b->child + b->n, a->child + a->n);
+		std::copy(b->low, b->low + b->n, a->low + a->n);
+		std::copy(b->sizes, b->sizes + b->n, a->sizes + a->n);
+		a->n += b->n;
+		delete b;
+		p->low[l] = minOf(a);
+		p->sizes[l] += p->sizes[l + 1];
+		for (int j = l + 1; j + 1 < p->n; ++j)
+		{
+			p->child[j] = p->child[j + 1];
+			p->low[j] = p->low[j + 1];
+			p->sizes[j] = p->sizes[j + 1];
+		}
+		--p->n;
+		return;
+	}
+	const int want = (a->n + b->n) / 2;
+	if (a->n > want)
+	{
+		const int m = a->n - want;
+		std::copy_backward(b->child, b->child + b->n, b->child + b->n + m);
+		std::copy_backward(b->low, b->low + b->n, b->low + b->n + m);
+		std::copy_backward(b->sizes, b->sizes + b->n, b->sizes + b->n + m);
+		std::copy(a->child + want, a->child + a->n, b->child);
+		std::copy(a->low + want, a->low + a->n, b->low);
+		std::copy(a->sizes + want, a->sizes + a->n, b->sizes);
+		a->n = want;
+		b->n += m;
+	}
+	else
+	{
+		const int m = want - a->n;
+		std::copy(b->child, b->child + m, a->child + a->n);
+		std::copy(b->low, b->low + m, a->low + a->n);
+		std::copy(b->sizes, b->sizes + m, a->sizes + a->n);
+		std::copy(b->child + m, b->child + b->n, b->child);
+		std::copy(b->low + m, b->low + b->n, b->low);
+		std::copy(b->sizes + m, b->sizes + b->n, b->sizes);
+		a->n = want;
+		b->n -= m;
+	}
+	p->sizes[l] = sizeOf(a);
+	p->sizes[l + 1] = sizeOf(b);
+	p->low[l] = a->low[0];
+	p->low[l + 1] = b->low[0];
+}
+
+bool MetricIndex::Tree::eraseShape(const VolShape* v)
+{
+	for (const Leaf* l = head; l != nullptr; l = l->next)
+		for (int i = 0; i < l->n; ++i)
+			if (l->e[i].shape == v)
+			{
+				const Entry x = l->e[i];
+				return erase(x);
+			}
+	return false;
+}
+
+void MetricIndex::Tree::clear()
+{
+	destroy(root);
+	root = head = tail = newLeaf();
+	total = 0;
+}
+
+void MetricIndex::Tree::build(std::vector<Entry>& entries)
+{
+	std::sort(entries.begin(), entries.end(), entryLess);
+	destroy(root);
+	total = entries.size();
+	// листки заповнюються рівномірно на три чверті, щоб наступні вставки не ділили їх одразу
+	const size_t fill = LEAF_MAX * 3 / 4;
+	std::vector<Node*> level((entries.size() + fill - 1) / fill);
+	if (level.empty())
+	{
+		root = head = tail = newLeaf();
+		return;
+	}
+	Leaf* prev = nullptr;
+	for (size_t k = 0; k < level.size(); ++k)
+	{
+		Leaf* l = newLeaf();
+		const size_t from = entries.size() * k / level.size(), to = entries.size() * (k + 1) / level.size();
+		std::copy(entries.begin() + from, entries.begin() + to, l->e);
+		l->n = static_cast<int>(to - from);
+		l->prev = prev;
+		if (prev != nullptr) prev->next = l;
+		else head = l;
+		prev = l;
+		level[k] = l;
+	}
+	tail = prev;
+	// внутрішні рівні - так само рівномірно, поки не залишиться один вузол
+	const size_t fanout = INNER_MAX * 3 / 4;
+	while (level.size() > 1)
+	{
+		std::vector<Node*> upper((level.size() + fanout - 1) / fanout);
+		for (size_t k = 0; k < upper.size(); ++k)
+		{
+			Inner* p = newInner();
+			const size_t from = level.size() * k / upper.size(), to = level.size() * (k + 1) / upper.size();
+			for (size_t j = from; j < to; ++j)
+			{
+				p->child[p->n] = level[j];
+				p->low[p->n] = minOf(level[j]);
+				p->sizes[p->n] = sizeOf(level[j]);
+				++p->n;
+			}
+			upper[k] = p;
+		}
+		level.swap(upper);
+	}
+	root = level[0];
+}
+
+void MetricIndex::Tree::append(std::vector<Entry>& out) const
+{
+	for (const Leaf* l = head; l != nullptr; l = l->next) out.insert(out.end(), l->e, l->e + l->n);
+}
+
+void MetricIndex::Tree::rebase(std::uintptr_t first, std::uintptr_t last, std::ptrdiff_t delta)
+{
+	rebase(root, first, last, delta);
+}
+
+void MetricIndex::Tree::rebase(Node* node, std::uintptr_t first, std::uintptr_t last, std::ptrdiff_t delta)
+{
+	// перенесені фігури зберігають взаємний порядок, тож дерево не перебудовується
+	Entry* e;
+	if (node->leaf) e = static_cast<Leaf*>(node)->e;
+	else
+	{
+		Inner* p = static_cast<Inner*>(node);
+		for (int i = 0; i < p->n; ++i) rebase(p->child[i], first, last, delta);
+		e = p->low;
+	}
+	for (int i = 0; i < node->n; ++i)
+	{
+		const std::uintptr_t a = reinterpret_cast<std::uintptr_t>(e[i].shape);
+		if (a >= first && a <= last) e[i].shape = reinterpret_cast<const VolShape*>(a + delta);
+	}
+}
+
+size_t MetricIndex::Tree::bound(double key, bool upper, const Leaf*& leaf, int& i) const
+{
+	size_t rank = 0;
+	const Node* node = root;
+	while (!node->leaf)
+	{
+		const Inner* p = static_cast<const Inner*>(node);
+		// останнє піддерево, що може містити пари до межі
+		int c = 0;
+		while (c + 1 < p->n && (upper ? !keyLess(key, p->low[c + 1].key) : keyLess(p->low[c + 1].key, key)))
+			rank += p->sizes[c++];
+		node = p->child[c];
+	}
+	const Leaf* l = static_cast<const Leaf*>(node);
+	int k = 0;
+	while (k < l->n && (upper ? !keyLess(key, l->e[k].key) : keyLess(l->e[k].key, key))) ++k;
+	rank += k;
+	if (k == l->n && l->next != nullptr)
+	{
+		l = l->next;
+		k = 0;
+	}
+	leaf = l;
+	i = k;
+	return rank;
+}
+
+const Entry& MetricIndex::Tree::select(size_t r) const
+{
+	const Node* node = root;
+	while (!node->leaf)
+	{
+		const Inner* p = static_cast<const Inner*>(node);
+		int c = 0;
+		while (r >= p->sizes[c])
+			r -= p->sizes[c++];
+		node = p->child[c];
+	}
+	return static_cast<const Leaf*>(node)->e[r];
+}
+
+//-----------------------------------------------------------
+
+MetricIndex::MetricIndex(unsigned metrics)
+{
+	for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+		trees[m] = metrics & (1u << m) ? new Tree : nullptr;
+}
+
+MetricIndex::~MetricIndex()
+{
+	for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m) delete trees[m];
+}
+
+const MetricIndex::Tree& MetricIndex::tree(ShapeBatch::Metric m) const
+{
+	if (m < 0 || m >= ShapeBatch::METRIC_COUNT || trees[m] == nullptr)
+		throw std::invalid_argument("Error: Metric is not indexed\n");
+	return *trees[m];
+}
+
+size_t MetricIndex::size() const
+{
+	for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+		if (trees[m] != nullptr) return trees[m]->size();
+	return 0;
+}
+
+size_t MetricIndex::count(ShapeBatch::Metric m, double lo, double hi) const
+{
+	const Tree& t = tree(m);
+	if (keyLess(hi, lo)) return 0;
+	const Leaf* l;
+	int i;
+	return t.bound(hi, true, l, i) - t.bound(lo, false, l, i);
+}
+
+std::vector<const VolShape*> MetricIndex::range(ShapeBatch::Metric m, double lo, double hi) const
+{
+	const Tree& t = tree(m);
+	std::vector<const VolShape*> out;
+	if (keyLess(hi, lo)) return out;
+	const Leaf* l;
+	int i;
+	const size_t from = t.bound(lo, false, l, i);
+	const Leaf* stop;
+	int end;
+	const size_t n = t.bound(hi, true, stop, end) - from;
+	out.reserve(n);
+	for (; out.size() < n; i = 0, l = l->next)
+		for (; i < l->n && out.size() < n; ++i) out.push_back(l->e[i].shape);
+	return out;
+}
+
+std::vector<const VolShape*> MetricIndex::top(ShapeBatch::Metric m, size_t k) const
+{
+	const Tree& t = tree(m);
+	std::vector<const VolShape*> out;
+	out.reserve(std::min(k, t.size()));
+	for (const Leaf* l = t.last(); l != nullptr && out.size() < k; l = l->prev)
+		for (int i = l->n; i > 0 && out.size() < k; --i) out.push_back(l->e[i - 1].shape);
+	return out;
+}
+
+std::vector<const VolShape*> MetricIndex::bottom(ShapeBatch::Metric m, size_t k) const
+{
+	const Tree& t = tree(m);
+	std::vector<const VolShape*> out;
+	out.reserve(std::min(k, t.size()));
+	for (const Leaf* l = t.first(); l != nullptr && out.size() < k; l = l->next)
+		for (int i = 0; i < l->n && out.size() < k; ++i) out.push_back(l->e[i].shape);
+	return out;
+}
+
+const VolShape* MetricIndex::nth(ShapeBatch::Metric m, size_t r) const
+{
+	const Tree& t = tree(m);
+	if (r >= t.size())
+		throw std::out_of_range("Error: Cannot get element at specified position\n");
+	return t.select(r).shape;
+}
+
+//-----------------------------------------------------------
+
+void MetricIndex::added(const VolShape& v)
+{
+	for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+		if (trees[m] != nullptr)
+		{
+			const Entry x = { metricOf(v, static_cast<ShapeBatch::Metric>(m)), &v };
+			trees[m]->insert(x);
+		}
+}
+
+void MetricIndex::removed(const VolShape& v)
+{
+	for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+		if (trees[m] != nullptr)
+		{
+			const Entry x = { metricOf(v, static_cast<ShapeBatch::Metric>(m)), &v };
+			if (!trees[m]->erase(x)) trees[m]->eraseShape(&v);
+		}
+}
+
+void MetricIndex::cleared()
+{
+	for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+		if (trees[m] != nullptr) trees[m]->clear();
+}
+
+void MetricIndex::attached(const std::vector<const VolShape*>& shapes)
+{
+	for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+		if (trees[m] != nullptr)
+		{
+			// невелику добавку вигідніше вставити, велику - перебудувати все дерево
+			if (shapes.size() < trees[m]->size())
+			{
+				for (size_t i = 0; i < shapes.size(); ++i)
+				{
+					const Entry x = { metricOf(*shapes[i], static_cast<ShapeBatch::Metric>(m)), shapes[i] };
+					trees[m]->insert(x);
+				}
+				continue;
+			}
+			std::vector<Entry> entries;
+			entries.reserve(trees[m]->size() + shapes.size());
+			trees[m]->append(entries);
+			for (size_t i = 0; i < shapes.size(); ++i)
+			{
+				const Entry x = { metricOf(*shapes[i], static_cast<ShapeBatch::Metric>(m)), shapes[i] };
+				entries.push_back(x);
+			}
+			trees[m]->build(entries);
+		}
+}
+
+void MetricIndex::moved(const VolShape* first, const VolShape* last, std::ptrdiff_t delta)
+{
+	for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+		if (trees[m] != nullptr)
+			trees[m]->rebase(reinterpret_cast<std::uintptr_t>(first), reinterpret_cast<std::uintptr_t>(last), delta);
+}
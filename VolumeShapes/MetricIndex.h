@@ -0,0 +1,68 @@
+/*
+Вторинний індекс фігур за обчислюваними характеристиками. findFirst_if
+  переглядає весь контейнер, а типові запити - "усі фігури з об'ємом від X до
+  Y", "100 найбільших за площею поверхні" - індекс виконує за O(log n + k).
+
+Для кожної обраної характеристики (ShapeBatch::Metric) індекс тримає лічильне
+  B+-дерево пар (значення, адреса фігури), впорядкованих за значенням. Листки
+  по 64 пари зв'язані в список, тож діапазон і top-k читаються підряд з
+  листків; внутрішні вузли знають кількість пар у кожному піддереві, тож
+  кількість фігур у діапазоні і фігура з заданим рангом знаходяться без обходу.
+
+Індекс - спостерігач контейнера (ShapeObserver): після list.attach(&index)
+ кожне addtoEnd, insert, remove, removeAll і присвоєння оновлює його за
+ O(log n). Перенесення фігур ShapeVector при вставці й вилученні посередині
+ коштує індексові O(n) - стільки ж, скільки й сам зсув хвоста вектора.
+
+Значення характеристики обчислюється один раз при додаванні. Фігуру, змінену
+ на місці (через operator[] чи getShape), індекс не помітить - її треба
+ вилучити і вставити знову.
+
+Результати запитів - адреси фігур у контейнері; вони дійсні до наступної зміни
+ контейнера.
+*/
+#ifndef _MetricIndexHeader_
+#define _MetricIndexHeader_
+
+#include "ShapeBatch.h"
+#include "ShapeObserver.h"
+#include <vector>
+
+class MetricIndex : public ShapeObserver
+{
+public:
+	// набір характеристик - бітова маска з 1 << ShapeBatch::Metric
+	static const unsigned ALL = (1u << ShapeBatch::METRIC_COUNT) - 1;
+	explicit MetricIndex(unsigned metrics = ALL);
+	~MetricIndex();
+
+	bool indexed(ShapeBatch::Metric m) const { return trees[m] != nullptr; }
+	size_t size() const;
+
+	// запити до неіндексованої характеристики кидають std::invalid_argument
+	// кількість фігур із значенням у межах [lo, hi]; O(log n)
+	size_t count(ShapeBatch::Metric m, double lo, double hi) const;
+	// фігури із значенням у межах [lo, hi] за зростанням значення
+	std::vector<const VolShape*> range(ShapeBatch::Metric m, double lo, double hi) const;
+	// k фігур з найбільшим значенням за спаданням і з найменшим - за зростанням
+	std::vector<const VolShape*> top(ShapeBatch::Metric m, size_t k) const;
+	std::vector<const VolShape*> bottom(ShapeBatch::Metric m, size_t k) const;
+	// фігура з рангом r (0 - з найменшим значенням); std::out_of_range, якщо r >= size()
+	const VolShape* nth(ShapeBatch::Metric m, size_t r) const;
+
+	virtual void added(const VolShape& v) override;
+	virtual void removed(const VolShape& v) override;
+	virtual void cleared() override;
+	virtual void moved(const VolShape* first, const VolShape* last, std::ptrdiff_t delta) override;
+	// наявні фігури сортуються і складаються в дерево знизу вгору, а не вставляються по одній
+	virtual void attached(const std::vector<const VolShape*>& shapes) override;
+private:
+	MetricIndex(const MetricIndex&);
+	MetricIndex& operator=(const MetricIndex&);
+
+	class Tree;
+	const Tree& tree(ShapeBatch::Metric m) const;
+	Tree* trees[ShapeBatch::METRIC_COUNT];
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*
+Паралельні обходи набору фігур на ThreadPool. На відміну від ForEach, що
+  приймає лише вказівник на функцію, сюди передаються лямбди чи функтори з
+  власним станом.
+
+Детермінованість. Фігури діляться на шматки по GRAIN штук незалежно від
+  кількості потоків. parallel_reduce і parallel_fold згортають кожен шматок зліва направо, а
+  часткові результати шматків - попарним деревом фіксованої форми. Тому
+  результат залежить лише від кількості фігур, а не від кількості потоків чи
+  того, хто який шматок виконав: суми однакові до останнього біта і на
+  ThreadPool(1), і на 64 потоках. Суми площ та об'ємів до того ж ведуться
+  з компенсацією похибки (CompensatedSum).
+
+LinkedList не має доступу за номером, тому для нього спочатку послідовно
+ збирається масив вказівників на фігури.
+
+Тіло обходу виконується в кількох потоках одночасно: воно не повинне створювати
+ чи знищувати фігури з пулом ShapeArena (пули не синхронізовані) і не повинне
+ змінювати сам контейнер.
+*/
+#ifndef _ParallelHeader_
+#define _ParallelHeader_
+
+#include "ShapeVector.h"
+#include "ShapeBatch.h"
+#include "ThreadPool.h"
+#include <array>
+#include <cmath>
+#include <vector>
+
+// сума з компенсацією похибки округлення (алгоритм Ноймаєра)
+struct CompensatedSum
+{
+	double sum;
+	double error;
+	CompensatedSum(double x = 0.) : sum(x), error(0.) {}
+	CompensatedSum& operator+=(double x)
+	{
+		const double t = sum + x;
+		if (std::fabs(sum) >= std::fabs(x)) error += (sum - t) + x;
+		else error += (x - t) + sum;
+		sum = t;
+		return *this;
+	}
+	CompensatedSum& operator+=(const CompensatedSum& o)
+	{
+		*this += o.sum;
+		error += o.error;
+		return *this;
+	}
+	double value() const { return sum + error; }
+};
+
+namespace parallel_detail
+{
+// розмір шматка; від нього, а не від кількості потоків, залежить порядок сумування
+const size_t GRAIN = 4096;
+
+inline size_t chunks(size_t n) { return (n + GRAIN - 1) / GRAIN; }
+
+// at(i) - i-та фігура контейнера
+template<class At, class F>
+void forEach(size_t n, At at, F& f, ThreadPool& pool)
+{
+	pool.run(chunks(n), [&](size_t c)
+	{
+		const size_t to = (c + 1) * GRAIN < n ? (c + 1) * GRAIN : n;
+		for (size_t i = c * GRAIN; i < to; ++i) f(at(i));
+	});
+}
+
+// часткові результати part[from..to) згортаються попарно: (01)(23) -> (0123)
+template<class T, class Combine>
+T combineTree(std::vector<T>& part, size_t from, size_t to, Combine& combine)
+{
+	if (to - from == 1) return part[from];
+	const size_t mid = from + (to - from) / 2;
+	T left = combineTree(part, from, mid, combine);
+	return combine(left, combineTree(part, mid, to, combine));
+}
+
+// кожен шматок накопичується в окремій копії identity через add(T&, фігура),
+// далі копії згортаються деревом
+template<class At, class T, class Add, class Combine>
+T fold(size_t n, At at, const T& identity, Add& add, Combine& combine, ThreadPool& pool)
+{
+	if (n == 0) return identity;
+	std::vector<T> part(chunks(n), identity);
+	pool.run(part.size(), [&](size_t c)
+	{
+		const size_t to = (c + 1) * GRAIN < n ? (c + 1) * GRAIN : n;
+		T& acc = part[c];
+		for (size_t i = c * GRAIN; i < to; ++i) add(acc, at(i));
+	});
+	return combineTree(part, 0, part.size(), combine);
+}
+
+template<class At, class T, class Map, class Combine>
+T reduce(size_t n, At at, const T& identity, Map& map, Combine& combine, ThreadPool& pool)
+{
+	auto add = [&map, &combine](T& acc, const VolShape& v) { acc = combine(acc, map(v)); };
+	return fold(n, at, identity, add, combine, pool);
+}
+
+inline std::vector<VolShape*> gather(const LinkedList& list)
+{
+	std::vector<VolShape*> all;
+	for (const LinkedList::Node* p = list.first(); p != nullptr; p = p->next) all.push_back(p->data);
+	return all;
+}
+}
+
+//-----------------------------------------------------------
+// f(VolShape&) для кожної фігури
+
+template<class F>
+void parallel_for_each(ShapeVector& v, F f, ThreadPool& pool = ThreadPool::shared())
+{
+	parallel_detail::forEach(v.size(), [&v](size_t i) -> VolShape& { return v[static_cast<int>(i)]; }, f, pool);
+}
+
+template<class F>
+void parallel_for_each(const ShapeVector& v, F f, ThreadPool& pool = ThreadPool::shared())
+{
+	parallel_detail::forEach(v.size(), [&v](size_t i) -> const VolShape& { return v[static_cast<int>(i)]; }, f, pool);
+}
+
+template<class F>
+void parallel_for_each(const LinkedList& list, F f, ThreadPool& pool = ThreadPool::shared())
+{
+	const std::vector<VolShape*> all = parallel_detail::gather(list);
+	parallel_detail::forEach(all.size(), [&all](size_t i) -> VolShape& { return *all[i]; }, f, pool);
+}
+
+//-----------------------------------------------------------
+// згортка combine(..., map(фігура)); combine має бути асоціативною,
+// identity - її нейтральним елементом
+
+template<class T, class Map, class Combine>
+T parallel_reduce(const ShapeVector& v, T identity, Map map, Combine combine, ThreadPool& pool = ThreadPool::shared())
+{
+	return parallel_detail::reduce(v.size(), [&v](size_t i) -> const VolShape& { return v[static_cast<int>(i)]; },
+		identity, map, combine, pool);
+}
+
+template<class T, class Map, class Combine>
+T parallel_reduce(const LinkedList& list, T identity, Map map, Combine combine, ThreadPool& pool = ThreadPool::shared())
+{
+	const std::vector<VolShape*> all = parallel_detail::gather(list);
+	return parallel_detail::reduce(all.size(), [&all](size_t i) -> const VolShape& { return *all[i]; },
+		identity, map, combine, pool);
+}
+
+// те саме, але кожен шматок накопичується на місці: add(T& acc, фігура) додає
+// фігуру до acc, combine(T, T) поєднує результати шматків. Зручно, коли
+// створювати T для кожної фігури задорого
+
+template<class T, class Add, class Combine>
+T parallel_fold(const ShapeVector& v, T identity, Add add, Combine combine, ThreadPool& pool = ThreadPool::shared())
+{
+	return parallel_detail::fold(v.size(), [&v](size_t i) -> const VolShape& { return v[static_cast<int>(i)]; },
+		identity, add, combine, pool);
+}
+
+template<class T, class Add, class Combine>
+T parallel_fold(const LinkedList& list, T identity, Add add, Combine combine, ThreadPool& pool = ThreadPool::shared())
+{
+	const std::vector<VolShape*> all = parallel_detail::gather(list);
+	return parallel_detail::fold(all.size(), [&all](size_t i) -> const VolShape& { return *all[i]; },
+		identity, add, combine, pool);
+}
+
+//-----------------------------------------------------------
+// готові суми; Shapes - ShapeVector або LinkedList
+
+template<class Shapes>
+double parallel_sum(const Shapes& shapes, ShapeBatch::Metric m, ThreadPool& pool = ThreadPool::shared())
+{
+	return parallel_fold(shapes, CompensatedSum(),
+		[m](CompensatedSum& s, const VolShape& v) { s += metricOf(v, m); },
+		[](CompensatedSum a, const CompensatedSum& b) { return a += b; }, pool).value();
+}
+
+template<class Shapes>
+double totalVolume(const Shapes& shapes, ThreadPool& pool = ThreadPool::shared())
+{
+	return parallel_sum(shapes, ShapeBatch::VOLUME, pool);
+}
+
+template<class Shapes>
+double totalSurfaceArea(const Shapes& shapes, ThreadPool& pool = ThreadPool::shared())
+{
+	return parallel_sum(shapes, ShapeBatch::SURFACE_AREA, pool);
+}
+
+// сума характеристики окремо для кожного класу, в порядку ShapeBatch::Kind
+template<class Shapes>
+std::array<double, ShapeBatch::KIND_COUNT> sumByKind(const Shapes& shapes, ShapeBatch::Metric m,
+	ThreadPool& pool = ThreadPool::shared())
+{
+	typedef std::array<CompensatedSum, ShapeBatch::KIND_COUNT> Sums;
+	const Sums sums = parallel_fold(shapes, Sums(),
+		[m](Sums& s, const VolShape& v)
+		{
+			const int k = ShapeBatch::kindOf(v);
+			if (k >= 0) s[k] += metricOf(v, m);
+		},
+		[](Sums a, const Sums& b)
+		{
+			for (size_t k = 0; k < a.size(); ++k) a[k] += b[k];
+			return a;
+		}, pool);
+	std::array<double, ShapeBatch::KIND_COUNT> out;
+	for (size_t k = 0; k < out.size(); ++k) out[k] = sums[k].value();
+	return out;
+}
+
+#endif
@@ -0,0 +1,184 @@
+#include "ParallelLoader.h"
+#include "ShapeReader.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+// шматків на кожен потік пулу в одній хвилі: запас для вирівнювання навантаження
+const size_t WAVE = 4;
+
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+// початок першого після p рядка, перше слово якого - ім'я зареєстрованого класу
+const char* recordStart(const char* p, const char* end)
+{
+	while (p < end)
+	{
+		const void* nl = std::memchr(p, '\n', end - p);
+		if (nl == nullptr) return end;
+		p = static_cast<const char*>(nl) + 1;
+		const char* b = p;
+		while (b < end && isBlank(*b)) ++b;
+		const char* e = b;
+		while (e < end && !isBlank(*e) && *e != '\n') ++e;
+		if (e != b && VolShapeRegistry::find(b, e - b) != nullptr) return p;
+	}
+	return end;
+}
+
+// читає наступний запис і додає фігуру в part; false - текст закінчився
+bool addNext(ShapeReader& in, ShapeVector& part)
+{
+	ShapeRecord r;
+	std::unique_ptr<VolShape> other;
+	// фігури класів поза вбудованими створюються в пулі шматка, якщо він є
+	ShapeArena::Scope scope(part.arena());
+	if (!in.next(r, other)) return false;
+	if (other != nullptr) part.addtoEnd(std::move(other));
+	else r.addTo(part);
+	return true;
+}
+
+bool addNext(ShapeReader& in, ShapeBatch& part)
+{
+	ShapeRecord r;
+	if (!in.next(r)) return false;
+	r.addTo(part);
+	return true;
+}
+
+void reserve(ShapeVector& v, size_t n)
+{
+	v.reserve(v.size() + n);
+}
+
+// розподіл за класами наперед невідомий
+void reserve(ShapeBatch&, size_t)
+{
+}
+
+void merge(ShapeVector& out, std::vector<ShapeVector>& parts, ThreadPool& pool)
+{
+	out.append(parts, pool);
+}
+
+void merge(ShapeBatch& out, std::vector<ShapeBatch>& parts, ThreadPool&)
+{
+	for (size_t k = 0; k < parts.size(); ++k)
+	{
+		out.append(parts[k]);
+		parts[k].clear();
+	}
+}
+}
+
+ParallelLoader::ParallelLoader(ThreadPool& pool, size_t chunkBytes)
+	: pool(pool), chunkBytes(chunkBytes == 0 ? DEFAULT_CHUNK : chunkBytes)
+{
+}
+
+size_t ParallelLoader::split(const char* begin, const char* end, Report& report, std::vector<Chunk>& chunks) const
+{
+	ShapeReader head(begin, end);
+	long long n;
+	report.declared = head.readCount(n) ? n : -1;
+	const char* from = head.position();
+	while (from < end)
+	{
+		const char* to = static_cast<size_t>(end - from) > chunkBytes ? recordStart(from + chunkBytes, end) : end;
+		Chunk c = { from, to, 0, 0, std::vector<Error>() };
+		chunks.push_back(c);
+		from = to;
+	}
+	report.chunks = chunks.size();
+	return head.line();
+}
+
+template<class Out> void ParallelLoader::parse(Chunk& c, size_t index, Out& part)
+{
+	// номери рядків відносні; в абсолютні їх переводить run, коли відомі попередні шматки
+	ShapeReader in(c.begin, c.end);
+	for (;;)
+	{
+		try
+		{
+			if (!addNext(in, part)) break;
+			++c.loaded;
+		}
+		catch (VolShape::BadClassname& e)
+		{
+			Error err = { index, in.recordLine(), true, e.what() };
+			c.errors.push_back(err);
+		}
+		catch (std::invalid_argument& e)
+		{
+			Error err = { index, in.recordLine(), false, e.what() };
+			c.errors.push_back(err);
+		}
+	}
+	c.lines = in.line() - 1;
+}
+
+template<class Out>
+ParallelLoader::Report ParallelLoader::run(const char* begin, const char* end, Out& out, std::vector<Out>& parts) const
+{
+	Report report = { 0, -1, 0, std::vector<Error>() };
+	std::vector<Chunk> chunks;
+	size_t line = split(begin, end, report, chunks);
+	const size_t declared = report.declared > 0 ? static_cast<size_t>(report.declared) : 0;
+	const double perByte = chunks.empty() ? 0. : static_cast<double>(declared) / (end - chunks.front().begin);
+	reserve(out, declared);
+	for (size_t from = 0; from < chunks.size(); from += parts.size())
+	{
+		const size_t n = std::min(parts.size(), chunks.size() - from);
+		pool.run(n, [&](size_t k)
+		{
+			Chunk& c = chunks[from + k];
+			reserve(parts[k], static_cast<size_t>(perByte * (c.end - c.begin)) + 16);
+			parse(c, from + k, parts[k]);
+		});
+		merge(out, parts, pool);
+		for (size_t k = 0; k < n; ++k)
+		{
+			Chunk& c = chunks[from + k];
+			for (size_t i = 0; i < c.errors.size(); ++i)
+			{
+				c.errors[i].line += line - 1;
+				report.errors.push_back(c.errors[i]);
+			}
+			report.loaded += c.loaded;
+			line += c.lines;
+			std::vector<Error>().swap(c.errors);
+		}
+	}
+	return report;
+}
+
+//-----------------------------------------------------------
+
+ParallelLoader::Report ParallelLoader::load(const char* begin, const char* end, ShapeVector& out) const
+{
+	// у POOLED кожен шматок має власний пул: пули не синхронізовані між потоками
+	std::vector<ShapeVector> parts(pool.size() * WAVE, ShapeVector(out.arena() != nullptr ? LinkedList::POOLED : LinkedList::HEAP));
+	return run(begin, end, out, parts);
+}
+
+ParallelLoader::Report ParallelLoader::load(const char* begin, const char* end, ShapeBatch& out) const
+{
+	std::vector<ShapeBatch> parts(pool.size() * WAVE);
+	return run(begin, end, out, parts);
+}
+
+ParallelLoader::Report ParallelLoader::load(const char* path, ShapeVector& out) const
+{
+	MappedFile file(path);
+	return load(file.data(), file.end(), out);
+}
+
+ParallelLoader::Report ParallelLoader::load(const char* path, ShapeBatch& out) const
+{
+	MappedFile file(path);
+	return load(file.data(), file.end(), out);
+}
@@ -0,0 +1,80 @@
+/*
+Паралельне завантаження великих файлів фігур. Навіть ShapeReader розбирає
+  текст в одному потоці; ParallelLoader ділить відображений файл на шматки
+  (по chunkBytes) і розбирає їх одночасно на ThreadPool, а потім переносить
+  результати в контейнер у початковому порядку.
+
+Шматки межують лише по початку запису: межа зсувається до найближчого рядка,
+ перше слово якого - ім'я зареєстрованого класу. Тому запис має займати один
+ рядок, як у volShapes.txt і як пише storeOn. Граматика та сама, що в
+ ShapeReader::next: ім'я класу, висота, параметри основи (з необов'язковою
+ літерою основи формату storeOn); класи, зареєстровані у VolShapeRegistry
+ поза шістьма вбудованими, читаються їхньою функцією make, як у MakeInstance.
+
+Помилковий запис пропускається, а в звіт потрапляють номер шматка, номер рядка
+ у файлі (з 1, з урахуванням усіх попередніх шматків) і повідомлення винятку.
+ Кількість фігур з першого рядка файла використовується, щоб наперед виділити
+ пам'ять контейнера і шматків.
+
+Щоб пам'ять на проміжні результати не залежала від розміру файла, шматки
+ обробляються хвилями по кілька на кожен потік пулу: хвиля розбирається
+ паралельно, переноситься в контейнер, і лише тоді починається наступна.
+ У ShapeVector фігури кожного шматка одразу створюються в окремому векторі
+ (з власним ShapeArena, якщо контейнер POOLED), а перенесення в контейнер
+ теж паралельне і не копіює основ (див. ShapeVector::append).
+*/
+#ifndef _ParallelLoaderHeader_
+#define _ParallelLoaderHeader_
+
+#include "ShapeVector.h"
+#include "ShapeBatch.h"
+#include "ThreadPool.h"
+#include <vector>
+
+class ParallelLoader
+{
+public:
+	struct Error
+	{
+		size_t chunk;
+		size_t line;          // номер рядка у файлі, з 1
+		bool badClassname;    // невідоме ім'я класу чи літера основи; інакше - погане число
+		string message;       // what() винятку
+	};
+	struct Report
+	{
+		size_t loaded;        // додано фігур
+		long long declared;   // кількість з першого рядка, -1 - якщо її немає
+		size_t chunks;
+		std::vector<Error> errors;
+	};
+
+	static const size_t DEFAULT_CHUNK = 4 << 20;
+	explicit ParallelLoader(ThreadPool& pool = ThreadPool::shared(), size_t chunkBytes = DEFAULT_CHUNK);
+
+	// кидає std::runtime_error, якщо файл не вдалося відкрити
+	Report load(const char* path, ShapeVector& out) const;
+	Report load(const char* path, ShapeBatch& out) const;
+	// те саме для тексту в пам'яті
+	Report load(const char* begin, const char* end, ShapeVector& out) const;
+	Report load(const char* begin, const char* end, ShapeBatch& out) const;
+private:
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+		size_t lines;     // символів '\n' у шматку
+		size_t loaded;
+		std::vector<Error> errors;
+	};
+	// ділить текст після рядка кількості на шматки; повертає номер першого рядка
+	size_t split(const char* begin, const char* end, Report& report, std::vector<Chunk>& chunks) const;
+	// розбирає шматок у part; номери рядків у помилках - від початку шматка
+	template<class Out> static void parse(Chunk& c, size_t index, Out& part);
+	template<class Out> Report run(const char* begin, const char* end, Out& out, std::vector<Out>& parts) const;
+
+	ThreadPool& pool;
+	size_t chunkBytes;
+};
+
+#endif
@@ -0,0 +1,434 @@
+#include "PersistentList.h"
+#include "ShapeWriter.h"
+#include <stdexcept>
+
+namespace
+{
+// найбільша кількість фігур у листку і дітей у внутрішньому вузлі; вузол,
+// заповнений менше ніж на чверть, об'єднується з сусіднім
+const size_t MAX_ENTRIES = 32;
+const size_t MIN_ENTRIES = MAX_ENTRIES / 4;
+}
+
+struct PersistentList::Node
+{
+	bool leaf;
+	size_t size;                 // фігур у піддереві
+	std::vector<Item> shapes;    // листок
+	std::vector<Ref> children;   // внутрішній вузол
+
+	size_t entries() const { return leaf ? shapes.size() : children.size(); }
+
+	static Ref makeLeaf(std::vector<Item>&& items)
+	{
+		std::shared_ptr<Node> n = std::make_shared<Node>();
+		n->leaf = true;
+		n->size = items.size();
+		n->shapes.swap(items);
+		return n;
+	}
+	static Ref makeInner(std::vector<Ref>&& kids)
+	{
+		std::shared_ptr<Node> n = std::make_shared<Node>();
+		n->leaf = false;
+		n->size = 0;
+		for (size_t i = 0; i < kids.size(); ++i) n->size += kids[i]->size;
+		n->children.swap(kids);
+		return n;
+	}
+
+	// вузол з першої половини записів; друга половина - в extra, якщо записів забагато
+	template<class T> static Ref split(std::vector<T>& all, Ref& extra, Ref (*make)(std::vector<T>&&))
+	{
+		if (all.size() <= MAX_ENTRIES)
+		{
+			extra = nullptr;
+			return make(std::move(all));
+		}
+		std::vector<T> tail(all.begin() + all.size() / 2, all.end());
+		all.resize(all.size() / 2);
+		extra = make(std::move(tail));
+		return make(std::move(all));
+	}
+
+	// дитина, в піддереві якої позиція i; i стає позицією в цьому піддереві.
+	// Позиція, що дорівнює size дитини (вставка в кінець), належить останній
+	static size_t locate(const Node& n, size_t& i)
+	{
+		size_t c = 0;
+		while (c + 1 < n.children.size() && i >= n.children[c]->size)
+		{
+			i -= n.children[c]->size;
+			++c;
+		}
+		return c;
+	}
+
+	static Ref insert(const Node& n, size_t i, const Item& v, Ref& extra)
+	{
+		if (n.leaf)
+		{
+			std::vector<Item> items;
+			items.reserve(n.shapes.size() + 1);
+			items.insert(items.end(), n.shapes.begin(), n.shapes.begin() + i);
+			items.push_back(v);
+			items.insert(items.end(), n.shapes.begin() + i, n.shapes.end());
+			return split(items, extra, makeLeaf);
+		}
+		const size_t c = locate(n, i);
+		std::vector<Ref> kids(n.children);
+		Ref more;
+		kids[c] = insert(*kids[c], i, v, more);
+		if (more != nullptr) kids.insert(kids.begin() + c + 1, more);
+		return split(kids, extra, makeInner);
+	}
+
+	// записи двох сусідніх вузлів одного рівня разом
+	static void merge(const Node& a, const Node& b, std::vector<Ref>& kids, size_t at)
+	{
+		Ref first, second;
+		if (a.leaf)
+		{
+			std::vector<Item> all(a.shapes);
+			all.insert(all.end(), b.shapes.begin(), b.shapes.end());
+			first = split(all, second, makeLeaf);
+		}
+		else
+		{
+			std::vector<Ref> all(a.children);
+			all.insert(all.end(), b.children.begin(), b.children.end());
+			first = split(all, second, makeInner);
+		}
+		kids[at] = first;
+		if (second != nullptr) kids[at + 1] = second;
+		else kids.erase(kids.begin() + at + 1);
+	}
+
+	static Ref remove(const Node& n, size_t i, Item& removed)
+	{
+		if (n.leaf)
+		{
+			removed = n.shapes[i];
+			std::vector<Item> items;
+			items.reserve(n.shapes.size() - 1);
+			items.insert(items.end(), n.shapes.begin(), n.shapes.begin() + i);
+			items.insert(items.end(), n.shapes.begin() + i + 1, n.shapes.end());
+			return makeLeaf(std::move(items));
+		}
+		const size_t c = locate(n, i);
+		std::vector<Ref> kids(n.children);
+		kids[c] = remove(*kids[c], i, removed);
+		if (kids[c]->entries() < MIN_ENTRIES && kids.size() > 1)
+		{
+			const size_t left = c + 1 < kids.size() ? c : c - 1;
+			merge(*kids[left], *kids[left + 1], kids, left);
+		}
+		return makeInner(std::move(kids));
+	}
+
+	template<class F> static bool each(const Node& n, F& f)
+	{
+		if (n.leaf)
+		{
+			for (size_t i = 0; i < n.shapes.size(); ++i)
+				if (!f(*n.shapes[i])) return false;
+			return true;
+		}
+		for (size_t i = 0; i < n.children.size(); ++i)
+			if (!each(*n.children[i], f)) return false;
+		return true;
+	}
+
+	template<class F> static void leaves(const Node& n, F& f)
+	{
+		if (n.leaf) f(n);
+		else for (size_t i = 0; i < n.children.size(); ++i) leaves(*n.children[i], f);
+	}
+
+	// вузли рівномірно, по MAX_ENTRIES/2 .. MAX_ENTRIES записів (менше - лише якщо всіх мало)
+	template<class T> static std::vector<Ref> pack(std::vector<T>& all, Ref (*make)(std::vector<T>&&))
+	{
+		const size_t groups = (all.size() + MAX_ENTRIES - 1) / MAX_ENTRIES;
+		std::vector<Ref> level;
+		level.reserve(groups);
+		size_t from = 0;
+		for (size_t g = 0; g < groups; ++g)
+		{
+			const size_t to = all.size() * (g + 1) / groups;
+			level.push_back(make(std::vector<T>(std::make_move_iterator(all.begin() + from),
+				std::make_move_iterator(all.begin() + to))));
+			from = to;
+		}
+		return level;
+	}
+};
+
+//-----------------------------------------------------------
+
+PersistentList::PersistentList(const PersistentList& other) : root(std::atomic_load(&other.root)), interning(nullptr)
+{
+}
+
+PersistentList::PersistentList(const LinkedList& list) : interning(nullptr)
+{
+	std::vector<Item> items;
+	for (const LinkedList::Node* curr = list.first(); curr != nullptr; curr = curr->next)
+		items.push_back(copyOf(*curr->data));
+	build(items);
+}
+
+PersistentList::PersistentList(const ShapeVector& shapes) : interning(nullptr)
+{
+	std::vector<Item> items;
+	items.reserve(shapes.size());
+	for (size_t i = 0; i < shapes.size(); ++i) items.push_back(copyOf(shapes[i]));
+	build(items);
+}
+
+PersistentList& PersistentList::operator=(const PersistentList& other)
+{
+	if (this == &other) return *this;
+	Ref fresh = std::atomic_load(&other.root);
+	if (fresh == root) return *this;
+	if (root != nullptr) observers.cleared();
+	publish(fresh);
+	if (!observers.empty() && root != nullptr)
+	{
+		auto notify = [this](const VolShape& v) { observers.added(v); return true; };
+		Node::each(*root, notify);
+	}
+	return *this;
+}
+
+void PersistentList::publish(Ref fresh)
+{
+	std::atomic_store(&root, fresh);
+}
+
+PersistentList::Item PersistentList::copyOf(const VolShape& v) const
+{
+	if (interning != nullptr) return interning->intern(v);
+	// фігура може пережити цей потік і його пул, тому - в купі
+	ShapeArena::Scope scope(nullptr);
+	return Item(VolShapeRegistry::type(v.typeTag()).copy(v));
+}
+
+PersistentList::Item PersistentList::adopt(std::unique_ptr<VolShape>& val) const
+{
+	if (interning != nullptr) return interning->intern(std::move(val));
+	if (!val->placedIn(nullptr)) return copyOf(*val);
+	return Item(std::move(val));
+}
+
+PersistentList::Item PersistentList::share(const Item& val) const
+{
+	if (!val->placedIn(nullptr)) return copyOf(*val);
+	return val;
+}
+
+void PersistentList::build(std::vector<Item>& items)
+{
+	if (items.empty()) return;
+	std::vector<Ref> level = Node::pack(items, Node::makeLeaf);
+	while (level.size() > 1) level = Node::pack(level, Node::makeInner);
+	publish(level.front());
+}
+
+size_t PersistentList::size() const
+{
+	return root == nullptr ? 0 : root->size;
+}
+
+void PersistentList::attach(ShapeObserver* o)
+{
+	observers.attach(o);
+	std::vector<const VolShape*> all;
+	auto collect = [&all](const VolShape& v) { all.push_back(&v); return true; };
+	if (root != nullptr) Node::each(*root, collect);
+	o->attached(all);
+}
+
+void PersistentList::detach(ShapeObserver* o)
+{
+	observers.detach(o);
+	o->cleared();
+}
+
+void PersistentList::addtoEnd(const VolShape* val)
+{
+	insert(val, static_cast<int>(size()));
+}
+
+void PersistentList::insert(const VolShape* val, int index)
+{
+	if (index < 0 || static_cast<size_t>(index) > size())
+		throw std::out_of_range("Error: Cannot insert at specified position\n");
+	put(copyOf(*val), index);
+}
+
+void PersistentList::addtoEnd(std::unique_ptr<VolShape> val)
+{
+	put(adopt(val), static_cast<int>(size()));
+}
+
+void PersistentList::insert(std::unique_ptr<VolShape> val, int index)
+{
+	if (index < 0 || static_cast<size_t>(index) > size())
+		throw std::out_of_range("Error: Cannot insert at specified position\n");
+	put(adopt(val), index);
+}
+
+void PersistentList::addtoEnd(const Item& val)
+{
+	put(share(val), static_cast<int>(size()));
+}
+
+void PersistentList::insert(const Item& val, int index)
+{
+	if (index < 0 || static_cast<size_t>(index) > size())
+		throw std::out_of_range("Error: Cannot insert at specified position\n");
+	put(share(val), index);
+}
+
+void PersistentList::put(const Item& v, int index)
+{
+	if (root == nullptr)
+	{
+		std::vector<Item> one(1, v);
+		publish(Node::makeLeaf(std::move(one)));
+	}
+	else
+	{
+		Ref extra;
+		Ref fresh = Node::insert(*root, index, v, extra);
+		if (extra != nullptr)
+		{
+			std::vector<Ref> two;
+			two.push_back(fresh);
+			two.push_back(extra);
+			fresh = Node::makeInner(std::move(two));
+		}
+		publish(fresh);
+	}
+	observers.added(*v);
+}
+
+const VolShape& PersistentList::getShape(int index) const
+{
+	if (index < 0 || static_cast<size_t>(index) >= size())
+		throw std::out_of_range("Error: Cannot get element at specified position\n");
+	size_t i = index;
+	const Node* n = root.get();
+	while (!n->leaf) n = n->children[Node::locate(*n, i)].get();
+	return *n->shapes[i];
+}
+
+void PersistentList::remove(int index)
+{
+	if (root == nullptr) return;
+	if (index < 0 || static_cast<size_t>(index) >= size())
+		throw std::out_of_range("Error: Cannot get element at specified position\n");
+	Item removed;
+	Ref fresh = Node::remove(*root, index, removed);
+	// корінь з однією дитиною замінюється нею, порожній листок - порожнім деревом
+	while (!fresh->leaf && fresh->children.size() == 1) fresh = fresh->children.front();
+	if (fresh->size == 0) fresh = nullptr;
+	observers.removed(*removed);
+	publish(fresh);
+}
+
+void PersistentList::removeAll()
+{
+	if (root == nullptr) return;
+	observers.cleared();
+	publish(nullptr);
+}
+
+PersistentList::Dedupe PersistentList::dedupe()
+{
+	Dedupe report = { size(), 0, 0 };
+	if (root == nullptr) return report;
+	ShapeInterner local;
+	ShapeInterner& interner = interning != nullptr ? *interning : local;
+	if (interning == nullptr) local.reserve(report.shapes);
+	std::vector<Item> items;
+	items.reserve(report.shapes);
+	auto collect = [&](const Node& leaf)
+	{
+		for (size_t i = 0; i < leaf.shapes.size(); ++i)
+		{
+			items.push_back(interner.intern(leaf.shapes[i]));
+			if (items.back() != leaf.shapes[i])
+			{
+				++report.replaced;
+				report.bytesSaved += ShapeInterner::footprint(*leaf.shapes[i]);
+			}
+		}
+	};
+	Node::leaves(*root, collect);
+	if (report.replaced == 0) return report;
+	if (!observers.empty()) observers.cleared();
+	build(items);
+	if (!observers.empty())
+	{
+		auto notify = [this](const VolShape& v) { observers.added(v); return true; };
+		Node::each(*root, notify);
+	}
+	return report;
+}
+
+void PersistentList::printAll() const
+{
+	if (root == nullptr)
+	{
+		std::cout << "List is empty :(\n";
+		return;
+	}
+	{
+		ShapeWriter out(std::cout);
+		auto print = [&out](const VolShape& v)
+		{
+			out.print(v);
+			out << " \n";
+			return true;
+		};
+		Node::each(*root, print);
+	}
+	std::cout.flush();
+}
+
+void PersistentList::storeOn(ofstream& os) const
+{
+	SHAPES_STORED(os);
+	if (root == nullptr) return;
+	{
+		ShapeWriter out(os);
+		auto store = [&out](const VolShape& v)
+		{
+			out.store(v);
+			out << '\n';
+			return true;
+		};
+		Node::each(*root, store);
+	}
+	os.flush();
+}
+
+const VolShape* PersistentList::findFirst_if(bool(*p)(const VolShape*)) const
+{
+	const VolShape* found = nullptr;
+	auto test = [p, &found](const VolShape& v)
+	{
+		if (!p(&v)) return true;
+		found = &v;
+		return false;
+	};
+	if (root != nullptr) Node::each(*root, test);
+	return found;
+}
+
+void PersistentList::ForEach(void (*do_something)(const VolShape*)) const
+{
+	auto call = [do_something](const VolShape& v) { do_something(&v); return true; };
+	if (root != nullptr) Node::each(*root, call);
+}
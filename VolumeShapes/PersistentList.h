@@ -0,0 +1,127 @@
+/*
+Незмінний (персистентний) список фігур зі спільними частинами. Копія LinkedList
+  заново створює кожен вузол і кожну фігуру, тож передати знімок каталогу
+  потокові звіту коштує O(n) виділень пам'яті. Копія PersistentList коштує O(1):
+  копії спільно використовують і вузли, і фігури.
+
+Фігури зберігаються в листках по 32 штуки, листки - в лічильному B-дереві:
+ кожен вузол знає кількість фігур у своєму піддереві, тож getShape, insert і
+ remove за позицією виконуються за O(log n). Вузли й фігури після створення не
+ змінюються і мають лічильники посилань (std::shared_ptr). Зміна списку
+ копіює лише вузли на шляху від кореня до зміненого листка (кілька вузлів по
+ 32 вказівники), решту дерева нова версія ділить зі старою.
+
+Фігури, додані до списку, - його власні копії, як і в LinkedList, але доступні
+ лише для читання. Вони завжди розміщуються в купі, а не в поточному
+ ShapeArena: остання версія списку, що тримає фігуру, може знищуватися в
+ іншому потоці.
+
+Потоки: змінює список один потік-писач. Інші потоки в будь-який момент можуть
+ взяти знімок - копію (конструктором копіювання чи snapshot()) - навіть поки
+ писач викликає addtoEnd, insert чи remove. Знімок - звичайний PersistentList,
+ якого подальші зміни оригіналу не торкаються. Решту методів оригіналу
+ викликає лише писач.
+
+Спостерігачі (ShapeObserver) працюють так само, як у LinkedList; копії
+ спостерігачів не успадковують.
+
+Оскільки фігури списку незмінні, рівні фігури можуть бути одним екземпляром
+ (див. ShapeInterner). У режимі інтернування (setInterner) кожна нова фігура
+ замінюється спільним екземпляром інтернера, а dedupe() так само замінює
+ фігури, що вже є в списку. Тоді на кількох позиціях списку стоїть та сама
+ фігура, і спостерігачі отримують ту саму адресу кілька разів. LinkedList і
+ ShapeVector такого режиму не мають: їхні фігури можна змінювати на місці.
+*/
+#ifndef _PersistentListHeader_
+#define _PersistentListHeader_
+
+#include "ShapeInterner.h"
+#include "ShapeVector.h"
+#include <memory>
+
+class PersistentList
+{
+public:
+	typedef std::shared_ptr<const VolShape> Item;
+	// підсумок dedupe
+	struct Dedupe
+	{
+		size_t shapes;      // фігур у списку
+		size_t replaced;    // замінено спільними екземплярами
+		size_t bytesSaved;  // ShapeInterner::footprint замінених фігур; пам'ять звільниться,
+		                    // коли їх не триматимуть і знімки
+	};
+
+	PersistentList() : interning(nullptr) {}
+	explicit PersistentList(const LinkedList& list);
+	explicit PersistentList(const ShapeVector& shapes);
+	// O(1); безпечно, поки інший потік змінює other
+	PersistentList(const PersistentList& other);
+	PersistentList& operator=(const PersistentList& other);
+	~PersistentList() {}
+
+	// знімок для іншого потоку, те саме, що й копія
+	PersistentList snapshot() const { return *this; }
+
+	size_t size() const;
+	bool empty() const { return root == nullptr; }
+
+	void attach(ShapeObserver* o);
+	void detach(ShapeObserver* o);
+
+	void addtoEnd(const VolShape* val);
+	// виняток std::out_of_range, якщо index > size()
+	void insert(const VolShape* val, int index);
+	// фігура з купи переходить у власність списку без копіювання, фігура з пулу копіюється
+	void addtoEnd(std::unique_ptr<VolShape> val);
+	void insert(std::unique_ptr<VolShape> val, int index);
+	// фігура стає спільною з тим, хто її передав, і в режимі інтернування теж
+	// (спільний екземпляр видає інтернер); фігура з пулу копіюється
+	void addtoEnd(const Item& val);
+	void insert(const Item& val, int index);
+	template<class T, class... Args> const T& emplace(Args&&... args)
+	{
+		std::unique_ptr<VolShape> made;
+		{
+			ShapeArena::Scope scope(nullptr);
+			made.reset(new T(std::forward<Args>(args)...));
+		}
+		addtoEnd(std::move(made));
+		// у режимі інтернування в списку може опинитися рівна фігура, що вже була, а made знищено
+		return static_cast<const T&>(getShape(static_cast<int>(size() - 1)));
+	}
+	const VolShape& getShape(int index) const;
+	const VolShape& operator[](int i) const { return getShape(i); }
+	void remove(int index);
+	void removeAll();
+
+	// режим інтернування: нові фігури беруться з interner (nullptr - вимкнути).
+	// Інтернер має існувати, поки режим увімкнено; копії списку режиму не успадковують
+	void setInterner(ShapeInterner* interner) { interning = interner; }
+	ShapeInterner* interner() const { return interning; }
+	// замінює рівні фігури списку одним екземпляром - з інтернера списку або,
+	// якщо режим вимкнено, з тимчасового; O(n)
+	Dedupe dedupe();
+
+	void printAll() const;
+	void storeOn(ofstream& os) const;
+	const VolShape* findFirst_if(bool(*p)(const VolShape*)) const;
+	void ForEach(void (*do_something)(const VolShape*)) const;
+private:
+	struct Node;
+	typedef std::shared_ptr<const Node> Ref;
+
+	// нова версія дерева стає видимою для знімків атомарно
+	void publish(Ref fresh);
+	Item copyOf(const VolShape& v) const;
+	Item adopt(std::unique_ptr<VolShape>& val) const;
+	Item share(const Item& val) const;
+	void put(const Item& v, int index);
+	void build(std::vector<Item>& items);
+
+	Ref root;
+	ShapeObservers observers;
+	ShapeInterner* interning;
+};
+
+#endif
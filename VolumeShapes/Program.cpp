@@ -1,29 +1,21 @@
-#include "VolumeShapes.h"
-#include <fstream>
+#include "ShapeVector.h"
+#include "ShapeReader.h"
 using namespace std;
 
 
 int main()
 {
     
-    LinkedList myList;
-    std::ifstream fin("volShapes.txt");
-    int size;
-    fin >> size;
-    for (int i = 0; i < size; ++i)
-    {
-        try
-        {
-            myList.addtoEnd(VolShape::MakeInstance(fin));
-        }
-        catch (VolShape::BadClassname& bcn)
-        {
-            std::cout << " !!! ERROR: Bad class name '" << bcn.what() << "' encountered at step #" << i + 1 << '\n';
-            myList.addtoEnd(new Cylinder);
-            while (fin.get() != '\n') continue;
-        }
-    }
-    myList.insert(new Cylinder(4, 5.0), 2);
+    ShapeVector myList;
+    // помилковий запис замінюється фігурою за замовчанням, як і раніше
+    ShapeReader::Options opt;
+    opt.policy = ShapeReader::SUBSTITUTE;
+    ShapeReader::Report report = ShapeReader::load("volShapes.txt", myList, opt);
+    for (size_t i = 0; i < report.errors.size(); ++i)
+        std::cout << " !!! ERROR: " << ShapeReader::describe(report.errors[i].status) << " at line " << report.errors[i].line << '\n';
+    if (report.errorCount > report.errors.size())
+        std::cout << " !!! " << report.errorCount - report.errors.size() << " more errors\n";
+    myList.insert(std::make_unique<Cylinder>(4, 5.0), 2);
     myList.printAll();
     return 0;
-}
\ No newline at end of file
+}
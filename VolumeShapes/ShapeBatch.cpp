@@ -0,0 +1,635 @@
+#include "ShapeBatch.h"
+#include <typeinfo>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SHAPEBATCH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHAPEBATCH_SSE2
+#endif
+
+namespace
+{
+// Набори команд описано однаково: тип значення, тип регістра, кількість значень
+// у ньому та елементарні операції. Формули нижче записано один раз для всіх
+// наборів і для обох типів значень - double і float.
+struct ScalarOps
+{
+	typedef double real;
+	typedef double reg;
+	enum { lanes = 1 };
+	static reg set(double x) { return x; }
+	static reg load(const double* p) { return *p; }
+	static reg loadAngle(const int* p) { return static_cast<double>(*p); }
+	static void store(double* p, reg x) { *p = x; }
+	static reg add(reg x, reg y) { return x + y; }
+	static reg sub(reg x, reg y) { return x - y; }
+	static reg mul(reg x, reg y) { return x * y; }
+	static reg div(reg x, reg y) { return x / y; }
+	static reg sqrt(reg x) { return std::sqrt(x); }
+	static reg round(reg x) { return std::nearbyint(x); }
+};
+
+struct ScalarFloatOps
+{
+	typedef float real;
+	typedef float reg;
+	enum { lanes = 1 };
+	static reg set(double x) { return static_cast<float>(x); }
+	static reg load(const float* p) { return *p; }
+	static reg loadAngle(const int* p) { return static_cast<float>(*p); }
+	static void store(float* p, reg x) { *p = x; }
+	static reg add(reg x, reg y) { return x + y; }
+	static reg sub(reg x, reg y) { return x - y; }
+	static reg mul(reg x, reg y) { return x * y; }
+	static reg div(reg x, reg y) { return x / y; }
+	static reg sqrt(reg x) { return std::sqrt(x); }
+	static reg round(reg x) { return std::nearbyint(x); }
+};
+
+#if defined(SHAPEBATCH_AVX2)
+struct SimdOps
+{
+	typedef double real;
+	typedef __m256d reg;
+	enum { lanes = 4 };
+	static reg set(double x) { return _mm256_set1_pd(x); }
+	static reg load(const double* p) { return _mm256_loadu_pd(p); }
+	static reg loadAngle(const int* p) { return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+	static void store(double* p, reg x) { _mm256_storeu_pd(p, x); }
+	static reg add(reg x, reg y) { return _mm256_add_pd(x, y); }
+	static reg sub(reg x, reg y) { return _mm256_sub_pd(x, y); }
+	static reg mul(reg x, reg y) { return _mm256_mul_pd(x, y); }
+	static reg div(reg x, reg y) { return _mm256_div_pd(x, y); }
+	static reg sqrt(reg x) { return _mm256_sqrt_pd(x); }
+	static reg round(reg x) { return _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+};
+
+struct SimdFloatOps
+{
+	typedef float real;
+	typedef __m256 reg;
+	enum { lanes = 8 };
+	static reg set(double x) { return _mm256_set1_ps(static_cast<float>(x)); }
+	static reg load(const float* p) { return _mm256_loadu_ps(p); }
+	static reg loadAngle(const int* p) { return _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))); }
+	static void store(float* p, reg x) { _mm256_storeu_ps(p, x); }
+	static reg add(reg x, reg y) { return _mm256_add_ps(x, y); }
+	static reg sub(reg x, reg y) { return _mm256_sub_ps(x, y); }
+	static reg mul(reg x, reg y) { return _mm256_mul_ps(x, y); }
+	static reg div(reg x, reg y) { return _mm256_div_ps(x, y); }
+	static reg sqrt(reg x) { return _mm256_sqrt_ps(x); }
+	static reg round(reg x) { return _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+};
+#elif defined(SHAPEBATCH_SSE2)
+struct SimdOps
+{
+	typedef double real;
+	typedef __m128d reg;
+	enum { lanes = 2 };
+	static reg set(double x) { return _mm_set1_pd(x); }
+	static reg load(const double* p) { return _mm_loadu_pd(p); }
+	static reg loadAngle(const int* p) { return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+	static void store(double* p, reg x) { _mm_storeu_pd(p, x); }
+	static reg add(reg x, reg y) { return _mm_add_pd(x, y); }
+	static reg sub(reg x, reg y) { return _mm_sub_pd(x, y); }
+	static reg mul(reg x, reg y) { return _mm_mul_pd(x, y); }
+	static reg div(reg x, reg y) { return _mm_div_pd(x, y); }
+	static reg sqrt(reg x) { return _mm_sqrt_pd(x); }
+	// у SSE2 немає команди округлення: додавання і віднімання 1.5 * 2^52
+	// округлює до найближчого цілого для |x| < 2^51
+	static reg round(reg x)
+	{
+		const reg magic = _mm_set1_pd(6755399441055744.0);
+		return _mm_sub_pd(_mm_add_pd(x, magic), magic);
+	}
+};
+
+struct SimdFloatOps
+{
+	typedef float real;
+	typedef __m128 reg;
+	enum { lanes = 4 };
+	static reg set(double x) { return _mm_set1_ps(static_cast<float>(x)); }
+	static reg load(const float* p) { return _mm_loadu_ps(p); }
+	static reg loadAngle(const int* p) { return _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+	static void store(float* p, reg x) { _mm_storeu_ps(p, x); }
+	static reg add(reg x, reg y) { return _mm_add_ps(x, y); }
+	static reg sub(reg x, reg y) { return _mm_sub_ps(x, y); }
+	static reg mul(reg x, reg y) { return _mm_mul_ps(x, y); }
+	static reg div(reg x, reg y) { return _mm_div_ps(x, y); }
+	static reg sqrt(reg x) { return _mm_sqrt_ps(x); }
+	// те саме з 1.5 * 2^23, для |x| < 2^22
+	static reg round(reg x)
+	{
+		const reg magic = _mm_set1_ps(12582912.f);
+		return _mm_sub_ps(_mm_add_ps(x, magic), magic);
+	}
+};
+#else
+typedef ScalarOps SimdOps;
+typedef ScalarFloatOps SimdFloatOps;
+#endif
+
+// обгортка над регістром, щоб формули читалися так само, як у VolumeShapes.cpp
+template<class P> struct Vec
+{
+	typename P::reg v;
+	Vec(typename P::reg x) : v(x) {}
+	// константа в усіх елементах регістра (для ScalarOps це той самий конструктор, що й вище)
+	template<class T, class = typename std::enable_if<std::is_same<T, double>::value
+		&& !std::is_same<typename P::reg, double>::value>::type>
+	Vec(T x) : v(P::set(x)) {}
+};
+template<class P> inline Vec<P> operator+(Vec<P> x, Vec<P> y) { return P::add(x.v, y.v); }
+template<class P> inline Vec<P> operator-(Vec<P> x, Vec<P> y) { return P::sub(x.v, y.v); }
+template<class P> inline Vec<P> operator*(Vec<P> x, Vec<P> y) { return P::mul(x.v, y.v); }
+template<class P> inline Vec<P> operator/(Vec<P> x, Vec<P> y) { return P::div(x.v, y.v); }
+template<class P> inline Vec<P> operator+(Vec<P> x, double y) { return x + Vec<P>(y); }
+template<class P> inline Vec<P> operator-(double x, Vec<P> y) { return Vec<P>(x) - y; }
+template<class P> inline Vec<P> operator*(double x, Vec<P> y) { return Vec<P>(x) * y; }
+template<class P> inline Vec<P> operator*(Vec<P> x, double y) { return x * Vec<P>(y); }
+template<class P> inline Vec<P> operator/(Vec<P> x, double y) { return x / Vec<P>(y); }
+template<class P> inline Vec<P> sqrt(Vec<P> x) { return P::sqrt(x.v); }
+
+template<class P> inline Vec<P> roundInt(Vec<P> x) { return P::round(x.v); }
+
+// многочлени sin і cos на [-pi/4, pi/4]: z = t * t
+template<class R> struct Kernel;
+
+// ядра fdlibm
+template<> struct Kernel<double>
+{
+	template<class P> static Vec<P> sin(Vec<P> t, Vec<P> z)
+	{
+		const double S1 = -1.66666666666666324348e-01, S2 = 8.33333333332248946124e-03,
+			S3 = -1.98412698298579493134e-04, S4 = 2.75573137070700676789e-06,
+			S5 = -2.50507602534068634195e-08, S6 = 1.58969099521155010221e-10;
+		return t + z * t * (Vec<P>(S1) + z * (Vec<P>(S2) + z * (Vec<P>(S3) + z * (Vec<P>(S4) + z * (Vec<P>(S5) + z * S6)))));
+	}
+	template<class P> static Vec<P> cos(Vec<P> z)
+	{
+		const double C1 = 4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03,
+			C3 = 2.48015872894767294178e-05, C4 = -2.75573143513906633035e-07,
+			C5 = 2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+		return 1. - (0.5 * z - z * z * (Vec<P>(C1) + z * (Vec<P>(C2) + z * (Vec<P>(C3) + z * (Vec<P>(C4) + z * (Vec<P>(C5) + z * C6))))));
+	}
+};
+
+// ядра sinf і cosf з Cephes
+template<> struct Kernel<float>
+{
+	template<class P> static Vec<P> sin(Vec<P> t, Vec<P> z)
+	{
+		return t + z * t * (Vec<P>(-1.6666654611e-1) + z * (Vec<P>(8.3321608736e-3) + z * -1.9515295891e-4));
+	}
+	template<class P> static Vec<P> cos(Vec<P> z)
+	{
+		return 1. - (0.5 * z - z * z * (Vec<P>(4.166664568298827e-2) + z * (Vec<P>(-1.388731625493765e-3) + z * 2.443315711809948e-5)));
+	}
+};
+
+// sin і cos за чвертю k і значеннями многочленів на [-pi/4, pi/4]: вибір знаку
+// та функції за k mod 4 без розгалужень
+template<class P> inline void quadrant(Vec<P> k, Vec<P> ps, Vec<P> pc, Vec<P>& s, Vec<P>& c)
+{
+	// q = k mod 4; odd - непарна чверть (sin і cos міняються місцями),
+	// high - друга половина періоду (sin від'ємний)
+	Vec<P> q = k - 4. * roundInt(k * 0.25 + (-0.375));
+	Vec<P> high = roundInt(q * 0.5 + (-0.25));
+	Vec<P> odd = q - 2. * high;
+	// cos від'ємний у чвертях 1 і 2
+	Vec<P> cosNeg = roundInt((q + 1. - 4. * odd * high) * 0.5 + (-0.25));
+	// множення на 0 або 1 і додавання нуля точні, тож це вибір без похибки
+	s = (1. - 2. * high) * (odd * pc + (1. - odd) * ps);
+	c = (1. - 2. * cosNeg) * (odd * ps + (1. - odd) * pc);
+}
+
+// sin і cos кута в радіанах: x = k*pi/2 + t, |t| <= pi/4 (редукція Коді-Вейта)
+template<class P> inline void sinCos(Vec<P> x, Vec<P>& s, Vec<P>& c)
+{
+	const double TWO_OVER_PI = 6.36619772367581382433e-01;
+	const double PIO2_1 = 1.57079632673412561417e+00;  // перші 33 біти pi/2
+	const double PIO2_1T = 6.07710050650619224932e-11; // pi/2 - PIO2_1
+
+	Vec<P> k = roundInt(x * TWO_OVER_PI);
+	Vec<P> t = (x - k * PIO2_1) - k * PIO2_1T;
+	Vec<P> z = t * t;
+	quadrant(k, Kernel<typename P::real>::sin(t, z), Kernel<typename P::real>::cos(z), s, c);
+}
+
+// sin і cos кута в цілих градусах y: y = 90k + r, |r| <= 45 - точно в цілих числах,
+// і лише r переводиться в радіани. Тож sin і cos кратних 90 градусів точні
+template<class P> inline void sinCosDegrees(Vec<P> y, Vec<P>& s, Vec<P>& c)
+{
+	const double DEGREE = 1.74532925199432957692e-02; // pi/180
+	Vec<P> k = roundInt(y * (1. / 90.));
+	Vec<P> t = (y - k * 90.) * DEGREE;
+	Vec<P> z = t * t;
+	quadrant(k, Kernel<typename P::real>::sin(t, z), Kernel<typename P::real>::cos(z), s, c);
+	// sin 180 = -0 дав би площу -0
+	s = s + 0.;
+}
+
+// площа і периметр основи; порядок операцій той самий, що і в FlatShapes.cpp
+template<class P, int K, int Q, class V> inline void baseMetrics(const V& c, size_t i, Vec<P>& area, Vec<P>& perim)
+{
+	if (K == ShapeBatch::CYLINDER || K == ShapeBatch::CONUS)
+	{
+		Vec<P> r = P::load(c.r + i);
+		area = M_PI * r * r;
+		perim = 2. * M_PI * r;
+	}
+	else if (K == ShapeBatch::PARALLELEPIPED || K == ShapeBatch::RECTPIRAMID)
+	{
+		Vec<P> a = P::load(c.a + i), b = P::load(c.b + i);
+		area = a * b;
+		perim = (a + b) * 2.;
+	}
+	else
+	{
+		Vec<P> a = P::load(c.a + i), b = P::load(c.b + i);
+		Vec<P> y = P::loadAngle(c.angle + i);
+		Vec<P> s(0.), cs(0.);
+		// Triangle::angle() = 3.14*y/180
+		if (Q == ShapeBatch::REFERENCE) sinCos(3.14 * y / 180., s, cs);
+		else sinCosDegrees(y, s, cs);
+		area = 0.5 * a * b * s;
+		perim = a + b + sqrt(a * a + b * b - 2. * a * b * cs);
+	}
+}
+
+template<class P, int K, int M, int Q, class V> inline Vec<P> metric(const V& c, size_t i)
+{
+	Vec<P> h = P::load(c.h + i);
+	Vec<P> area(0.), perim(0.);
+	baseMetrics<P, K, Q>(c, i, area, perim);
+	if (M == ShapeBatch::BASE_AREA) return area;
+	if (K == ShapeBatch::CYLINDER || K == ShapeBatch::PARALLELEPIPED || K == ShapeBatch::TRIPRIZM)
+	{
+		// DirectShape
+		if (M == ShapeBatch::VOLUME) return area * h;
+		if (M == ShapeBatch::SIDE_AREA) return perim * h;
+		return area * 2. + perim * h;
+	}
+	// PiramidalShape
+	if (M == ShapeBatch::VOLUME) return area * h / 3.;
+	Vec<P> side(0.);
+	if (K == ShapeBatch::CONUS)
+	{
+		Vec<P> r = P::load(c.r + i);
+		side = M_PI * r * sqrt(h * h + r * r);
+	}
+	else if (K == ShapeBatch::RECTPIRAMID)
+	{
+		Vec<P> a = P::load(c.a + i), b = P::load(c.b + i);
+		side = a * sqrt(h * h + b * b * 0.25) + b * sqrt(h * h + a * a * 0.25);
+	}
+	else
+	{
+		Vec<P> r = 2. * area / perim;
+		side = 0.5 * perim * sqrt(h * h + r * r);
+	}
+	if (M == ShapeBatch::SIDE_AREA) return side;
+	return area + side;
+}
+
+// S - векторний набір команд, W - скалярний для хвоста стовпця
+template<class S, class W, int K, int M, int Q, class V> void run(const V& c, typename S::real* out)
+{
+	const size_t n = c.size;
+	const size_t wide = n - n % S::lanes;
+	size_t i = 0;
+	for (; i < wide; i += S::lanes)
+		S::store(out + i, metric<S, K, M, Q>(c, i).v);
+	for (; i < n; ++i)
+		W::store(out + i, metric<W, K, M, Q>(c, i).v);
+}
+
+template<class S, class W, int K, int Q, class V> void runKind(ShapeBatch::Metric m, const V& c, typename S::real* out)
+{
+	switch (m)
+	{
+	case ShapeBatch::VOLUME:       run<S, W, K, ShapeBatch::VOLUME, Q>(c, out); break;
+	case ShapeBatch::BASE_AREA:    run<S, W, K, ShapeBatch::BASE_AREA, Q>(c, out); break;
+	case ShapeBatch::SIDE_AREA:    run<S, W, K, ShapeBatch::SIDE_AREA, Q>(c, out); break;
+	case ShapeBatch::SURFACE_AREA: run<S, W, K, ShapeBatch::SURFACE_AREA, Q>(c, out); break;
+	default: break;
+	}
+}
+
+template<class S, class W, int Q, class V> void runAll(ShapeBatch::Metric m, ShapeBatch::Kind k, const V& c, typename S::real* out)
+{
+	switch (k)
+	{
+	case ShapeBatch::CYLINDER:       runKind<S, W, ShapeBatch::CYLINDER, Q>(m, c, out); break;
+	case ShapeBatch::PARALLELEPIPED: runKind<S, W, ShapeBatch::PARALLELEPIPED, Q>(m, c, out); break;
+	case ShapeBatch::TRIPRIZM:       runKind<S, W, ShapeBatch::TRIPRIZM, Q>(m, c, out); break;
+	case ShapeBatch::CONUS:          runKind<S, W, ShapeBatch::CONUS, Q>(m, c, out); break;
+	case ShapeBatch::RECTPIRAMID:    runKind<S, W, ShapeBatch::RECTPIRAMID, Q>(m, c, out); break;
+	case ShapeBatch::TRIPIRAMID:     runKind<S, W, ShapeBatch::TRIPIRAMID, Q>(m, c, out); break;
+	default: break;
+	}
+}
+
+// параметри фігури у відповідні стовпці пакета будь-якого типу
+template<class B> void addShape(B& batch, const VolShape& v)
+{
+	const Shape* s = v.getBase();
+	switch (ShapeBatch::kindOf(v))
+	{
+	case ShapeBatch::CYLINDER:
+		batch.addCylinder(v.high(), static_cast<const Circle*>(s)->radius()); return;
+	case ShapeBatch::CONUS:
+		batch.addConus(v.high(), static_cast<const Circle*>(s)->radius()); return;
+	case ShapeBatch::PARALLELEPIPED:
+		batch.addParallelepiped(v.high(), static_cast<const Rectangle*>(s)->sideA(), static_cast<const Rectangle*>(s)->sideB()); return;
+	case ShapeBatch::RECTPIRAMID:
+		batch.addRectPiramid(v.high(), static_cast<const Rectangle*>(s)->sideA(), static_cast<const Rectangle*>(s)->sideB()); return;
+	case ShapeBatch::TRIPRIZM:
+	{
+		const Triangle* t = static_cast<const Triangle*>(s);
+		batch.addTriPrizm(v.high(), t->sideA(), t->sideB(), t->degrees()); return;
+	}
+	case ShapeBatch::TRIPIRAMID:
+	{
+		const Triangle* t = static_cast<const Triangle*>(s);
+		batch.addTriPiramid(v.high(), t->sideA(), t->sideB(), t->degrees()); return;
+	}
+	}
+	throw VolShape::BadClassname(v.getClassName());
+}
+}
+
+//-----------------------------------------------------------
+
+int ShapeBatch::kindOf(const VolShape& v)
+{
+	// вбудовані класи зареєстровані в порядку Kind (див. VolumeShapes.cpp)
+	const int tag = v.typeTag();
+	return tag < KIND_COUNT ? tag : -1;
+}
+
+const char* ShapeBatch::kindName(Kind k)
+{
+	static const char* names[KIND_COUNT] = { "Cylinder", "Parallelepiped", "TriPrizm", "Conus", "RectPiramid", "TriPiramid" };
+	return names[k];
+}
+
+const char* ShapeBatch::metricName(Metric m)
+{
+	static const char* names[METRIC_COUNT] = { "volume", "base_area", "side_area", "surface_area" };
+	return names[m];
+}
+
+const char* ShapeBatch::simdPath()
+{
+#if defined(SHAPEBATCH_AVX2)
+	return "AVX2";
+#elif defined(SHAPEBATCH_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+//-----------------------------------------------------------
+
+void ShapeBatch::add(const VolShape& v)
+{
+	addShape(*this, v);
+}
+
+void ShapeBatch::addAll(const LinkedList& list)
+{
+	for (const LinkedList::Node* curr = list.first(); curr != nullptr; curr = curr->next)
+		add(*curr->data);
+}
+
+void ShapeBatch::addCylinder(double high, double radius)
+{
+	cols[CYLINDER].h.push_back(high);
+	cols[CYLINDER].r.push_back(radius);
+}
+
+void ShapeBatch::addParallelepiped(double high, double sideA, double sideB)
+{
+	cols[PARALLELEPIPED].h.push_back(high);
+	cols[PARALLELEPIPED].a.push_back(sideA);
+	cols[PARALLELEPIPED].b.push_back(sideB);
+}
+
+void ShapeBatch::addTriPrizm(double high, double sideA, double sideB, int angle)
+{
+	cols[TRIPRIZM].h.push_back(high);
+	cols[TRIPRIZM].a.push_back(sideA);
+	cols[TRIPRIZM].b.push_back(sideB);
+	cols[TRIPRIZM].angle.push_back(angle);
+}
+
+void ShapeBatch::addConus(double high, double radius)
+{
+	cols[CONUS].h.push_back(high);
+	cols[CONUS].r.push_back(radius);
+}
+
+void ShapeBatch::addRectPiramid(double high, double sideA, double sideB)
+{
+	cols[RECTPIRAMID].h.push_back(high);
+	cols[RECTPIRAMID].a.push_back(sideA);
+	cols[RECTPIRAMID].b.push_back(sideB);
+}
+
+void ShapeBatch::addTriPiramid(double high, double sideA, double sideB, int angle)
+{
+	cols[TRIPIRAMID].h.push_back(high);
+	cols[TRIPIRAMID].a.push_back(sideA);
+	cols[TRIPIRAMID].b.push_back(sideB);
+	cols[TRIPIRAMID].angle.push_back(angle);
+}
+
+void ShapeBatch::reserve(Kind k, size_t n)
+{
+	Columns& c = cols[k];
+	c.h.reserve(n);
+	if (k == CYLINDER || k == CONUS) c.r.reserve(n);
+	else
+	{
+		c.a.reserve(n);
+		c.b.reserve(n);
+		if (k == TRIPRIZM || k == TRIPIRAMID) c.angle.reserve(n);
+	}
+}
+
+void ShapeBatch::append(const ShapeBatch& other)
+{
+	for (int k = 0; k < KIND_COUNT; ++k)
+	{
+		Columns& c = cols[k];
+		const Columns& o = other.cols[k];
+		c.h.insert(c.h.end(), o.h.begin(), o.h.end());
+		c.r.insert(c.r.end(), o.r.begin(), o.r.end());
+		c.a.insert(c.a.end(), o.a.begin(), o.a.end());
+		c.b.insert(c.b.end(), o.b.begin(), o.b.end());
+		c.angle.insert(c.angle.end(), o.angle.begin(), o.angle.end());
+	}
+}
+
+void ShapeBatch::clear()
+{
+	for (int k = 0; k < KIND_COUNT; ++k) cols[k] = Columns();
+}
+
+size_t ShapeBatch::size() const
+{
+	size_t n = 0;
+	for (int k = 0; k < KIND_COUNT; ++k) n += cols[k].size();
+	return n;
+}
+
+//-----------------------------------------------------------
+
+ShapeBatch::View ShapeBatch::view(Kind k) const
+{
+	const Columns& c = cols[k];
+	View v = { c.h.data(), c.r.data(), c.a.data(), c.b.data(), c.angle.data(), c.size() };
+	return v;
+}
+
+void ShapeBatch::compute(Metric m, Kind k, double* out, Precision p) const
+{
+	compute(m, k, view(k), out, p);
+}
+
+void ShapeBatch::compute(Metric m, Kind k, const View& c, double* out, Precision p)
+{
+	if (p == EXACT) runAll<SimdOps, ScalarOps, EXACT>(m, k, c, out);
+	else runAll<SimdOps, ScalarOps, REFERENCE>(m, k, c, out);
+}
+
+std::vector<double> ShapeBatch::compute(Metric m, Kind k, Precision p) const
+{
+	std::vector<double> out(cols[k].size());
+	if (!out.empty()) compute(m, k, out.data(), p);
+	return out;
+}
+
+//-----------------------------------------------------------
+
+void FloatBatch::add(const VolShape& v)
+{
+	addShape(*this, v);
+}
+
+void FloatBatch::addAll(const LinkedList& list)
+{
+	for (const LinkedList::Node* curr = list.first(); curr != nullptr; curr = curr->next)
+		add(*curr->data);
+}
+
+void FloatBatch::addCylinder(double high, double radius)
+{
+	cols[ShapeBatch::CYLINDER].h.push_back(static_cast<float>(high));
+	cols[ShapeBatch::CYLINDER].r.push_back(static_cast<float>(radius));
+}
+
+void FloatBatch::addParallelepiped(double high, double sideA, double sideB)
+{
+	cols[ShapeBatch::PARALLELEPIPED].h.push_back(static_cast<float>(high));
+	cols[ShapeBatch::PARALLELEPIPED].a.push_back(static_cast<float>(sideA));
+	cols[ShapeBatch::PARALLELEPIPED].b.push_back(static_cast<float>(sideB));
+}
+
+void FloatBatch::addTriPrizm(double high, double sideA, double sideB, int angle)
+{
+	cols[ShapeBatch::TRIPRIZM].h.push_back(static_cast<float>(high));
+	cols[ShapeBatch::TRIPRIZM].a.push_back(static_cast<float>(sideA));
+	cols[ShapeBatch::TRIPRIZM].b.push_back(static_cast<float>(sideB));
+	cols[ShapeBatch::TRIPRIZM].angle.push_back(angle);
+}
+
+void FloatBatch::addConus(double high, double radius)
+{
+	cols[ShapeBatch::CONUS].h.push_back(static_cast<float>(high));
+	cols[ShapeBatch::CONUS].r.push_back(static_cast<float>(radius));
+}
+
+void FloatBatch::addRectPiramid(double high, double sideA, double sideB)
+{
+	cols[ShapeBatch::RECTPIRAMID].h.push_back(static_cast<float>(high));
+	cols[ShapeBatch::RECTPIRAMID].a.push_back(static_cast<float>(sideA));
+	cols[ShapeBatch::RECTPIRAMID].b.push_back(static_cast<float>(sideB));
+}
+
+void FloatBatch::addTriPiramid(double high, double sideA, double sideB, int angle)
+{
+	cols[ShapeBatch::TRIPIRAMID].h.push_back(static_cast<float>(high));
+	cols[ShapeBatch::TRIPIRAMID].a.push_back(static_cast<float>(sideA));
+	cols[ShapeBatch::TRIPIRAMID].b.push_back(static_cast<float>(sideB));
+	cols[ShapeBatch::TRIPIRAMID].angle.push_back(angle);
+}
+
+void FloatBatch::append(const ShapeBatch& other)
+{
+	for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k)
+	{
+		Columns& c = cols[k];
+		const ShapeBatch::Columns& o = other.columns(static_cast<ShapeBatch::Kind>(k));
+		c.h.insert(c.h.end(), o.h.begin(), o.h.end());
+		c.r.insert(c.r.end(), o.r.begin(), o.r.end());
+		c.a.insert(c.a.end(), o.a.begin(), o.a.end());
+		c.b.insert(c.b.end(), o.b.begin(), o.b.end());
+		c.angle.insert(c.angle.end(), o.angle.begin(), o.angle.end());
+	}
+}
+
+void FloatBatch::reserve(ShapeBatch::Kind k, size_t n)
+{
+	Columns& c = cols[k];
+	c.h.reserve(n);
+	if (k == ShapeBatch::CYLINDER || k == ShapeBatch::CONUS) c.r.reserve(n);
+	else
+	{
+		c.a.reserve(n);
+		c.b.reserve(n);
+		if (k == ShapeBatch::TRIPRIZM || k == ShapeBatch::TRIPIRAMID) c.angle.reserve(n);
+	}
+}
+
+void FloatBatch::clear()
+{
+	for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k) cols[k] = Columns();
+}
+
+size_t FloatBatch::size() const
+{
+	size_t n = 0;
+	for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k) n += cols[k].size();
+	return n;
+}
+
+FloatBatch::View FloatBatch::view(ShapeBatch::Kind k) const
+{
+	const Columns& c = cols[k];
+	View v = { c.h.data(), c.r.data(), c.a.data(), c.b.data(), c.angle.data(), c.size() };
+	return v;
+}
+
+void FloatBatch::compute(ShapeBatch::Metric m, ShapeBatch::Kind k, float* out) const
+{
+	compute(m, k, view(k), out);
+}
+
+void FloatBatch::compute(ShapeBatch::Metric m, ShapeBatch::Kind k, const View& c, float* out)
+{
+	runAll<SimdFloatOps, ScalarFloatOps, ShapeBatch::EXACT>(m, k, c, out);
+}
+
+std::vector<float> FloatBatch::compute(ShapeBatch::Metric m, ShapeBatch::Kind k) const
+{
+	std::vector<float> out(cols[k].size());
+	if (!out.empty()) compute(m, k, out.data());
+	return out;
+}
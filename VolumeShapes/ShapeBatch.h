@@ -0,0 +1,199 @@
+/*
+Пакетне обчислення характеристик великих наборів об'ємних фігур.
+  ShapeBatch зберігає параметри фігур кожного конкретного класу (Cylinder,
+  Parallelepiped, TriPrizm, Conus, RectPiramid, TriPiramid) не об'єктами, а
+  окремими неперервними стовпцями: висоти h, радіуси r, сторони a, b та кути
+  angle. Для кожного класу використовуються лише потрібні йому стовпці, решта
+  лишаються порожніми.
+
+Обчислення об'єму, площ основи, бічної та повної поверхні виконуються для
+ цілого стовпця без жодного віртуального виклику. Цикли записано через
+ SIMD-регістри: AVX2 (4 double), коли компілятор генерує AVX2 (/arch:AVX2,
+ -mavx2), інакше SSE2 (2 double), а без них - звичайні скалярні операції.
+ Хвіст стовпця, що не заповнює регістр, рахується тими ж формулами поелементно,
+ тому результат не залежить від позиції фігури в стовпці.
+
+Точність порівняно з віртуальними методами VolShape:
+ - Cylinder, Parallelepiped, Conus, RectPiramid - ті самі операції в тому ж
+   порядку, а sqrt коректно округлюється і в SSE/AVX, тож результат збігається
+   біт у біт (0 ULP);
+ - TriPrizm, TriPiramid - sin і cos кута трикутника обчислюються власними
+   векторними многочленами (редукція Коді-Вейта на pi/2 і ядра fdlibm), що
+   відрізняються від std::sin/std::cos не більше ніж на 1 ULP. Звідси площа
+   основи - не більше 2 ULP, об'єм - 4 ULP, периметр, бічна і повна поверхня -
+   не більше 6 ULP (на 6 млн. трикутників з кутами 1..179 градусів, зокрема
+   рівнобедрених, найбільше відхилення склало 5 ULP). Редукція точна для
+   |кут| < 2^20 * 90 градусів.
+ Межі стосуються збірок з SSE2/AVX2 без злиття множення й додавання в FMA
+ (-ffp-contract=off, як задає CMakeLists.txt; /fp:precise у MSVC). Якщо
+ компілятор зливає їх (GCC з -mfma типово), то ShapeBatch і віртуальні методи
+ округлюють по-різному: до 3 ULP для Conus, 1 ULP для решти нетрикутних класів
+ і десятки ULP для бічної й повної поверхні TriPrizm і TriPiramid (27 ULP на
+ 600 тис. фігур). Скалярна збірка на x87
+ додає до 1 ULP через розширену точність проміжних результатів.
+
+Ці межі - відносно віртуальних методів, які самі переводять кут наближено:
+ Triangle::angle() = 3.14*y/180, тож площа трикутника з кутом 179 градусів
+ відрізняється від справжньої на 9%, а з кутом 90 - на 1e-6. Режим EXACT
+ (параметр compute) рахує трикутні класи з точним переведенням: y = 90k + r
+ розкладається в цілих числах, у радіани переводиться лише |r| <= 45, тож
+ sin і cos кратних 90 градусів точні, а решта - з похибкою до 1 ULP. Решта
+ класів у режимі EXACT рахується так само, як у REFERENCE.
+
+FloatBatch зберігає параметри у float - удвічі менше пам'яті, а в регістр
+ вміщується 8 (AVX2) чи 4 (SSE2) значення замість 4 чи 2 - і завжди рахує з
+ точним переведенням кута. Найбільша відносна похибка float-результату
+ порівняно з точним значенням тих самих формул (на 6 млн. фігур зі сторонами
+ 0.01..99.99 і кутами 1..179 градусів, серед них рівнобедрені трикутники):
+ - об'єм і площа основи всіх класів, поверхні нетрикутних - 3.3e-7 (до 3 ULP
+   float), з них 6e-8 - округлення самих параметрів до float;
+ - бічна і повна поверхня TriPrizm і TriPiramid - 4.6e-6. Третя сторона
+   трикутника a^2 + b^2 - 2ab cos(y) для малих кутів і a ~ b втрачає розряди;
+   у double цей самий вираз дає до 70 ULP (решта метрик EXACT - до 4 ULP).
+ Для порівнянь і відсіювання (ShapeQuery, top-k) цього досить; для сум
+ мільйонів значень краще double.
+*/
+#ifndef _ShapeBatchHeader_
+#define _ShapeBatchHeader_
+
+#include "VolumeShapes.h"
+#include <vector>
+
+class ShapeBatch
+{
+public:
+	// конкретні класи фігур, кожен має власний набір стовпців
+	enum Kind { CYLINDER, PARALLELEPIPED, TRIPRIZM, CONUS, RECTPIRAMID, TRIPIRAMID, KIND_COUNT };
+	// характеристики, які вміє рахувати пакет
+	enum Metric { VOLUME, BASE_AREA, SIDE_AREA, SURFACE_AREA, METRIC_COUNT };
+	// REFERENCE - як віртуальні методи VolShape, з кутом 3.14*y/180;
+	// EXACT - кут переводиться в радіани точно (див. вище)
+	enum Precision { REFERENCE, EXACT };
+	// стовпці параметрів одного класу: Cylinder і Conus - h, r;
+	// Parallelepiped і RectPiramid - h, a, b; трикутні - h, a, b, angle
+	struct Columns
+	{
+		std::vector<double> h;
+		std::vector<double> r;
+		std::vector<double> a;
+		std::vector<double> b;
+		std::vector<int> angle;
+		size_t size() const { return h.size(); }
+	};
+	// стовпці без володіння: на вектори пакета або, наприклад, на відображений файл
+	struct View
+	{
+		const double* h;
+		const double* r;
+		const double* a;
+		const double* b;
+		const int* angle;
+		size_t size;
+	};
+	// клас екземпляра або -1, якщо пакет такого не підтримує
+	static int kindOf(const VolShape&);
+	static const char* kindName(Kind);
+	// volume, base_area, side_area, surface_area
+	static const char* metricName(Metric);
+	// набір команд, яким скомпільовано обчислювальні цикли: "AVX2", "SSE2" або "scalar"
+	static const char* simdPath();
+
+	ShapeBatch() {}
+	explicit ShapeBatch(const LinkedList& list) { addAll(list); }
+
+	// копіює параметри фігури у відповідні стовпці
+	void add(const VolShape&);
+	void addAll(const LinkedList&);
+	void addCylinder(double high, double radius);
+	void addParallelepiped(double high, double sideA, double sideB);
+	void addTriPrizm(double high, double sideA, double sideB, int angle);
+	void addConus(double high, double radius);
+	void addRectPiramid(double high, double sideA, double sideB);
+	void addTriPiramid(double high, double sideA, double sideB, int angle);
+	// дописує в кінець стовпців усі фігури other
+	void append(const ShapeBatch& other);
+
+	void reserve(Kind k, size_t n);
+	void clear();
+	size_t size() const;
+	size_t size(Kind k) const { return cols[k].size(); }
+	const Columns& columns(Kind k) const { return cols[k]; }
+	Columns& columns(Kind k) { return cols[k]; }
+	View view(Kind k) const;
+
+	// обчислює характеристику для всього стовпця класу k; out має вміщати size(k) значень
+	void compute(Metric m, Kind k, double* out, Precision p = REFERENCE) const;
+	std::vector<double> compute(Metric m, Kind k, Precision p = REFERENCE) const;
+	// те саме для довільних стовпців класу k
+	static void compute(Metric m, Kind k, const View& v, double* out, Precision p = REFERENCE);
+private:
+	Columns cols[KIND_COUNT];
+};
+
+// пакет з параметрами у float: удвічі менше пам'яті і вдвічі більше значень у
+// регістрі. Рахує завжди з точним переведенням кута, як EXACT
+class FloatBatch
+{
+public:
+	struct Columns
+	{
+		std::vector<float> h;
+		std::vector<float> r;
+		std::vector<float> a;
+		std::vector<float> b;
+		std::vector<int> angle;
+		size_t size() const { return h.size(); }
+	};
+	struct View
+	{
+		const float* h;
+		const float* r;
+		const float* a;
+		const float* b;
+		const int* angle;
+		size_t size;
+	};
+
+	FloatBatch() {}
+	// параметри округлюються до найближчих float
+	explicit FloatBatch(const ShapeBatch& batch) { append(batch); }
+	explicit FloatBatch(const LinkedList& list) { addAll(list); }
+
+	void add(const VolShape&);
+	void addAll(const LinkedList&);
+	void addCylinder(double high, double radius);
+	void addParallelepiped(double high, double sideA, double sideB);
+	void addTriPrizm(double high, double sideA, double sideB, int angle);
+	void addConus(double high, double radius);
+	void addRectPiramid(double high, double sideA, double sideB);
+	void addTriPiramid(double high, double sideA, double sideB, int angle);
+	void append(const ShapeBatch& other);
+
+	void reserve(ShapeBatch::Kind k, size_t n);
+	void clear();
+	size_t size() const;
+	size_t size(ShapeBatch::Kind k) const { return cols[k].size(); }
+	const Columns& columns(ShapeBatch::Kind k) const { return cols[k]; }
+	View view(ShapeBatch::Kind k) const;
+
+	void compute(ShapeBatch::Metric m, ShapeBatch::Kind k, float* out) const;
+	std::vector<float> compute(ShapeBatch::Metric m, ShapeBatch::Kind k) const;
+	static void compute(ShapeBatch::Metric m, ShapeBatch::Kind k, const View& v, float* out);
+private:
+	Columns cols[ShapeBatch::KIND_COUNT];
+};
+
+// значення обраної характеристики фігури
+inline double metricOf(const VolShape& v, ShapeBatch::Metric m)
+{
+	switch (m)
+	{
+	case ShapeBatch::VOLUME:       return v.volume();
+	case ShapeBatch::BASE_AREA:    return v.baseArea();
+	case ShapeBatch::SIDE_AREA:    return v.sideArea();
+	case ShapeBatch::SURFACE_AREA: return v.surfaceArea();
+	default:                       return 0.;
+	}
+}
+
+#endif
@@ -0,0 +1,140 @@
+#include "ShapeInterner.h"
+#include "ShapeReader.h"
+#include <stdexcept>
+
+namespace
+{
+// хеш і рівність запису з фігурою, що її створив би ShapeRecord::make -
+// так само, як VolShape::hash і Shape::hash цієї фігури
+size_t hashOf(const ShapeRecord& r)
+{
+	size_t base;
+	switch (r.kind)
+	{
+	case ShapeBatch::CYLINDER:
+	case ShapeBatch::CONUS:
+		base = ShapeHash::mix(ShapeRegistry::tagOf<Circle>(), ShapeHash::of(r.a));
+		break;
+	case ShapeBatch::PARALLELEPIPED:
+	case ShapeBatch::RECTPIRAMID:
+		base = ShapeHash::mix(ShapeHash::mix(ShapeRegistry::tagOf<Rectangle>(), ShapeHash::of(r.a)), ShapeHash::of(r.b));
+		break;
+	default:
+		base = ShapeHash::mix(ShapeHash::mix(ShapeHash::mix(ShapeRegistry::tagOf<Triangle>(), ShapeHash::of(r.a)),
+			ShapeHash::of(r.b)), ShapeHash::of(r.angle));
+		break;
+	}
+	// вбудовані класи зареєстровані в порядку ShapeBatch::Kind
+	return ShapeHash::mix(ShapeHash::mix(r.kind, ShapeHash::of(r.h)), base);
+}
+
+bool matches(const ShapeRecord& r, const VolShape& v)
+{
+	if (v.typeTag() != r.kind || v.high() != r.h || v.getBase() == nullptr) return false;
+	const Shape& base = *v.getBase();
+	switch (r.kind)
+	{
+	case ShapeBatch::CYLINDER:
+	case ShapeBatch::CONUS:
+		return static_cast<const Circle&>(base).radius() == r.a;
+	case ShapeBatch::PARALLELEPIPED:
+	case ShapeBatch::RECTPIRAMID:
+		return static_cast<const Rectangle&>(base).sideA() == r.a && static_cast<const Rectangle&>(base).sideB() == r.b;
+	default:
+	{
+		const Triangle& t = static_cast<const Triangle&>(base);
+		return t.sideA() == r.a && t.sideB() == r.b && t.degrees() == r.angle;
+	}
+	}
+}
+
+ShapeInterner::Item onHeap(const VolShape& v)
+{
+	ShapeArena::Scope scope(nullptr);
+	return ShapeInterner::Item(VolShapeRegistry::type(v.typeTag()).copy(v));
+}
+}
+
+//-----------------------------------------------------------
+
+template<class Equal> const ShapeInterner::Item* ShapeInterner::find(size_t hash, Equal equal)
+{
+	++requests;
+	std::pair<Table::iterator, Table::iterator> same = table.equal_range(hash);
+	for (Table::iterator i = same.first; i != same.second; ++i)
+		if (equal(*i->second))
+		{
+			++found;
+			return &i->second;
+		}
+	return nullptr;
+}
+
+const ShapeInterner::Item& ShapeInterner::add(size_t hash, Item v)
+{
+	return table.emplace(hash, std::move(v))->second;
+}
+
+ShapeInterner::Item ShapeInterner::intern(const VolShape& v)
+{
+	const size_t hash = v.hash();
+	const Item* same = find(hash, [&v](const VolShape& s) { return s == v; });
+	return same != nullptr ? *same : add(hash, onHeap(v));
+}
+
+ShapeInterner::Item ShapeInterner::intern(const Item& v)
+{
+	const size_t hash = v->hash();
+	const Item* same = find(hash, [&v](const VolShape& s) { return s == *v; });
+	if (same != nullptr) return *same;
+	if (!v->placedIn(nullptr)) return add(hash, onHeap(*v));
+	return add(hash, v);
+}
+
+ShapeInterner::Item ShapeInterner::intern(std::unique_ptr<VolShape> v)
+{
+	const size_t hash = v->hash();
+	const Item* same = find(hash, [&v](const VolShape& s) { return s == *v; });
+	if (same != nullptr) return *same;
+	if (!v->placedIn(nullptr)) return add(hash, onHeap(*v));
+	return add(hash, Item(std::move(v)));
+}
+
+ShapeInterner::Item ShapeInterner::intern(const ShapeRecord& r)
+{
+	if (r.kind < 0 || r.kind >= ShapeBatch::KIND_COUNT)
+		throw std::invalid_argument("Error: ShapeInterner needs a built-in shape record\n");
+	const size_t hash = hashOf(r);
+	const Item* same = find(hash, [&r](const VolShape& s) { return matches(r, s); });
+	if (same != nullptr) return *same;
+	ShapeArena::Scope scope(nullptr);
+	return add(hash, Item(r.make()));
+}
+
+size_t ShapeInterner::purge()
+{
+	size_t purged = 0;
+	for (Table::iterator i = table.begin(); i != table.end(); )
+	{
+		if (i->second.use_count() == 1)
+		{
+			i = table.erase(i);
+			++purged;
+		}
+		else ++i;
+	}
+	return purged;
+}
+
+void ShapeInterner::clear()
+{
+	table.clear();
+	requests = found = 0;
+}
+
+size_t ShapeInterner::footprint(const VolShape& v)
+{
+	size_t bytes = VolShapeRegistry::type(v.typeTag()).size;
+	if (v.getBase() != nullptr && !v.inlineBase()) bytes += ShapeRegistry::type(v.getBase()->typeTag()).size;
+	return bytes;
+}
@@ -0,0 +1,73 @@
+/*
+Інтернування фігур: рівні фігури (VolShape::operator== - клас, висота і
+  параметри основи) ділять один незмінний екземпляр. У каталогах багато
+  однакових фігур, і кожна коштує об'єкта в купі (разом з основою, див.
+  VolShape::Place); з інтернером тисяча записів "Cylinder 1 C 1" - це один
+  Cylinder.
+
+Інтернер - хеш-таблиця екземплярів за VolShape::hash. intern повертає
+ екземпляр, рівний аргументу: наявний, якщо такий уже є, або новий, який
+ відтепер і буде спільним. Нова фігура копіюється в купу лише тоді, коли
+ рівної ще немає; intern(ShapeRecord) не створює фігури зовсім, якщо рівна
+ є, тож інтернування можна виконувати прямо при читанні файла (див.
+ ShapeRecord::addTo(PersistentList&)).
+
+Екземпляри спільні (std::shared_ptr<const VolShape>) і незмінні; їх тримає і
+ сам інтернер, поки його не очищено (clear) чи не викинуто фігури, яких більше
+ ніхто не тримає (purge). Фігури розміщуються в купі, як у PersistentList.
+
+Інтернер не синхронізований: ним користується один потік.
+*/
+#ifndef _ShapeInternerHeader_
+#define _ShapeInternerHeader_
+
+#include "VolumeShapes.h"
+#include <memory>
+#include <unordered_map>
+
+struct ShapeRecord;
+
+class ShapeInterner
+{
+public:
+	typedef std::shared_ptr<const VolShape> Item;
+
+	ShapeInterner() : requests(0), found(0) {}
+
+	// копія v стає спільною, лише якщо рівної ще немає
+	Item intern(const VolShape& v);
+	// v стає спільною, якщо рівної ще немає; фігура з ShapeArena копіюється в купу
+	Item intern(const Item& v);
+	Item intern(std::unique_ptr<VolShape> v);
+	// фігура створюється, лише якщо рівної ще немає; запис класу поза
+	// вбудованими (kind == KIND_COUNT) - std::invalid_argument
+	Item intern(const ShapeRecord& r);
+
+	// різних фігур
+	size_t size() const { return table.size(); }
+	// звернень до intern і скільки з них отримали наявний екземпляр
+	size_t lookups() const { return requests; }
+	size_t hits() const { return found; }
+	// викидає фігури, яких, крім інтернера, ніхто не тримає; повертає їхню кількість
+	size_t purge();
+	void clear();
+	// місце в таблиці для n різних фігур
+	void reserve(size_t n) { table.reserve(n); }
+
+	// пам'ять фігури і її основи (sizeof класів, без службових даних купи)
+	static size_t footprint(const VolShape& v);
+private:
+	ShapeInterner(const ShapeInterner&);
+	ShapeInterner& operator=(const ShapeInterner&);
+
+	typedef std::unordered_multimap<size_t, Item> Table;
+	// рівна фігура з хешем hash, для якої equal(фігура) істинне; nullptr, якщо такої немає
+	template<class Equal> const Item* find(size_t hash, Equal equal);
+	const Item& add(size_t hash, Item v);
+
+	Table table;
+	size_t requests;
+	size_t found;
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*
+Спостерігач за вмістом контейнера фігур. LinkedList і ShapeVector повідомляють
+  приєднаних спостерігачів про кожну зміну, тож допоміжні структури (індекси,
+  підсумки) оновлюються разом з контейнером, а не перебудовуються обходом.
+
+Спостерігач отримує фігури за адресою всередині контейнера. LinkedList не
+ переміщує своїх фігур, а ShapeVector при розширенні масиву і зсуві хвоста
+ переносить їх на інше місце - про це повідомляє moved.
+*/
+#ifndef _ShapeObserverHeader_
+#define _ShapeObserverHeader_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+class VolShape;
+
+class ShapeObserver
+{
+public:
+	virtual ~ShapeObserver() {}
+	// фігура вже на своєму місці в контейнері
+	virtual void added(const VolShape& v) = 0;
+	// фігуру от-от буде знищено; вона ще доступна
+	virtual void removed(const VolShape& v) = 0;
+	// контейнер спорожнів, фігури знищено без окремих removed
+	virtual void cleared() = 0;
+	// фігури з адресами від first до last включно перенесено на delta байтів
+	// без зміни їхнього порядку
+	virtual void moved(const VolShape* first, const VolShape* last, std::ptrdiff_t delta) = 0;
+	// спостерігача приєднано до контейнера з такими фігурами; спостерігач, якому
+	// вигідніше прийняти їх разом, ніж по одній, перевизначає цей метод
+	virtual void attached(const std::vector<const VolShape*>& shapes)
+	{
+		for (size_t i = 0; i < shapes.size(); ++i) added(*shapes[i]);
+	}
+};
+
+// спостерігачі одного контейнера; при копіюванні контейнера не копіюються
+class ShapeObservers
+{
+public:
+	ShapeObservers() {}
+	ShapeObservers(const ShapeObservers&) {}
+	ShapeObservers& operator=(const ShapeObservers&) { return *this; }
+
+	bool empty() const { return list.empty(); }
+	void attach(ShapeObserver* o) { list.push_back(o); }
+	void detach(ShapeObserver* o) { list.erase(std::remove(list.begin(), list.end(), o), list.end()); }
+
+	void added(const VolShape& v) const { for (size_t i = 0; i < list.size(); ++i) list[i]->added(v); }
+	void removed(const VolShape& v) const { for (size_t i = 0; i < list.size(); ++i) list[i]->removed(v); }
+	void cleared() const { for (size_t i = 0; i < list.size(); ++i) list[i]->cleared(); }
+	void moved(const VolShape* first, const VolShape* last, std::ptrdiff_t delta) const
+	{
+		for (size_t i = 0; i < list.size(); ++i) list[i]->moved(first, last, delta);
+	}
+private:
+	std::vector<ShapeObserver*> list;
+};
+
+#endif
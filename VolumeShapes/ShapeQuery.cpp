@@ -0,0 +1,485 @@
+#include "ShapeQuery.h"
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SHAPEQUERY_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHAPEQUERY_SSE2
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+// фігур у блоці і 64-бітових слів його маски
+const size_t BLOCK = 256;
+const size_t WORDS = BLOCK / 64;
+const double INF = std::numeric_limits<double>::infinity();
+
+inline size_t bits(std::uint64_t w) { return std::bitset<64>(w).count(); }
+
+// номер найменшого встановленого біта; w != 0
+inline unsigned lowestBit(std::uint64_t w)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long i;
+	_BitScanForward64(&i, w);
+	return i;
+#elif defined(_MSC_VER)
+	unsigned long i;
+	if (_BitScanForward(&i, static_cast<unsigned long>(w))) return i;
+	_BitScanForward(&i, static_cast<unsigned long>(w >> 32));
+	return i + 32;
+#else
+	return static_cast<unsigned>(__builtin_ctzll(w));
+#endif
+}
+
+// Порівняння значень з межами дають біти маски; NaN не входить у жодні межі
+template<bool LO_OPEN, bool HI_OPEN> inline bool inRange(double x, double lo, double hi)
+{
+	return (LO_OPEN ? x > lo : x >= lo) && (HI_OPEN ? x < hi : x <= hi);
+}
+
+template<bool LO_OPEN, bool HI_OPEN> void rangeMask(const double* v, size_t n, double lo, double hi, std::uint64_t* out)
+{
+	for (size_t w = 0; w < WORDS; ++w) out[w] = 0;
+	size_t i = 0;
+#if defined(SHAPEQUERY_AVX2)
+	const __m256d l = _mm256_set1_pd(lo), u = _mm256_set1_pd(hi);
+	for (; i + 4 <= n; i += 4)
+	{
+		const __m256d x = _mm256_loadu_pd(v + i);
+		const __m256d in = _mm256_and_pd(_mm256_cmp_pd(x, l, LO_OPEN ? _CMP_GT_OQ : _CMP_GE_OQ),
+			_mm256_cmp_pd(x, u, HI_OPEN ? _CMP_LT_OQ : _CMP_LE_OQ));
+		out[i / 64] |= static_cast<std::uint64_t>(_mm256_movemask_pd(in)) << (i % 64);
+	}
+#elif defined(SHAPEQUERY_SSE2)
+	const __m128d l = _mm_set1_pd(lo), u = _mm_set1_pd(hi);
+	for (; i + 2 <= n; i += 2)
+	{
+		const __m128d x = _mm_loadu_pd(v + i);
+		const __m128d in = _mm_and_pd(LO_OPEN ? _mm_cmpgt_pd(x, l) : _mm_cmpge_pd(x, l),
+			HI_OPEN ? _mm_cmplt_pd(x, u) : _mm_cmple_pd(x, u));
+		out[i / 64] |= static_cast<std::uint64_t>(_mm_movemask_pd(in)) << (i % 64);
+	}
+#endif
+	for (; i < n; ++i)
+		if (inRange<LO_OPEN, HI_OPEN>(v[i], lo, hi)) out[i / 64] |= std::uint64_t(1) << (i % 64);
+}
+
+void rangeMask(const double* v, size_t n, double lo, double hi, bool loOpen, bool hiOpen, std::uint64_t* out)
+{
+	if (loOpen) hiOpen ? rangeMask<true, true>(v, n, lo, hi, out) : rangeMask<true, false>(v, n, lo, hi, out);
+	else hiOpen ? rangeMask<false, true>(v, n, lo, hi, out) : rangeMask<false, false>(v, n, lo, hi, out);
+}
+
+void fill(std::uint64_t* m, std::uint64_t w)
+{
+	for (size_t i = 0; i < WORDS; ++i) m[i] = w;
+}
+
+bool none(const std::uint64_t* m)
+{
+	for (size_t i = 0; i < WORDS; ++i)
+		if (m[i] != 0) return false;
+	return true;
+}
+
+// стовпці з рядка first; вказівники порожніх стовпців лишаються нульовими
+ShapeBatch::View shift(ShapeBatch::View v, size_t first, size_t n)
+{
+	if (v.h != nullptr) v.h += first;
+	if (v.r != nullptr) v.r += first;
+	if (v.a != nullptr) v.a += first;
+	if (v.b != nullptr) v.b += first;
+	if (v.angle != nullptr) v.angle += first;
+	v.size = n;
+	return v;
+}
+
+// кращий кандидат у top чи bottom; за рівних значень - раніший рядок
+struct Candidate
+{
+	double value;
+	ShapeQuery::Row row;
+};
+inline bool earlier(const ShapeQuery::Row& x, const ShapeQuery::Row& y)
+{
+	return x.kind != y.kind ? x.kind < y.kind : x.index < y.index;
+}
+struct Better
+{
+	bool largest;
+	bool operator()(const Candidate& x, const Candidate& y) const
+	{
+		if (x.value != y.value) return largest ? x.value > y.value : x.value < y.value;
+		return earlier(x.row, y.row);
+	}
+};
+}
+
+// поля одного блока рахуються лише тоді, коли вони потрібні
+struct ShapeQuery::Block
+{
+	ShapeBatch::Kind kind;
+	ShapeBatch::Precision precision;
+	ShapeBatch::View view;
+	size_t first;
+	size_t n;
+	const double* fields[FIELD_COUNT];
+	double buffer[FIELD_COUNT][BLOCK];
+
+	void reset(ShapeBatch::Kind k, ShapeBatch::Precision p, const ShapeBatch::View& all, size_t from)
+	{
+		kind = k;
+		precision = p;
+		first = from;
+		n = std::min(BLOCK, all.size - from);
+		view = shift(all, from, n);
+		for (int f = 0; f < FIELD_COUNT; ++f) fields[f] = nullptr;
+	}
+	const double* field(Field f)
+	{
+		if (fields[f] == nullptr)
+		{
+			if (f == HEIGHT) fields[f] = view.h;
+			else
+			{
+				ShapeBatch::compute(static_cast<ShapeBatch::Metric>(f), kind, view, buffer[f], precision);
+				fields[f] = buffer[f];
+			}
+		}
+		return fields[f];
+	}
+};
+
+//-----------------------------------------------------------
+
+ShapeQuery::Where::Where()
+{
+	Node n = { ALL, VOLUME, 0, 0., 0., false, false, 0, 0 };
+	nodes.push_back(n);
+}
+
+ShapeQuery::Where::Where(const Node& n) : nodes(1, n)
+{
+}
+
+ShapeQuery::Where::Where(const Where& x, const Where& y, Op op) : nodes(x.nodes)
+{
+	Node n = { op, VOLUME, 0, 0., 0., false, false, nodes.size() - 1, nodes.size() - 1 };
+	if (op != NOT)
+	{
+		// вузли y дописуються після вузлів x, тож їхні посилання зсуваються
+		const size_t offset = nodes.size();
+		for (size_t i = 0; i < y.nodes.size(); ++i)
+		{
+			Node m = y.nodes[i];
+			m.left += offset;
+			m.right += offset;
+			nodes.push_back(m);
+		}
+		n.right = nodes.size() - 1;
+	}
+	nodes.push_back(n);
+}
+
+ShapeQuery::Where ShapeQuery::Column::operator<(double x) const
+{
+	Where::Node n = { Where::RANGE, field, 0, -INF, x, false, true, 0, 0 };
+	return Where(n);
+}
+
+ShapeQuery::Where ShapeQuery::Column::operator<=(double x) const
+{
+	Where::Node n = { Where::RANGE, field, 0, -INF, x, false, false, 0, 0 };
+	return Where(n);
+}
+
+ShapeQuery::Where ShapeQuery::Column::operator>(double x) const
+{
+	Where::Node n = { Where::RANGE, field, 0, x, INF, true, false, 0, 0 };
+	return Where(n);
+}
+
+ShapeQuery::Where ShapeQuery::Column::operator>=(double x) const
+{
+	Where::Node n = { Where::RANGE, field, 0, x, INF, false, false, 0, 0 };
+	return Where(n);
+}
+
+ShapeQuery::Where ShapeQuery::between(Field f, double lo, double hi)
+{
+	Where::Node n = { Where::RANGE, f, 0, lo, hi, false, false, 0, 0 };
+	return Where(n);
+}
+
+ShapeQuery::Where ShapeQuery::kind(ShapeBatch::Kind k)
+{
+	Where::Node n = { Where::KIND, VOLUME, 1u << k, 0., 0., false, false, 0, 0 };
+	return Where(n);
+}
+
+const char* ShapeQuery::fieldName(Field f)
+{
+	static const char* names[FIELD_COUNT] = { "volume", "baseArea", "sideArea", "surfaceArea", "h" };
+	return names[f];
+}
+
+//-----------------------------------------------------------
+
+int ShapeQuery::constant(size_t i, int k) const
+{
+	const Where::Node& n = condition.nodes[i];
+	switch (n.op)
+	{
+	case Where::ALL:   return 1;
+	case Where::KIND:  return (n.kinds >> k) & 1;
+	case Where::RANGE: return -1;
+	case Where::AND:
+	{
+		const int x = constant(n.left, k), y = constant(n.right, k);
+		return x == 0 || y == 0 ? 0 : (x == 1 && y == 1 ? 1 : -1);
+	}
+	case Where::OR:
+	{
+		const int x = constant(n.left, k), y = constant(n.right, k);
+		return x == 1 || y == 1 ? 1 : (x == 0 && y == 0 ? 0 : -1);
+	}
+	default:
+	{
+		const int x = constant(n.left, k);
+		return x < 0 ? x : 1 - x;
+	}
+	}
+}
+
+void ShapeQuery::eval(size_t i, Block& b, std::uint64_t* m) const
+{
+	const Where::Node& n = condition.nodes[i];
+	std::uint64_t y[WORDS];
+	switch (n.op)
+	{
+	case Where::ALL:
+		fill(m, ~std::uint64_t(0));
+		break;
+	case Where::KIND:
+		fill(m, (n.kinds >> b.kind) & 1 ? ~std::uint64_t(0) : 0);
+		break;
+	case Where::RANGE:
+		rangeMask(b.field(n.field), b.n, n.lo, n.hi, n.loOpen, n.hiOpen, m);
+		break;
+	case Where::AND:
+		// другий аргумент (і його поля) не рахується, якщо перший відкинув увесь блок
+		eval(n.left, b, m);
+		if (none(m)) break;
+		eval(n.right, b, y);
+		for (size_t w = 0; w < WORDS; ++w) m[w] &= y[w];
+		break;
+	case Where::OR:
+		eval(n.left, b, m);
+		eval(n.right, b, y);
+		for (size_t w = 0; w < WORDS; ++w) m[w] |= y[w];
+		break;
+	case Where::NOT:
+		eval(n.left, b, m);
+		for (size_t w = 0; w < WORDS; ++w) m[w] = ~m[w];
+		break;
+	}
+}
+
+ShapeQuery::ShapeQuery(const ShapeBatch& batch) : batch(batch), source(nullptr), mode(ShapeBatch::REFERENCE)
+{
+}
+
+ShapeQuery::ShapeQuery(const ShapeVector& shapes) : batch(own), source(&shapes), mode(ShapeBatch::REFERENCE)
+{
+	for (size_t i = 0; i < shapes.size(); ++i)
+	{
+		const VolShape& v = shapes[static_cast<int>(i)];
+		const int k = ShapeBatch::kindOf(v);
+		if (k < 0) continue;
+		own.add(v);
+		positions[k].push_back(i);
+	}
+}
+
+ShapeQuery& ShapeQuery::where(const Where& w)
+{
+	condition = w;
+	return *this;
+}
+
+ShapeQuery& ShapeQuery::precision(ShapeBatch::Precision p)
+{
+	mode = p;
+	return *this;
+}
+
+template<class F> void ShapeQuery::scan(unsigned fields, F& visit) const
+{
+	std::unique_ptr<Block> b(new Block);
+	const size_t root = condition.nodes.size() - 1;
+	std::uint64_t m[WORDS];
+	for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k)
+	{
+		const ShapeBatch::View all = batch.view(static_cast<ShapeBatch::Kind>(k));
+		if (all.size == 0 || constant(root, k) == 0) continue;
+		for (size_t from = 0; from < all.size; from += BLOCK)
+		{
+			b->reset(static_cast<ShapeBatch::Kind>(k), mode, all, from);
+			eval(root, *b, m);
+			// біти за кінцем неповного блока
+			for (size_t w = 0; w < WORDS; ++w)
+			{
+				const size_t bit = w * 64;
+				if (bit >= b->n) m[w] = 0;
+				else if (b->n - bit < 64) m[w] &= (std::uint64_t(1) << (b->n - bit)) - 1;
+			}
+			if (none(m)) continue;
+			for (int f = 0; f < FIELD_COUNT; ++f)
+				if (fields & (1u << f)) b->field(static_cast<Field>(f));
+			visit(*b, m);
+		}
+	}
+}
+
+size_t ShapeQuery::count() const
+{
+	size_t total = 0;
+	auto add = [&total](Block&, const std::uint64_t* m)
+	{
+		for (size_t w = 0; w < WORDS; ++w) total += bits(m[w]);
+	};
+	scan(0, add);
+	return total;
+}
+
+std::vector<ShapeQuery::Row> ShapeQuery::select() const
+{
+	return project(0).rows;
+}
+
+ShapeQuery::Projection ShapeQuery::project(unsigned fields) const
+{
+	Projection p;
+	auto collect = [&p, fields](Block& b, const std::uint64_t* m)
+	{
+		for (size_t w = 0; w < WORDS; ++w)
+			for (std::uint64_t bitsLeft = m[w]; bitsLeft != 0; bitsLeft &= bitsLeft - 1)
+			{
+				const size_t i = w * 64 + lowestBit(bitsLeft);
+				Row r = { b.kind, b.first + i };
+				p.rows.push_back(r);
+				for (int f = 0; f < FIELD_COUNT; ++f)
+					if (fields & (1u << f)) p.values[f].push_back(b.fields[f][i]);
+			}
+	};
+	scan(fields, collect);
+	return p;
+}
+
+ShapeQuery::Stats ShapeQuery::aggregate(Field f) const
+{
+	Stats s = { 0, 0., INF, -INF };
+	auto add = [&s, f](Block& b, const std::uint64_t* m)
+	{
+		const double* v = b.fields[f];
+		for (size_t w = 0; w < WORDS; ++w)
+			for (std::uint64_t bitsLeft = m[w]; bitsLeft != 0; bitsLeft &= bitsLeft - 1)
+			{
+				const double x = v[w * 64 + lowestBit(bitsLeft)];
+				++s.count;
+				s.sum += x;
+				if (x < s.min) s.min = x;
+				if (x > s.max) s.max = x;
+			}
+	};
+	scan(1u << f, add);
+	return s;
+}
+
+std::vector<ShapeQuery::Row> ShapeQuery::extremes(Field f, size_t k, bool largest) const
+{
+	std::vector<Row> result;
+	if (k == 0) return result;
+	// у купі k найкращих кандидатів, на вершині - найгірший з них
+	Better better = { largest };
+	std::vector<Candidate> heap;
+	heap.reserve(k);
+	auto offer = [&](Block& b, const std::uint64_t* m)
+	{
+		const double* v = b.fields[f];
+		// поки купа не повна, проходять усі значення, крім NaN; потім - лише кращі
+		// за найгірше в купі (рівні не проходять, бо їхні рядки пізніші)
+		std::uint64_t pass[WORDS];
+		if (heap.size() < k) rangeMask(v, b.n, -INF, INF, false, false, pass);
+		else if (largest) rangeMask(v, b.n, heap.front().value, INF, true, false, pass);
+		else rangeMask(v, b.n, -INF, heap.front().value, false, true, pass);
+		for (size_t w = 0; w < WORDS; ++w)
+			for (std::uint64_t bitsLeft = m[w] & pass[w]; bitsLeft != 0; bitsLeft &= bitsLeft - 1)
+			{
+				const size_t i = w * 64 + lowestBit(bitsLeft);
+				Candidate c = { v[i], { b.kind, b.first + i } };
+				if (heap.size() < k)
+				{
+					heap.push_back(c);
+					std::push_heap(heap.begin(), heap.end(), better);
+				}
+				else if (better(c, heap.front()))
+				{
+					std::pop_heap(heap.begin(), heap.end(), better);
+					heap.back() = c;
+					std::push_heap(heap.begin(), heap.end(), better);
+				}
+			}
+	};
+	scan(1u << f, offer);
+	std::sort_heap(heap.begin(), heap.end(), better);
+	result.reserve(heap.size());
+	for (size_t i = 0; i < heap.size(); ++i) result.push_back(heap[i].row);
+	return result;
+}
+
+std::vector<ShapeQuery::Row> ShapeQuery::top(Field f, size_t k) const
+{
+	return extremes(f, k, true);
+}
+
+std::vector<ShapeQuery::Row> ShapeQuery::bottom(Field f, size_t k) const
+{
+	return extremes(f, k, false);
+}
+
+double ShapeQuery::value(const Row& r, Field f) const
+{
+	if (r.index >= batch.size(r.kind))
+		throw std::out_of_range("Error: Cannot get element at specified position\n");
+	const ShapeBatch::View one = shift(batch.view(r.kind), r.index, 1);
+	if (f == HEIGHT) return *one.h;
+	double x;
+	ShapeBatch::compute(static_cast<ShapeBatch::Metric>(f), r.kind, one, &x, mode);
+	return x;
+}
+
+size_t ShapeQuery::position(const Row& r) const
+{
+	if (source == nullptr) throw std::invalid_argument("Error: Query is not built from a ShapeVector\n");
+	if (r.index >= positions[r.kind].size())
+		throw std::out_of_range("Error: Cannot get element at specified position\n");
+	return positions[r.kind][r.index];
+}
+
+const VolShape& ShapeQuery::shape(const Row& r) const
+{
+	return (*source)[static_cast<int>(position(r))];
+}
@@ -0,0 +1,154 @@
+/*
+Запити до наборів фігур: фільтр, проєкція, агрегати і top-k. Досі єдиним
+  запитом був findFirst_if - лише перша фігура, лише функція без стану, і
+  віртуальний виклик на кожну фігуру.
+
+Умова запиту (Where) складається з простих умов операторами &&, || і !:
+  ShapeQuery::column(ShapeQuery::VOLUME) > 100. && !ShapeQuery::kind(ShapeBatch::CONUS)
+ Прості умови - клас фігури і порівняння поля з числом; поля - чотири
+ характеристики ShapeBatch і висота.
+
+Запит виконується над стовпцями ShapeBatch блоками по 256 фігур одного класу:
+ потрібні поля блока рахуються векторними циклами ShapeBatch::compute (тож
+ значення ті самі, що в пакеті), порівняння дають бітові маски SIMD-командами
+ (AVX2, SSE2 або скалярно, як у ShapeBatch), а && і || - це побітові операції
+ над масками. Поле, якого умова не торкається, не рахується зовсім, а класи,
+ які умова відкидає цілком (kind), не переглядаються.
+
+Результат - рядки Row (клас і номер у його стовпцях), а не копії фігур. Запит,
+ побудований з ShapeVector, ще й знає номер кожного рядка у векторі (position)
+ і саму фігуру (shape). Фігури класів поза шістьма вбудованими ShapeBatch не
+ підтримує, тож такий запит їх пропускає.
+
+Порядок рядків - за класами в порядку ShapeBatch::Kind, а в межах класу - за
+ номером; top і bottom впорядковані за значенням, рівні значення - в тому ж
+ порядку рядків. Сума в aggregate додається в цьому ж порядку.
+
+Поля рахуються ShapeBatch::compute з точністю precision (спочатку
+ ShapeBatch::REFERENCE), тож значення збігаються біт у біт з ShapeBatch, а не з
+ віртуальними методами: для TriPrizm і TriPiramid вони можуть відрізнятися на
+ кілька ULP (межі - в ShapeBatch.h). Тому умова на самій межі, скажімо
+ volume > x, може відібрати не ті фігури, що findFirst_if(v->volume() > x).
+
+Запит тримає посилання на пакет чи вектор; їх не можна змінювати, поки запит
+ використовується.
+*/
+#ifndef _ShapeQueryHeader_
+#define _ShapeQueryHeader_
+
+#include "ShapeBatch.h"
+#include "ShapeVector.h"
+#include <cstdint>
+#include <vector>
+
+class ShapeQuery
+{
+public:
+	// перші чотири збігаються з ShapeBatch::Metric
+	enum Field { VOLUME, BASE_AREA, SIDE_AREA, SURFACE_AREA, HEIGHT, FIELD_COUNT };
+
+	class Where
+	{
+	public:
+		// умова, якій відповідає кожна фігура
+		Where();
+		friend Where operator&&(const Where& x, const Where& y) { return Where(x, y, AND); }
+		friend Where operator||(const Where& x, const Where& y) { return Where(x, y, OR); }
+		friend Where operator!(const Where& x) { return Where(x, x, NOT); }
+	private:
+		friend class ShapeQuery;
+		enum Op { ALL, KIND, RANGE, AND, OR, NOT };
+		struct Node
+		{
+			Op op;
+			Field field;
+			unsigned kinds;           // KIND: маска 1 << ShapeBatch::Kind
+			double lo, hi;            // RANGE: значення поля в межах від lo до hi
+			bool loOpen, hiOpen;      // межа не входить
+			size_t left, right;       // номери вузлів-аргументів
+		};
+		explicit Where(const Node& n);
+		Where(const Where& x, const Where& y, Op op);
+		// вузли в порядку обчислення, останній - корінь
+		std::vector<Node> nodes;
+	};
+	// поле для порівнянь: column(VOLUME) >= 10.
+	struct Column
+	{
+		Field field;
+		Where operator<(double x) const;
+		Where operator<=(double x) const;
+		Where operator>(double x) const;
+		Where operator>=(double x) const;
+	};
+	static Column column(Field f) { Column c = { f }; return c; }
+	// значення поля в межах [lo, hi]
+	static Where between(Field f, double lo, double hi);
+	static Where kind(ShapeBatch::Kind k);
+	static const char* fieldName(Field f);
+
+	// рядок результату: клас фігури і її номер у стовпцях цього класу
+	struct Row
+	{
+		ShapeBatch::Kind kind;
+		size_t index;
+	};
+	struct Stats
+	{
+		size_t count;
+		double sum;
+		double min;               // при count == 0 - +нескінченність
+		double max;               // при count == 0 - -нескінченність
+	};
+	// рядки разом із значеннями обраних полів; values[f] порожній, якщо поля не обрано
+	struct Projection
+	{
+		std::vector<Row> rows;
+		std::vector<double> values[FIELD_COUNT];
+	};
+
+	explicit ShapeQuery(const ShapeBatch& batch);
+	// копіює параметри фігур вектора в пакет запиту
+	explicit ShapeQuery(const ShapeVector& shapes);
+
+	// замінює умову; спочатку запит вибирає всі фігури
+	ShapeQuery& where(const Where& w);
+	ShapeQuery& precision(ShapeBatch::Precision p);
+
+	size_t count() const;
+	std::vector<Row> select() const;
+	// fields - бітова маска з 1 << Field
+	Projection project(unsigned fields) const;
+	Stats aggregate(Field f) const;
+	// k рядків з найбільшим значенням поля за спаданням і з найменшим - за зростанням
+	std::vector<Row> top(Field f, size_t k) const;
+	std::vector<Row> bottom(Field f, size_t k) const;
+
+	double value(const Row& r, Field f) const;
+	// лише для запиту з ShapeVector, інакше - std::invalid_argument
+	size_t position(const Row& r) const;
+	const VolShape& shape(const Row& r) const;
+private:
+	ShapeQuery(const ShapeQuery&);
+	ShapeQuery& operator=(const ShapeQuery&);
+
+	struct Block;
+	// 1 чи 0, якщо вузол i умови однаковий для всіх фігур класу k; -1 - залежить від полів
+	int constant(size_t i, int k) const;
+	// маска блока для вузла i умови
+	void eval(size_t i, Block& b, std::uint64_t* m) const;
+	// викликає visit(блок, маска) для кожного блока, де умові відповідає хоч одна фігура;
+	// поля з маски fields у такому блоці вже пораховані
+	template<class F> void scan(unsigned fields, F& visit) const;
+	std::vector<Row> extremes(Field f, size_t k, bool largest) const;
+
+	ShapeBatch own;
+	const ShapeBatch& batch;
+	const ShapeVector* source;
+	// для запиту з ShapeVector: номер у векторі кожного рядка кожного класу
+	std::vector<size_t> positions[ShapeBatch::KIND_COUNT];
+	Where condition;
+	ShapeBatch::Precision mode;
+};
+
+#endif
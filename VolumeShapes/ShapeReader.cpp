@@ -0,0 +1,465 @@
+#include "ShapeReader.h"
+#include "PersistentList.h"
+#include "ShapeVector.h"
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+struct ClassInfo
+{
+	const char* name;
+	size_t length;
+	ShapeBatch::Kind kind;
+	char base;    // літера основи у форматі storeOn
+	int params;   // кількість параметрів основи
+};
+const ClassInfo classes[] =
+{
+	{ "Cylinder",       8, ShapeBatch::CYLINDER,       'C', 1 },
+	{ "Parallelepiped", 14, ShapeBatch::PARALLELEPIPED, 'R', 2 },
+	{ "TriPrizm",       8, ShapeBatch::TRIPRIZM,       'T', 3 },
+	{ "Conus",          5, ShapeBatch::CONUS,          'C', 1 },
+	{ "RectPiramid",    11, ShapeBatch::RECTPIRAMID,    'R', 2 },
+	{ "TriPiramid",     10, ShapeBatch::TRIPIRAMID,     'T', 3 },
+};
+
+inline bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f'; }
+inline bool isBlank(char c) { return c != '\n' && isSpace(c); }
+inline bool isLetter(char c) { return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'); }
+
+const ClassInfo* findClass(const char* b, size_t len)
+{
+	for (size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); ++i)
+		if (classes[i].length == len && std::memcmp(classes[i].name, b, len) == 0) return &classes[i];
+	return nullptr;
+}
+
+// слово [b, e) - число цілком
+template<class T> bool parse(const char* b, const char* e, T& x)
+{
+	// operator>> приймає явний плюс, from_chars - ні; "+-5" operator>> відкидає
+	if (*b == '+' && e - b > 1 && b[1] != '-') ++b;
+	std::from_chars_result res = std::from_chars(b, e, x);
+	return res.ec == std::errc() && res.ptr == e;
+}
+
+// кількість з першого рядка - лише підказка для reserve
+void reserve(ShapeVector& out, long long n)
+{
+	if (n > 0) out.reserve(out.size() + static_cast<size_t>(n));
+}
+
+// у ShapeBatch розподіл за класами наперед невідомий, а PersistentList резерву не має
+template<class Out> void reserve(Out&, long long)
+{
+}
+
+const char* const statusNames[] =
+{
+	"ok", "end of text", "bad class name", "bad base letter", "missing field",
+	"extra field", "bad number", "value out of range",
+};
+}
+
+ShapeRecord ShapeRecord::of(const VolShape& v)
+{
+	const int kind = ShapeBatch::kindOf(v);
+	if (kind < 0) throw VolShape::BadClassname(v.getClassName());
+	ShapeRecord r;
+	r.kind = static_cast<ShapeBatch::Kind>(kind);
+	r.h = v.high();
+	r.a = r.b = 0.;
+	r.angle = 0;
+	const Shape* s = v.getBase();
+	switch (r.kind)
+	{
+	case ShapeBatch::CYLINDER:
+	case ShapeBatch::CONUS:
+		r.a = static_cast<const Circle*>(s)->radius();
+		break;
+	case ShapeBatch::PARALLELEPIPED:
+	case ShapeBatch::RECTPIRAMID:
+		r.a = static_cast<const Rectangle*>(s)->sideA();
+		r.b = static_cast<const Rectangle*>(s)->sideB();
+		break;
+	default:
+	{
+		const Triangle* t = static_cast<const Triangle*>(s);
+		r.a = t->sideA();
+		r.b = t->sideB();
+		r.angle = t->degrees();
+		break;
+	}
+	}
+	return r;
+}
+
+VolShape* ShapeRecord::make() const
+{
+	switch (kind)
+	{
+	case ShapeBatch::CYLINDER:       return new Cylinder(h, a);
+	case ShapeBatch::PARALLELEPIPED: return new Parallelepiped(h, a, b);
+	case ShapeBatch::TRIPRIZM:       return new TriPrizm(h, a, b, angle);
+	case ShapeBatch::CONUS:          return new Conus(h, a);
+	case ShapeBatch::RECTPIRAMID:    return new RectPiramid(h, a, b);
+	case ShapeBatch::TRIPIRAMID:     return new TriPiramid(h, a, b, angle);
+	default:                         return nullptr;
+	}
+}
+
+void ShapeRecord::addTo(ShapeVector& out) const
+{
+	switch (kind)
+	{
+	case ShapeBatch::CYLINDER:       out.emplace<Cylinder>(h, a); break;
+	case ShapeBatch::PARALLELEPIPED: out.emplace<Parallelepiped>(h, a, b); break;
+	case ShapeBatch::TRIPRIZM:       out.emplace<TriPrizm>(h, a, b, angle); break;
+	case ShapeBatch::CONUS:          out.emplace<Conus>(h, a); break;
+	case ShapeBatch::RECTPIRAMID:    out.emplace<RectPiramid>(h, a, b); break;
+	case ShapeBatch::TRIPIRAMID:     out.emplace<TriPiramid>(h, a, b, angle); break;
+	default: break;
+	}
+}
+
+void ShapeRecord::addTo(ShapeBatch& out) const
+{
+	switch (kind)
+	{
+	case ShapeBatch::CYLINDER:       out.addCylinder(h, a); break;
+	case ShapeBatch::PARALLELEPIPED: out.addParallelepiped(h, a, b); break;
+	case ShapeBatch::TRIPRIZM:       out.addTriPrizm(h, a, b, angle); break;
+	case ShapeBatch::CONUS:          out.addConus(h, a); break;
+	case ShapeBatch::RECTPIRAMID:    out.addRectPiramid(h, a, b); break;
+	case ShapeBatch::TRIPIRAMID:     out.addTriPiramid(h, a, b, angle); break;
+	default: break;
+	}
+}
+
+void ShapeRecord::addTo(PersistentList& out) const
+{
+	if (kind < 0 || kind >= ShapeBatch::KIND_COUNT) return;
+	if (out.interner() != nullptr) out.addtoEnd(out.interner()->intern(*this));
+	else out.addtoEnd(std::unique_ptr<VolShape>(make()));
+}
+
+//-----------------------------------------------------------
+
+bool ShapeReader::token(const char*& b, const char*& e)
+{
+	while (cur != last && isSpace(*cur))
+	{
+		if (*cur == '\n') ++lineNo;
+		++cur;
+	}
+	if (cur == last) return false;
+	b = cur;
+	while (cur != last && !isSpace(*cur)) ++cur;
+	e = cur;
+	return true;
+}
+
+double ShapeReader::number()
+{
+	const char* b;
+	const char* e;
+	double x = 0.;
+	if (token(b, e) && parse(b, e, x)) return x;
+	skipLine();
+	throw std::invalid_argument("Error: Bad number in shape record\n");
+}
+
+int ShapeReader::integer()
+{
+	const char* b;
+	const char* e;
+	int x = 0;
+	if (token(b, e) && parse(b, e, x)) return x;
+	skipLine();
+	throw std::invalid_argument("Error: Bad number in shape record\n");
+}
+
+void ShapeReader::skipLine()
+{
+	const void* nl = std::memchr(cur, '\n', last - cur);
+	if (nl == nullptr)
+	{
+		cur = last;
+		return;
+	}
+	cur = static_cast<const char*>(nl) + 1;
+	++lineNo;
+}
+
+bool ShapeReader::readCount(long long& n)
+{
+	const char* save = cur;
+	size_t saveLine = lineNo;
+	const char* b;
+	const char* e;
+	if (token(b, e))
+	{
+		std::from_chars_result res = std::from_chars(b, e, n);
+		if (res.ec == std::errc() && res.ptr == e) return true;
+	}
+	cur = save;
+	lineNo = saveLine;
+	return false;
+}
+
+bool ShapeReader::next(ShapeRecord& r)
+{
+	return read(r, nullptr);
+}
+
+bool ShapeReader::next(ShapeRecord& r, std::unique_ptr<VolShape>& other)
+{
+	return read(r, &other);
+}
+
+bool ShapeReader::read(ShapeRecord& r, std::unique_ptr<VolShape>* other)
+{
+	const char* b;
+	const char* e;
+	if (!token(b, e)) return false;
+	recordNo = lineNo;
+	SHAPES_COUNT(RECORDS_PARSED);
+	const size_t len = e - b;
+	const ClassInfo* info = findClass(b, len);
+	if (info == nullptr)
+	{
+		const VolShapeRegistry::Type* type = other != nullptr ? VolShapeRegistry::find(b, len) : nullptr;
+		if (type == nullptr || type->make == nullptr)
+		{
+			skipLine();
+			throw VolShape::BadClassname(std::string(b, e).c_str());
+		}
+		// параметри класу розбирає його власна функція, тому через потік
+		const void* nl = std::memchr(cur, '\n', last - cur);
+		std::istringstream rest(std::string(cur, nl != nullptr ? static_cast<const char*>(nl) : last));
+		skipLine();
+		std::unique_ptr<VolShape> made(type->make(rest));
+		if (!rest) throw std::invalid_argument("Error: Bad number in shape record\n");
+		r.kind = ShapeBatch::KIND_COUNT;
+		*other = std::move(made);
+		return true;
+	}
+	r.kind = info->kind;
+	r.h = number();
+	// необов'язкова літера основи (формат storeOn)
+	const char* save = cur;
+	size_t saveLine = lineNo;
+	if (token(b, e) && isLetter(*b))
+	{
+		if (e - b != 1 || *b != info->base)
+		{
+			skipLine();
+			throw VolShape::BadClassname(std::string(b, e).c_str());
+		}
+	}
+	else
+	{
+		cur = save;
+		lineNo = saveLine;
+	}
+	r.a = number();
+	r.b = info->params > 1 ? number() : 0.;
+	r.angle = info->params > 2 ? integer() : 0;
+	return true;
+}
+
+const char* ShapeReader::describe(Status s)
+{
+	return s >= OK && s < STATUS_COUNT ? statusNames[s] : "unknown";
+}
+
+bool ShapeReader::field(const char*& b, const char*& e)
+{
+	while (cur != last && isBlank(*cur)) ++cur;
+	if (cur == last || *cur == '\n') return false;
+	b = cur;
+	while (cur != last && !isSpace(*cur)) ++cur;
+	e = cur;
+	return true;
+}
+
+ShapeReader::Status ShapeReader::positive(double& x)
+{
+	const char* b;
+	const char* e;
+	if (!field(b, e)) return MISSING_FIELD;
+	if (!parse(b, e, x)) return BAD_NUMBER;
+	// заперечення ловить і NaN
+	if (!(x > 0.) || x == std::numeric_limits<double>::infinity()) return OUT_OF_RANGE;
+	return OK;
+}
+
+ShapeReader::Status ShapeReader::reject(Status s)
+{
+	// читач уже в рядку запису, тож до його кінця - лише залишок рядка
+	skipLine();
+	return s;
+}
+
+ShapeReader::Status ShapeReader::tryNext(ShapeRecord& r)
+{
+	const char* b;
+	const char* e;
+	if (!token(b, e)) return END;
+	recordNo = lineNo;
+	SHAPES_COUNT(RECORDS_PARSED);
+	const ClassInfo* info = findClass(b, e - b);
+	if (info == nullptr) return reject(BAD_CLASSNAME);
+	r.kind = info->kind;
+	Status s = positive(r.h);
+	if (s != OK) return reject(s);
+	// необов'язкова літера основи (формат storeOn); field не переходить рядок, тож lineNo не змінюється
+	const char* save = cur;
+	double x;
+	// inf і nan - теж слова з літер, але це числа
+	if (field(b, e) && isLetter(*b) && !parse(b, e, x))
+	{
+		if (e - b != 1 || *b != info->base) return reject(BAD_BASE);
+	}
+	else cur = save;
+	s = positive(r.a);
+	if (s != OK) return reject(s);
+	r.b = 0.;
+	r.angle = 0;
+	if (info->params > 1 && (s = positive(r.b)) != OK) return reject(s);
+	if (info->params > 2)
+	{
+		if (!field(b, e)) return reject(MISSING_FIELD);
+		if (!parse(b, e, r.angle)) return reject(BAD_NUMBER);
+		if (r.angle <= 0 || r.angle >= 180) return reject(OUT_OF_RANGE);
+	}
+	if (field(b, e)) return reject(EXTRA_FIELD);
+	return OK;
+}
+
+//-----------------------------------------------------------
+
+size_t ShapeReader::load(const char* path, ShapeVector& out)
+{
+	MappedFile file(path);
+	ShapeReader in(file);
+	long long n;
+	if (in.readCount(n) && n > 0) out.reserve(out.size() + static_cast<size_t>(n));
+	// фігури створюються одразу в комірках вектора, а їхні основи - в його пулі, якщо він є
+	ShapeRecord r;
+	size_t loaded = 0;
+	while (in.next(r))
+	{
+		r.addTo(out);
+		++loaded;
+	}
+	return loaded;
+}
+
+size_t ShapeReader::load(const char* path, ShapeBatch& out)
+{
+	MappedFile file(path);
+	ShapeReader in(file);
+	long long n;
+	in.readCount(n);
+	ShapeRecord r;
+	size_t loaded = 0;
+	while (in.next(r))
+	{
+		r.addTo(out);
+		++loaded;
+	}
+	return loaded;
+}
+
+size_t ShapeReader::load(const char* path, PersistentList& out)
+{
+	MappedFile file(path);
+	ShapeReader in(file);
+	long long n;
+	in.readCount(n);
+	// фігури списку живуть у купі, а не в поточному пулі
+	ShapeArena::Scope scope(nullptr);
+	ShapeRecord r;
+	size_t loaded = 0;
+	while (in.next(r))
+	{
+		r.addTo(out);
+		++loaded;
+	}
+	return loaded;
+}
+
+template<class Out> ShapeReader::Report ShapeReader::loadChecked(ShapeReader& in, Out& out, const Options& opt)
+{
+	Report report = { 0, -1, 0, {}, false, std::vector<Issue>() };
+	long long n;
+	if (in.readCount(n))
+	{
+		report.declared = n;
+		reserve(out, n);
+	}
+	ShapeRecord r;
+	for (;;)
+	{
+		const Status s = in.tryNext(r);
+		if (s == END) break;
+		if (s != OK)
+		{
+			++report.errorCount;
+			++report.byStatus[s];
+			if (report.errors.size() < opt.maxErrors)
+			{
+				Issue issue = { in.recordLine(), s };
+				report.errors.push_back(issue);
+			}
+			if (opt.policy == ABORT)
+			{
+				report.aborted = true;
+				break;
+			}
+			if (opt.policy == SKIP) continue;
+			r = opt.substitute;
+		}
+		r.addTo(out);
+		++report.loaded;
+	}
+	return report;
+}
+
+ShapeReader::Report ShapeReader::load(const char* path, ShapeVector& out, const Options& opt)
+{
+	MappedFile file(path);
+	return load(file.data(), file.end(), out, opt);
+}
+
+ShapeReader::Report ShapeReader::load(const char* path, ShapeBatch& out, const Options& opt)
+{
+	MappedFile file(path);
+	return load(file.data(), file.end(), out, opt);
+}
+
+ShapeReader::Report ShapeReader::load(const char* path, PersistentList& out, const Options& opt)
+{
+	MappedFile file(path);
+	ShapeReader in(file);
+	// фігури списку живуть у купі, а не в поточному пулі
+	ShapeArena::Scope scope(nullptr);
+	return loadChecked(in, out, opt);
+}
+
+ShapeReader::Report ShapeReader::load(const char* begin, const char* end, ShapeVector& out, const Options& opt)
+{
+	ShapeReader in(begin, end);
+	return loadChecked(in, out, opt);
+}
+
+ShapeReader::Report ShapeReader::load(const char* begin, const char* end, ShapeBatch& out, const Options& opt)
+{
+	ShapeReader in(begin, end);
+	return loadChecked(in, out, opt);
+}
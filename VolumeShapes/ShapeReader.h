@@ -0,0 +1,165 @@
+/*
+Швидке читання файлів фігур. VolShape::MakeInstance читає кожне слово через
+  operator>> потоку: з урахуванням локалі, з перевірками стану потоку і з
+  тимчасовим рядком для імені класу. ShapeReader розбирає текст прямо в
+  пам'яті (зазвичай це відображений MappedFile): імена класів порівнюються на
+  місці, числа перетворюються std::from_chars, жодного виділення пам'яті на
+  запис не відбувається.
+
+Розуміє обидва формати, що є в проєкті:
+ - volShapes.txt: ім'я класу, висота і параметри основи (Cylinder 3.5 1.5);
+ - storage.txt, як пише storeOn: після висоти стоїть літера основи
+   C, R або T (Cylinder 3.5 C 1.5).
+ Як і operator>>, next не залежить від розбиття на рядки - слова
+ розділяються будь-якими пробільними символами.
+
+tryNext - розбір без винятків для брудних файлів, де погані записи
+ трапляються тисячами і розкручування стека після кожного займало б більше
+ часу, ніж сам розбір. Запис має займати один рядок (як пише storeOn), тож
+ tryNext перевіряє ще й кількість полів і допустимі значення, а помилковий
+ запис пропускає переходом до наступного рядка, без посимвольного читання.
+ load з Options так само завантажує файл у контейнер, пропускаючи помилкові
+ записи, підставляючи замість них фігуру за замовчанням або зупиняючись на
+ першому, і повертає звіт з номерами рядків і кодами помилок.
+*/
+#ifndef _ShapeReaderHeader_
+#define _ShapeReaderHeader_
+
+#include "ShapeBatch.h"
+#include "MappedFile.h"
+#include <memory>
+#include <vector>
+
+class PersistentList;
+class ShapeVector;
+
+// один запис файла фігур
+struct ShapeRecord
+{
+	// KIND_COUNT - фігура іншого зареєстрованого класу (див. ShapeReader::next)
+	ShapeBatch::Kind kind;
+	double h;
+	double a;  // радіус для Cylinder і Conus
+	double b;
+	int angle;
+	// запис фігури вбудованого класу; інший клас - VolShape::BadClassname
+	static ShapeRecord of(const VolShape& v);
+	// створює в купі (чи в поточному ShapeArena) фігуру відповідного класу
+	VolShape* make() const;
+	// додає фігуру в кінець контейнера
+	void addTo(ShapeVector& out) const;
+	void addTo(ShapeBatch& out) const;
+	// у режимі інтернування списку фігура створюється, лише якщо рівної в інтернері ще немає
+	void addTo(PersistentList& out) const;
+};
+
+class ShapeReader
+{
+public:
+	// результат tryNext
+	enum Status
+	{
+		OK,
+		END,            // текст закінчився
+		BAD_CLASSNAME,  // ім'я не одного з шести вбудованих класів
+		BAD_BASE,       // літера основи іншого класу чи не літера
+		MISSING_FIELD,  // рядок закінчився раніше за параметри
+		EXTRA_FIELD,    // після параметрів у рядку ще щось є
+		BAD_NUMBER,     // поле - не число
+		OUT_OF_RANGE,   // висота чи сторона не додатна або нескінченна, кут поза (0, 180)
+		STATUS_COUNT
+	};
+	static const char* describe(Status s);
+
+	// що робить load з Options з помилковим записом
+	enum Policy
+	{
+		SKIP,        // пропускає
+		SUBSTITUTE,  // додає замість нього Options::substitute
+		ABORT        // зупиняється; уже додані фігури лишаються в контейнері
+	};
+	struct Options
+	{
+		Policy policy;
+		ShapeRecord substitute;  // типово Cylinder(), як у Program.cpp
+		size_t maxErrors;        // скільки помилок зберігати у звіті (рахуються всі)
+		Options() : policy(SKIP), maxErrors(100)
+		{
+			substitute.kind = ShapeBatch::CYLINDER;
+			substitute.h = substitute.a = 1.;
+			substitute.b = 0.;
+			substitute.angle = 0;
+		}
+	};
+	struct Issue
+	{
+		size_t line;          // номер рядка, з 1
+		Status status;
+	};
+	struct Report
+	{
+		size_t loaded;        // додано фігур, разом з підставленими
+		long long declared;   // кількість з першого рядка, -1 - якщо її немає
+		size_t errorCount;    // усіх помилкових записів
+		size_t byStatus[STATUS_COUNT];
+		bool aborted;         // зупинено на помилці за політикою ABORT
+		std::vector<Issue> errors;  // перші maxErrors з них
+	};
+
+	// firstLine - номер рядка, з якого починається текст (для шматка файла)
+	ShapeReader(const char* begin, const char* end, size_t firstLine = 1)
+		: cur(begin), last(end), lineNo(firstLine), recordNo(firstLine) {}
+	explicit ShapeReader(const MappedFile& f) : cur(f.data()), last(f.end()), lineNo(1), recordNo(1) {}
+
+	// кількість фігур з першого слова файла; false, якщо це не ціле число
+	bool readCount(long long& n);
+	// наступний запис; false, коли текст закінчився. Невідоме ім'я класу чи
+	// літера основи - VolShape::BadClassname, нечислове значення параметра -
+	// std::invalid_argument. Після винятку читання продовжується з наступного рядка
+	bool next(ShapeRecord& r);
+	// те саме, але ім'я класу, якого немає серед шести вбудованих, шукається у
+	// VolShapeRegistry, і решта рядка читається функцією make класу, як у
+	// MakeInstance. Така фігура повертається в other, а r.kind = KIND_COUNT
+	bool next(ShapeRecord& r, std::unique_ptr<VolShape>& other);
+	// наступний запис без винятків: OK, END, коли текст закінчився, або код
+	// помилки. Запис - один рядок: ім'я вбудованого класу, висота, необов'язкова
+	// літера основи і параметри основи, більше нічого. Після помилки читач
+	// стоїть на початку наступного рядка, а r не визначений
+	Status tryNext(ShapeRecord& r);
+	// номер рядка, в якому зараз стоїть читач (з 1)
+	size_t line() const { return lineNo; }
+	// рядок, з якого почався останній запис, прочитаний next (зокрема помилковий)
+	size_t recordLine() const { return recordNo; }
+	const char* position() const { return cur; }
+
+	// завантажує весь файл у контейнер; повертає кількість прочитаних фігур
+	static size_t load(const char* path, ShapeVector& out);
+	static size_t load(const char* path, ShapeBatch& out);
+	static size_t load(const char* path, PersistentList& out);
+	// те саме через tryNext, з політикою для помилкових записів; винятків під
+	// час розбору немає, лише std::runtime_error, якщо файл не вдалося відкрити
+	static Report load(const char* path, ShapeVector& out, const Options& opt);
+	static Report load(const char* path, ShapeBatch& out, const Options& opt);
+	static Report load(const char* path, PersistentList& out, const Options& opt);
+	// те саме для тексту в пам'яті
+	static Report load(const char* begin, const char* end, ShapeVector& out, const Options& opt);
+	static Report load(const char* begin, const char* end, ShapeBatch& out, const Options& opt);
+private:
+	bool token(const char*& b, const char*& e);
+	// наступне слово в поточному рядку; false - рядок закінчився
+	bool field(const char*& b, const char*& e);
+	Status positive(double& x);
+	Status reject(Status s);
+	double number();
+	int integer();
+	void skipLine();
+	bool read(ShapeRecord& r, std::unique_ptr<VolShape>* other);
+	template<class Out> static Report loadChecked(ShapeReader& in, Out& out, const Options& opt);
+
+	const char* cur;
+	const char* last;
+	size_t lineNo;
+	size_t recordNo;
+};
+
+#endif
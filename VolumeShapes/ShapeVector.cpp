@@ -0,0 +1,322 @@
+#include "ShapeVector.h"
+#include "ShapeBatch.h"
+#include "ShapeWriter.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <functional>
+#include <new>
+
+constexpr size_t ShapeVector::SLOT_SIZE;
+
+ShapeVector::ShapeVector(const ShapeVector& other)
+	: data(nullptr), count(0), cap(0), pool(other.pool ? new ShapeArena : nullptr)
+{
+	reserve(other.count);
+	ShapeArena::Scope scope(pool);
+	for (; count < other.count; ++count)
+		place(data + count * SLOT_SIZE, *other.at(count));
+}
+
+ShapeVector& ShapeVector::operator=(const ShapeVector& other)
+{
+	if (this == &other) return *this;
+	removeAll();
+	reserve(other.count);
+	ShapeArena::Scope scope(pool);
+	for (; count < other.count; ++count)
+		place(data + count * SLOT_SIZE, *other.at(count));
+	if (!observers.empty())
+		for (size_t i = 0; i < count; ++i) observers.added(*at(i));
+	return *this;
+}
+
+ShapeVector::~ShapeVector()
+{
+	removeAll();
+	::operator delete(data);
+	delete pool;
+}
+
+//-----------------------------------------------------------
+
+const VolShapeRegistry::Type& ShapeVector::slotType(const VolShape& v)
+{
+	const VolShapeRegistry::Type& type = VolShapeRegistry::type(v.typeTag());
+	// зареєстрований пізніше клас, більший за комірку, вектор зберігати не може
+	if (type.size > SLOT_SIZE || type.align > SLOT_ALIGN) throw VolShape::BadClassname(type.name);
+	return type;
+}
+
+VolShape* ShapeVector::place(void* slot, const VolShape& v)
+{
+	return slotType(v).place(slot, v);
+}
+
+VolShape* ShapeVector::shift(void* slot, VolShape& v)
+{
+	VolShape* moved = slotType(v).move(slot, v);
+	v.~VolShape();
+	return moved;
+}
+
+VolShape* ShapeVector::adopt(void* slot, std::unique_ptr<VolShape>& val) const
+{
+	// пул звільняє пам'ять без деструкторів, тож фігура з основою в купі мусить бути копією
+	if (pool != nullptr && !val->placedIn(pool))
+		return place(slot, *val);
+	VolShape* moved = slotType(*val).move(slot, *val);
+	val.reset();
+	return moved;
+}
+
+void ShapeVector::settle(size_t index, VolShape& made)
+{
+	for (size_t i = count; i > index; --i)
+		shift(data + i * SLOT_SIZE, *at(i - 1));
+	shift(data + index * SLOT_SIZE, made);
+	++count;
+	if (index + 1 < count) observers.moved(at(index), at(count - 2), SLOT_SIZE);
+	observers.added(*at(index));
+}
+
+void ShapeVector::relocate(size_t n)
+{
+	unsigned char* fresh = static_cast<unsigned char*>(::operator new(n * SLOT_SIZE));
+	size_t done = 0;
+	try
+	{
+		ShapeArena::Scope scope(pool);
+		for (; done < count; ++done)
+			shift(fresh + done * SLOT_SIZE, *at(done));
+	}
+	catch (...)
+	{
+		// виняток можливий лише для класу, що не переноситься без винятків і тому
+		// копіюється; вже перенесені фігури повертаються на свої місця
+		while (done > 0)
+		{
+			--done;
+			shift(at(done), *reinterpret_cast<VolShape*>(fresh + done * SLOT_SIZE));
+		}
+		::operator delete(fresh);
+		throw;
+	}
+	::operator delete(data);
+	// спостерігачам потрібні лише старі адреси, а не самі фігури
+	const std::uintptr_t old = reinterpret_cast<std::uintptr_t>(data);
+	data = fresh;
+	cap = n;
+	if (count != 0)
+		observers.moved(reinterpret_cast<const VolShape*>(old), reinterpret_cast<const VolShape*>(old + (count - 1) * SLOT_SIZE),
+			static_cast<std::ptrdiff_t>(reinterpret_cast<std::uintptr_t>(fresh) - old));
+}
+
+size_t ShapeVector::indexOf(const VolShape* v) const
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(v);
+	std::less<const unsigned char*> before;
+	if (count == 0 || before(p, data) || !before(p, data + count * SLOT_SIZE)) return count;
+	return (p - data) / SLOT_SIZE;
+}
+
+void ShapeVector::destroyAll()
+{
+	for (size_t i = 0; i < count; ++i) at(i)->~VolShape();
+}
+
+void ShapeVector::reserve(size_t n)
+{
+	if (n > cap) relocate(n);
+}
+
+void ShapeVector::shrink_to_fit()
+{
+	if (cap == count) return;
+	if (count == 0)
+	{
+		::operator delete(data);
+		data = nullptr;
+		cap = 0;
+		return;
+	}
+	relocate(count);
+}
+
+//-----------------------------------------------------------
+
+void ShapeVector::addtoEnd(VolShape* val)
+{
+	// аргумент може бути фігурою цього ж вектора, а розширення переносить фігури
+	size_t own = indexOf(val);
+	if (count == cap) reserve(cap == 0 ? 8 : cap * 2);
+	if (own < count) val = at(own);
+	ShapeArena::Scope scope(pool);
+	place(data + count * SLOT_SIZE, *val);
+	++count;
+	observers.added(*at(count - 1));
+}
+
+void ShapeVector::insert(VolShape* val, int index)
+{
+	if (index < 0 || static_cast<size_t>(index) > count)
+		throw std::out_of_range("Error: Cannot insert at specified position\n");
+	size_t own = indexOf(val);
+	if (count == cap) reserve(cap == 0 ? 8 : cap * 2);
+	if (own < count) val = at(own);
+	ShapeArena::Scope scope(pool);
+	// копія створюється осторонь, тож виняток при копіюванні не зачіпає вектор;
+	// далі хвіст і сама копія лише переносяться
+	Slot made;
+	settle(index, *place(&made, *val));
+}
+
+void ShapeVector::addtoEnd(std::unique_ptr<VolShape> val)
+{
+	if (count == cap) reserve(cap == 0 ? 8 : cap * 2);
+	ShapeArena::Scope scope(pool);
+	adopt(data + count * SLOT_SIZE, val);
+	++count;
+	observers.added(*at(count - 1));
+}
+
+void ShapeVector::insert(std::unique_ptr<VolShape> val, int index)
+{
+	if (index < 0 || static_cast<size_t>(index) > count)
+		throw std::out_of_range("Error: Cannot insert at specified position\n");
+	if (count == cap) reserve(cap == 0 ? 8 : cap * 2);
+	ShapeArena::Scope scope(pool);
+	Slot made;
+	settle(index, *adopt(&made, val));
+}
+
+void ShapeVector::append(std::vector<ShapeVector>& parts, ThreadPool& pool)
+{
+	std::vector<size_t> offset(parts.size() + 1, count);
+	bool same = true;
+	for (size_t k = 0; k < parts.size(); ++k)
+	{
+		offset[k + 1] = offset[k] + parts[k].count;
+		same = same && (parts[k].pool == nullptr) == (this->pool == nullptr);
+	}
+	const size_t total = offset.back();
+	if (total > cap) reserve(total > cap * 2 ? total : cap * 2);
+	const size_t first = count;
+	if (same)
+	{
+		// перенесення не виділяє пам'яті, тож частини можна переносити одночасно
+		for (size_t k = 0; k < parts.size() && this->pool != nullptr; ++k) this->pool->merge(*parts[k].pool);
+		pool.run(parts.size(), [this, &parts, &offset](size_t k)
+		{
+			ShapeVector& part = parts[k];
+			for (size_t i = 0; i < part.count; ++i) shift(data + (offset[k] + i) * SLOT_SIZE, *part.at(i));
+		});
+		count = total;
+		for (size_t k = 0; k < parts.size(); ++k)
+			if (parts[k].count != 0)
+			{
+				parts[k].observers.cleared();
+				parts[k].count = 0;
+			}
+	}
+	else
+	{
+		ShapeArena::Scope scope(this->pool);
+		for (size_t k = 0; k < parts.size(); ++k)
+		{
+			for (size_t i = 0; i < parts[k].count; ++i, ++count) place(data + count * SLOT_SIZE, *parts[k].at(i));
+			parts[k].removeAll();
+		}
+	}
+	if (!observers.empty())
+		for (size_t i = first; i < count; ++i) observers.added(*at(i));
+}
+
+void ShapeVector::remove(int index)
+{
+	if (count == 0) return;
+	if (index < 0 || static_cast<size_t>(index) >= count)
+		throw std::out_of_range("Error: Cannot get element at specified position\n");
+	observers.removed(*at(index));
+	ShapeArena::Scope scope(pool);
+	at(index)->~VolShape();
+	for (size_t i = index; i + 1 < count; ++i)
+		shift(data + i * SLOT_SIZE, *at(i + 1));
+	--count;
+	if (static_cast<size_t>(index) < count)
+		observers.moved(at(index + 1), at(count), -static_cast<std::ptrdiff_t>(SLOT_SIZE));
+}
+
+void ShapeVector::removeAll()
+{
+	if (count != 0) observers.cleared();
+	if (pool != nullptr) pool->release();
+	else destroyAll();
+	count = 0;
+}
+
+void ShapeVector::attach(ShapeObserver* o)
+{
+	observers.attach(o);
+	std::vector<const VolShape*> all(count);
+	for (size_t i = 0; i < count; ++i) all[i] = at(i);
+	o->attached(all);
+}
+
+void ShapeVector::detach(ShapeObserver* o)
+{
+	observers.detach(o);
+	o->cleared();
+}
+
+VolShape& ShapeVector::getShape(int index) const
+{
+	if (index < 0 || static_cast<size_t>(index) >= count)
+		throw std::out_of_range("Error: Cannot get element at specified position\n");
+	return *at(index);
+}
+
+//-----------------------------------------------------------
+
+void ShapeVector::printAll() const
+{
+	if (count == 0)
+	{
+		std::cout << "List is empty :(\n";
+		return;
+	}
+	{
+		ShapeWriter out(std::cout);
+		for (size_t i = 0; i < count; ++i)
+		{
+			out.print(*at(i));
+			out << " \n";
+		}
+	}
+	std::cout.flush();
+}
+
+void ShapeVector::storeOn(ofstream& os) const
+{
+	SHAPES_STORED(os);
+	{
+		ShapeWriter out(os);
+		for (size_t i = 0; i < count; ++i)
+		{
+			out.store(*at(i));
+			out << '\n';
+		}
+	}
+	os.flush();
+}
+
+VolShape* ShapeVector::findFirst_if(bool(*p)(VolShape*)) const
+{
+	for (size_t i = 0; i < count; ++i)
+		if (p(at(i))) return at(i);
+	return nullptr;
+}
+
+void ShapeVector::ForEach(void (*do_something)(VolShape*)) const
+{
+	for (size_t i = 0; i < count; ++i) do_something(at(i));
+}
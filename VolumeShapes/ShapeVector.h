@@ -0,0 +1,166 @@
+/*
+Неперервний контейнер об'ємних фігур. На відміну від LinkedList, де кожна фігура
+  - окремий вузол і окремий об'єкт у купі, ShapeVector розміщує самі об'єкти
+  фігур один за одним у спільному масиві комірок однакового розміру (комірка
+  вміщує будь-який з шести конкретних класів). Тому додавання в кінець має
+  амортизовану складність O(1), доступ за номером - O(1), а обхід іде підряд
+  по пам'яті. Вставка і вилучення всередині зсувають хвіст, як у std::vector.
+
+Інтерфейс повторює LinkedList (addtoEnd, insert, remove, getShape, ForEach,
+ storeOn, printAll), а reserve/shrink_to_fit дають змогу заздалегідь виділити
+ пам'ять за кількістю фігур з першого рядка файла.
+
+Основи вбудованих класів лежать у самих фігурах (див. VolShape::Place), тож
+ комірка - це вся фігура, і додавання копії не звертається до купи. Основи
+ інших класів розміщуються окремо; у режимі POOLED вектор має власний
+ ShapeArena, тож такі основи лягають у його блоки підряд і звільняються разом
+ з вектором.
+
+Приєднаним спостерігачам (ShapeObserver) вектор повідомляє і про перенесення
+ фігур: при розширенні масиву переїжджають усі фігури, при вставці й вилученні
+ - хвіст за місцем зміни. Фігури переїжджають конструктором перенесення свого
+ класу (через VolShapeRegistry): основа в купі лишається на місці, а основа в
+ самій фігурі копіюється разом з нею.
+*/
+#ifndef _ShapeVectorHeader_
+#define _ShapeVectorHeader_
+
+#include "VolumeShapes.h"
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool;
+
+class ShapeVector
+{
+public:
+	// розмір комірки вміщує будь-який з вбудованих класів з його вирівнюванням;
+	// інші зареєстровані класи - якщо вміщуються (інакше VolShape::BadClassname)
+	typedef std::aligned_union<0, Cylinder, Parallelepiped, TriPrizm, Conus, RectPiramid, TriPiramid>::type Slot;
+	static constexpr size_t SLOT_SIZE = sizeof(Slot);
+	static constexpr size_t SLOT_ALIGN = alignof(Slot);
+
+	// ітератор довільного доступу по комірках
+	template<class T, class Byte> class Iter
+	{
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T* pointer;
+		typedef T& reference;
+		explicit Iter(Byte* p = nullptr) : p(p) {}
+		T& operator*() const { return *reinterpret_cast<T*>(p); }
+		T* operator->() const { return reinterpret_cast<T*>(p); }
+		T& operator[](difference_type n) const { return *(*this + n); }
+		Iter& operator++() { p += SLOT_SIZE; return *this; }
+		Iter operator++(int) { Iter t(*this); p += SLOT_SIZE; return t; }
+		Iter& operator--() { p -= SLOT_SIZE; return *this; }
+		Iter operator--(int) { Iter t(*this); p -= SLOT_SIZE; return t; }
+		Iter& operator+=(difference_type n) { p += n * SLOT_SIZE; return *this; }
+		Iter& operator-=(difference_type n) { p -= n * SLOT_SIZE; return *this; }
+		Iter operator+(difference_type n) const { return Iter(p + n * SLOT_SIZE); }
+		Iter operator-(difference_type n) const { return Iter(p - n * SLOT_SIZE); }
+		difference_type operator-(const Iter& o) const { return (p - o.p) / static_cast<difference_type>(SLOT_SIZE); }
+		bool operator==(const Iter& o) const { return p == o.p; }
+		bool operator!=(const Iter& o) const { return p != o.p; }
+		bool operator<(const Iter& o) const { return p < o.p; }
+		bool operator>(const Iter& o) const { return p > o.p; }
+		bool operator<=(const Iter& o) const { return p <= o.p; }
+		bool operator>=(const Iter& o) const { return p >= o.p; }
+	private:
+		Byte* p;
+	};
+	typedef Iter<VolShape, unsigned char> iterator;
+	typedef Iter<const VolShape, const unsigned char> const_iterator;
+
+	ShapeVector() : data(nullptr), count(0), cap(0), pool(nullptr) {}
+	explicit ShapeVector(LinkedList::Allocation mode)
+		: data(nullptr), count(0), cap(0), pool(mode == LinkedList::POOLED ? new ShapeArena : nullptr) {}
+	ShapeVector(const ShapeVector& other);
+	ShapeVector& operator=(const ShapeVector& other);
+	~ShapeVector();
+
+	// копія фігури додається в кінець; фігура-аргумент залишається власністю того, хто викликав
+	void addtoEnd(VolShape* val);
+	void insert(VolShape* val, int index);
+	// фігура переноситься в комірку вектора, а її порожня оболонка знищується. Як і в
+	// LinkedList, вектор POOLED переносить лише фігуру з основою у своєму пулі, іншу - копіює
+	void addtoEnd(std::unique_ptr<VolShape> val);
+	void insert(std::unique_ptr<VolShape> val, int index);
+	// фігура класу T створюється одразу в комірці
+	template<class T, class... Args> T& emplace(Args&&... args);
+	// переносить у кінець фігури всіх parts по черзі, parts стають порожніми. Якщо parts
+	// розміщують основи так само, як цей вектор (у купі чи в пулах), фігури переносяться
+	// паралельно на pool, а пули parts приєднуються до пулу вектора; інакше - копіюються
+	void append(std::vector<ShapeVector>& parts, ThreadPool& pool);
+	void remove(int index);
+	void removeAll();
+	VolShape& getShape(int index) const;
+	VolShape& operator[](int i) { return *at(i); }
+	const VolShape& operator[](int i) const { return *at(i); }
+
+	void reserve(size_t n);
+	void shrink_to_fit();
+	size_t size() const { return count; }
+	size_t capacity() const { return cap; }
+	bool empty() const { return count == 0; }
+	ShapeArena* arena() const { return pool; }
+	// як у LinkedList: новий спостерігач отримує attached з наявними фігурами,
+	// від'єднаний - cleared
+	void attach(ShapeObserver* o);
+	void detach(ShapeObserver* o);
+
+	iterator begin() { return iterator(data); }
+	iterator end() { return iterator(data + count * SLOT_SIZE); }
+	const_iterator begin() const { return const_iterator(data); }
+	const_iterator end() const { return const_iterator(data + count * SLOT_SIZE); }
+
+	void printAll() const;
+	void storeOn(ofstream& os) const;
+	VolShape* findFirst_if(bool(*p)(VolShape*)) const;
+	void ForEach(void (*do_something)(VolShape*)) const;
+private:
+	VolShape* at(size_t i) const { return reinterpret_cast<VolShape*>(data + i * SLOT_SIZE); }
+	// клас фігури з реєстру; клас, більший за комірку, - VolShape::BadClassname
+	static const VolShapeRegistry::Type& slotType(const VolShape& v);
+	// створює в комірці копію фігури її власного класу
+	static VolShape* place(void* slot, const VolShape& v);
+	// переносить фігуру в комірку і знищує оболонку, що лишилася
+	static VolShape* shift(void* slot, VolShape& v);
+	// розміщує в комірці фігуру val, яку вектор забирає собі або копіює
+	VolShape* adopt(void* slot, std::unique_ptr<VolShape>& val) const;
+	// переносить готову фігуру made у комірку index, зсуваючи хвіст праворуч
+	void settle(size_t index, VolShape& made);
+	// переносить фігури в новий масив місткістю n
+	void relocate(size_t n);
+	// номер фігури, що лежить у цьому векторі, або count для сторонньої
+	size_t indexOf(const VolShape* v) const;
+	void destroyAll();
+
+	unsigned char* data;
+	size_t count;
+	size_t cap;
+	ShapeArena* pool;
+	ShapeObservers observers;
+};
+
+template<class T, class... Args> T& ShapeVector::emplace(Args&&... args)
+{
+	static_assert(sizeof(T) <= SLOT_SIZE && alignof(T) <= SLOT_ALIGN, "shape class does not fit ShapeVector::Slot");
+	ShapeArena::Scope scope(pool);
+	if (count == cap)
+	{
+		// аргументи можуть посилатися на фігури цього вектора, що переїдуть при розширенні
+		T made(std::forward<Args>(args)...);
+		reserve(cap == 0 ? 8 : cap * 2);
+		::new(data + count * SLOT_SIZE) T(std::move(made));
+	}
+	else ::new(data + count * SLOT_SIZE) T(std::forward<Args>(args)...);
+	++count;
+	observers.added(*at(count - 1));
+	return static_cast<T&>(*at(count - 1));
+}
+
+#endif
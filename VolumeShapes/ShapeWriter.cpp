@@ -0,0 +1,29 @@
+#include "ShapeWriter.h"
+#include "ShapeBatch.h"
+
+// вбудовані класи зареєстровані в порядку ShapeBatch::Kind (див. VolumeShapes.cpp):
+// спершу три прямі фігури, потім три конічні
+void ShapeWriter::print(const VolShape& v)
+{
+	const int tag = v.typeTag();
+	if (!plain() || tag >= ShapeBatch::KIND_COUNT)
+	{
+		direct([&v](ostream& o) { v.printOn(o); });
+		return;
+	}
+	*this << (tag < ShapeBatch::CONUS ? "DirectShape of " : "PiramidalShape of ") << v.high() << " high on ";
+	print(*v.getBase());
+}
+
+void ShapeWriter::store(const VolShape& v)
+{
+	const int tag = v.typeTag();
+	if (!plain() || tag >= ShapeBatch::KIND_COUNT)
+	{
+		ofstream& f = file();
+		direct([&v, &f](ostream&) { v.storeOn(f); });
+		return;
+	}
+	*this << v.getClassName() << ' ' << v.high() << ' ';
+	store(*v.getBase());
+}
@@ -0,0 +1,30 @@
+/*
+Швидке текстове виведення об'ємних фігур - TextWriter (FlatShapes), який знає
+  ще й формати вбудованих класів VolShape. print(v) дає той самий текст, що
+  os << v, а store(v) - що v.storeOn(os), тож printAll і storeOn контейнерів
+  пишуть через ShapeWriter і лише перенесення рядка '\n' замість std::endl:
+  потік скидається один раз, наприкінці.
+
+Класи поза шістьма вбудованими (ShapeBatch::Kind) виводяться їхніми
+ віртуальними методами, як і основи, яких не знає TextWriter.
+*/
+#ifndef _ShapeWriterHeader_
+#define _ShapeWriterHeader_
+
+#include "../FlatShapes/TextWriter.h"
+#include "VolumeShapes.h"
+
+class ShapeWriter : public TextWriter
+{
+public:
+	using TextWriter::TextWriter;
+	using TextWriter::print;
+	using TextWriter::store;
+
+	// те саме, що os << v
+	void print(const VolShape& v);
+	// те саме, що v.storeOn(os)
+	void store(const VolShape& v);
+};
+
+#endif
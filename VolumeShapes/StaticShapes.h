@@ -0,0 +1,196 @@
+/*
+Фігури, тип яких відомий під час компіляції. Генератори наборів фігур і
+  класи на кшталт Parapd з Figure3D.h точно знають, з якою фігурою працюють,
+  але через VolShape все одно платять за віртуальні виклики - і фігури, і
+  основи. Тут та сама геометрія зібрана в шаблони без віртуальних методів:
+  StaticPrism<Base> і StaticPyramid<Base> тримають основу за значенням, усі
+  методи вбудовуються, а там, де не потрібні sin, cos чи sqrt, обчислюються
+  навіть під час компіляції (constexpr).
+
+Формули дослівно повторюють Circle, Rectangle, Triangle та шість класів
+ VolShape, тож результати збігаються до останнього біта.
+
+toVolShape() створює звичайну фігуру відповідного класу (Dynamic) з тими
+ самими параметрами, а addStatic будує таку фігуру одразу в контейнері
+ (emplace): у ShapeVector - у комірці вектора, в LinkedList - у його пулі,
+ якщо він є.
+*/
+#ifndef _StaticShapesHeader_
+#define _StaticShapesHeader_
+
+#include "VolumeShapes.h"
+
+// --------------------- основи
+class StaticCircle
+{
+	double r;
+public:
+	constexpr explicit StaticCircle(double radius = 1.) : r(radius) {}
+	constexpr double radius() const { return r; }
+	constexpr double area() const { return M_PI*r*r; }
+	constexpr double perim() const { return 2.*M_PI*r; }
+};
+
+class StaticRect
+{
+	double a;
+	double b;
+public:
+	constexpr StaticRect(double sideA = 1., double sideB = 1.) : a(sideA), b(sideB) {}
+	constexpr double sideA() const { return a; }
+	constexpr double sideB() const { return b; }
+	constexpr double area() const { return a * b; }
+	constexpr double perim() const { return (a + b) * 2.; }
+};
+
+class StaticTriangle
+{
+	double a;
+	double b;
+	int y;
+	constexpr double angle() const { return 3.14*y/180; }
+public:
+	constexpr StaticTriangle(double sideA = 3., double sideB = 4., int angle = 90) : a(sideA), b(sideB), y(angle) {}
+	constexpr double sideA() const { return a; }
+	constexpr double sideB() const { return b; }
+	constexpr int degrees() const { return y; }
+	double area() const { return 0.5*a*b*std::sin(angle()); }
+	double perim() const { return a+b+std::sqrt(a*a+b*b-2.*a*b*std::cos(angle())); }
+};
+
+// --------------------- спільна частина (CRTP)
+// Derived задає sideArea() і кількість основ у повній поверхні
+template<class Derived, class Base> class StaticVolume
+{
+protected:
+	double h;
+	Base base;
+public:
+	constexpr StaticVolume(double high, const Base& b) : h(high), base(b) {}
+	constexpr double high() const { return h; }
+	constexpr const Base& getBase() const { return base; }
+	constexpr double baseArea() const { return base.area(); }
+	constexpr double surfaceArea() const
+	{
+		return Derived::BASES == 2 ? baseArea() * 2 + self().sideArea() : baseArea() + self().sideArea();
+	}
+private:
+	constexpr const Derived& self() const { return static_cast<const Derived&>(*this); }
+};
+
+// --------------------- прямі фігури
+template<class Base> class StaticPrism : public StaticVolume<StaticPrism<Base>, Base>
+{
+	typedef StaticVolume<StaticPrism<Base>, Base> Super;
+protected:
+	using Super::h;
+	using Super::base;
+public:
+	static const int BASES = 2;
+	constexpr StaticPrism(double high, const Base& b) : Super(high, b) {}
+	constexpr double sideArea() const { return base.perim() * h; }
+	constexpr double volume() const { return base.area() * h; }
+};
+
+// --------------------- конічні фігури
+// бічна поверхня залежить від основи, тому визначена окремо для кожної
+template<class Base> class StaticPyramid : public StaticVolume<StaticPyramid<Base>, Base>
+{
+	typedef StaticVolume<StaticPyramid<Base>, Base> Super;
+protected:
+	using Super::h;
+	using Super::base;
+public:
+	static const int BASES = 1;
+	constexpr StaticPyramid(double high, const Base& b) : Super(high, b) {}
+	double sideArea() const;
+	constexpr double volume() const { return base.area() * h/3.; }
+};
+
+template<> inline double StaticPyramid<StaticCircle>::sideArea() const
+{
+	double r = base.radius();
+	return M_PI*r*std::sqrt(h*h+r*r);
+}
+
+template<> inline double StaticPyramid<StaticRect>::sideArea() const
+{
+	double a = base.sideA();
+	double b = base.sideB();
+	return a*std::sqrt(h*h+b*b*0.25)+b*std::sqrt(h*h+a*a*0.25);
+}
+
+template<> inline double StaticPyramid<StaticTriangle>::sideArea() const
+{
+	double r = 2. * base.area() / base.perim();
+	return 0.5 * base.perim() * std::sqrt(h*h+r*r);
+}
+
+// --------------------- шість конкретних фігур з конструкторами, як у VolShape
+class StaticCylinder : public StaticPrism<StaticCircle>
+{
+public:
+	typedef Cylinder Dynamic;
+	constexpr StaticCylinder(double high = 1., double radius = 1.) : StaticPrism(high, StaticCircle(radius)) {}
+	Dynamic toVolShape() const { return Dynamic(h, base.radius()); }
+	template<class Shapes> void emplaceInto(Shapes& shapes) const { shapes.template emplace<Dynamic>(h, base.radius()); }
+};
+
+class StaticParallelepiped : public StaticPrism<StaticRect>
+{
+public:
+	typedef Parallelepiped Dynamic;
+	constexpr StaticParallelepiped(double high = 1., double sideA = 1., double sideB = 1.)
+		: StaticPrism(high, StaticRect(sideA, sideB)) {}
+	Dynamic toVolShape() const { return Dynamic(h, base.sideA(), base.sideB()); }
+	template<class Shapes> void emplaceInto(Shapes& shapes) const { shapes.template emplace<Dynamic>(h, base.sideA(), base.sideB()); }
+};
+
+class StaticTriPrizm : public StaticPrism<StaticTriangle>
+{
+public:
+	typedef TriPrizm Dynamic;
+	constexpr StaticTriPrizm(double high = 1., double sideA = 3., double sideB = 4., int angle = 90)
+		: StaticPrism(high, StaticTriangle(sideA, sideB, angle)) {}
+	Dynamic toVolShape() const { return Dynamic(h, base.sideA(), base.sideB(), base.degrees()); }
+	template<class Shapes> void emplaceInto(Shapes& shapes) const { shapes.template emplace<Dynamic>(h, base.sideA(), base.sideB(), base.degrees()); }
+};
+
+class StaticConus : public StaticPyramid<StaticCircle>
+{
+public:
+	typedef Conus Dynamic;
+	constexpr StaticConus(double high = 1., double radius = 1.) : StaticPyramid(high, StaticCircle(radius)) {}
+	Dynamic toVolShape() const { return Dynamic(h, base.radius()); }
+	template<class Shapes> void emplaceInto(Shapes& shapes) const { shapes.template emplace<Dynamic>(h, base.radius()); }
+};
+
+class StaticRectPiramid : public StaticPyramid<StaticRect>
+{
+public:
+	typedef RectPiramid Dynamic;
+	constexpr StaticRectPiramid(double high = 1., double sideA = 1., double sideB = 1.)
+		: StaticPyramid(high, StaticRect(sideA, sideB)) {}
+	Dynamic toVolShape() const { return Dynamic(h, base.sideA(), base.sideB()); }
+	template<class Shapes> void emplaceInto(Shapes& shapes) const { shapes.template emplace<Dynamic>(h, base.sideA(), base.sideB()); }
+};
+
+class StaticTriPiramid : public StaticPyramid<StaticTriangle>
+{
+public:
+	typedef TriPiramid Dynamic;
+	constexpr StaticTriPiramid(double high = 1., double sideA = 3., double sideB = 4., int angle = 90)
+		: StaticPyramid(high, StaticTriangle(sideA, sideB, angle)) {}
+	Dynamic toVolShape() const { return Dynamic(h, base.sideA(), base.sideB(), base.degrees()); }
+	template<class Shapes> void emplaceInto(Shapes& shapes) const { shapes.template emplace<Dynamic>(h, base.sideA(), base.sideB(), base.degrees()); }
+};
+
+// додає статичну фігуру до контейнера (LinkedList, ShapeVector чи PersistentList):
+// фігура класу Dynamic створюється одразу на своєму місці через emplace, без
+// тимчасової фігури і копіювання; у ShapeVector - прямо в комірці, без виділення пам'яті
+template<class Shapes, class S> void addStatic(Shapes& shapes, const S& s)
+{
+	s.emplaceInto(shapes);
+}
+
+#endif
@@ -0,0 +1,410 @@
+#include "StreamPipeline.h"
+#include "ShapeReader.h"
+#include "../FlatShapes/TextWriter.h"
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+// записи, розібрані з тексту, і результати обчислень для них
+struct StreamPipeline::Block
+{
+	ShapeBatch batch;
+	std::vector<unsigned char> order;  // класи записів у порядку тексту
+	std::vector<double> values[ShapeBatch::METRIC_COUNT][ShapeBatch::KIND_COUNT];
+
+	// ShapeBatch::clear звільнив би пам'ять стовпців, а блок її використає знову
+	void clear()
+	{
+		order.clear();
+		for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k)
+		{
+			ShapeBatch::Columns& c = batch.columns(static_cast<ShapeBatch::Kind>(k));
+			c.h.clear();
+			c.r.clear();
+			c.a.clear();
+			c.b.clear();
+			c.angle.clear();
+		}
+	}
+};
+
+// черга блоків між стадіями. close - більше блоків не буде, решту ще можна
+// забрати; cancel - зупинка через виняток, pop одразу повертає false
+class StreamPipeline::Channel
+{
+public:
+	Channel() : closed(false), cancelled(false) {}
+	void push(Block* b)
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			blocks.push_back(b);
+		}
+		ready.notify_one();
+	}
+	bool pop(Block*& b)
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		ready.wait(guard, [this] { return !blocks.empty() || closed || cancelled; });
+		if (cancelled || blocks.empty()) return false;
+		b = blocks.front();
+		blocks.pop_front();
+		return true;
+	}
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			closed = true;
+		}
+		ready.notify_all();
+	}
+	void cancel()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			cancelled = true;
+		}
+		ready.notify_all();
+	}
+private:
+	std::mutex lock;
+	std::condition_variable ready;
+	std::deque<Block*> blocks;  // блоків у обігу скінченна кількість, тож черга обмежена
+	bool closed;
+	bool cancelled;
+};
+
+// стадія виведення: рядки записів і підсумки
+class StreamPipeline::Emitter
+{
+public:
+	Emitter(const Options& opt, std::ostream& out) : options(opt), out(out), text(out)
+	{
+		if (!options.records) return;
+		text << "class";
+		for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+			if (tracked(m)) text << '\t' << ShapeBatch::metricName(static_cast<ShapeBatch::Metric>(m));
+		text << '\n';
+	}
+	void emit(const Block& b)
+	{
+		size_t next[ShapeBatch::KIND_COUNT] = {};
+		for (size_t i = 0; i < b.order.size(); ++i)
+		{
+			const int k = b.order[i];
+			const size_t j = next[k]++;
+			if (options.records) text << ShapeBatch::kindName(static_cast<ShapeBatch::Kind>(k));
+			for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+			{
+				if (!tracked(m)) continue;
+				const double x = b.values[m][k][j];
+				if (options.records) text << '\t' << x;
+				sums[k][m].add(x);
+			}
+			if (options.records) text << '\n';
+		}
+		for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k) count[k] += next[k];
+		flush();
+	}
+	void finish(Report& report)
+	{
+		Sum all[ShapeBatch::METRIC_COUNT];
+		size_t total = 0;
+		for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k)
+		{
+			report.count[k] = count[k];
+			total += count[k];
+			for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+			{
+				report.of[k][m] = tracked(m) ? sums[k][m].summary() : sums[k][m].empty();
+				if (tracked(m)) all[m].merge(sums[k][m]);
+			}
+		}
+		for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+			report.total[m] = tracked(m) ? all[m].summary() : all[m].empty();
+		if (options.totals)
+		{
+			if (options.records) text << '\n';
+			text << "class\tcount";
+			for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+			{
+				if (!tracked(m)) continue;
+				const char* name = ShapeBatch::metricName(static_cast<ShapeBatch::Metric>(m));
+				text << '\t' << name << "_sum\t" << name << "_min\t" << name << "_max";
+			}
+			text << '\n';
+			for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k)
+				if (count[k] != 0) line(ShapeBatch::kindName(static_cast<ShapeBatch::Kind>(k)), count[k], report.of[k]);
+			line("total", total, report.total);
+		}
+		flush();
+	}
+private:
+	// компенсована сума (Ноймаєр), як у CatalogStats; NaN рахується, але не
+	// бере участі в min і max
+	struct Sum
+	{
+		size_t count;
+		double sum, compensation, min, max;
+		Sum() : count(0), sum(0), compensation(0),
+			min(std::numeric_limits<double>::quiet_NaN()), max(std::numeric_limits<double>::quiet_NaN()) {}
+		void add(double x)
+		{
+			++count;
+			const double t = sum + x;
+			if (std::fabs(sum) >= std::fabs(x)) compensation += (sum - t) + x;
+			else compensation += (x - t) + sum;
+			sum = t;
+			if (x != x) return;
+			if (!(min <= x)) min = x;
+			if (!(max >= x)) max = x;
+		}
+		void merge(const Sum& s)
+		{
+			count += s.count;
+			const double part = s.summary().sum;
+			const double t = sum + part;
+			if (std::fabs(sum) >= std::fabs(part)) compensation += (sum - t) + part;
+			else compensation += (part - t) + sum;
+			sum = t;
+			if (s.min == s.min && !(min <= s.min)) min = s.min;
+			if (s.max == s.max && !(max >= s.max)) max = s.max;
+		}
+		Summary summary() const
+		{
+			// нескінченні доданки роблять компенсацію NaN
+			const double value = std::isfinite(sum) ? sum + compensation : sum;
+			Summary s = { count, value, min, max };
+			return s;
+		}
+		Summary empty() const
+		{
+			Summary s = { 0, 0., std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN() };
+			return s;
+		}
+	};
+
+	bool tracked(int m) const { return (options.metrics & (1u << m)) != 0; }
+	void line(const char* name, size_t n, const Summary* s)
+	{
+		text << name << '\t' << n;
+		for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+			if (tracked(m)) text << '\t' << s[m].sum << '\t' << s[m].min << '\t' << s[m].max;
+		text << '\n';
+	}
+	void flush()
+	{
+		text.flush();
+		out.flush();
+		if (!out) throw std::runtime_error("Error: Cannot write output\n");
+	}
+
+	const Options& options;
+	std::ostream& out;
+	TextWriter text;
+	size_t count[ShapeBatch::KIND_COUNT] = {};
+	Sum sums[ShapeBatch::KIND_COUNT][ShapeBatch::METRIC_COUNT];
+};
+
+//-----------------------------------------------------------
+
+StreamPipeline::StreamPipeline(const Options& opt) : options(opt)
+{
+}
+
+void StreamPipeline::parse(std::istream& in, Channel& free, Channel& parsed, Report& report) const
+{
+	std::vector<char> text;
+	size_t line = 1;
+	bool first = true;
+	Block* b = nullptr;
+	for (bool eof = false; !eof; )
+	{
+		// новий шматок дописується за залишком попереднього - неповним рядком
+		const size_t kept = text.size();
+		text.resize(kept + options.readBytes);
+		in.read(text.data() + kept, static_cast<std::streamsize>(options.readBytes));
+		if (in.bad()) throw std::runtime_error("Error: Cannot read input\n");
+		eof = in.eof();
+		text.resize(kept + static_cast<size_t>(in.gcount()));
+		const char* begin = text.data();
+		const char* end = begin + text.size();
+		const char* stop = end;
+		if (!eof)
+		{
+			// межа - після останнього перенесення рядка; рядок, довший за шматок, дочитується
+			while (stop > begin && stop[-1] != '\n') --stop;
+			if (stop == begin) continue;
+		}
+		ShapeReader reader(begin, stop, line);
+		if (first)
+		{
+			long long n;
+			report.declared = reader.readCount(n) ? n : -1;
+			first = false;
+		}
+		ShapeRecord r;
+		for (;;)
+		{
+			try
+			{
+				if (!reader.next(r)) break;
+			}
+			catch (VolShape::BadClassname& e)
+			{
+				if (report.errors.size() < options.maxErrors)
+				{
+					Error err = { reader.recordLine(), true, e.what() };
+					report.errors.push_back(err);
+				}
+				++report.errorCount;
+				continue;
+			}
+			catch (std::invalid_argument& e)
+			{
+				if (report.errors.size() < options.maxErrors)
+				{
+					Error err = { reader.recordLine(), false, e.what() };
+					report.errors.push_back(err);
+				}
+				++report.errorCount;
+				continue;
+			}
+			if (b == nullptr)
+			{
+				if (!free.pop(b)) return;
+				b->clear();
+			}
+			r.addTo(b->batch);
+			b->order.push_back(static_cast<unsigned char>(r.kind));
+			++report.records;
+			if (b->order.size() == options.blockRecords)
+			{
+				parsed.push(b);
+				b = nullptr;
+			}
+		}
+		// те, що вже розібрано, не чекає на наступний шматок
+		if (b != nullptr && !b->order.empty())
+		{
+			parsed.push(b);
+			b = nullptr;
+		}
+		line = reader.line();
+		text.erase(text.begin(), text.begin() + (stop - begin));
+	}
+}
+
+void StreamPipeline::compute(Channel& parsed, Channel& computed) const
+{
+	Block* b;
+	while (parsed.pop(b))
+	{
+		for (int k = 0; k < ShapeBatch::KIND_COUNT; ++k)
+		{
+			const ShapeBatch::Kind kind = static_cast<ShapeBatch::Kind>(k);
+			const size_t n = b->batch.size(kind);
+			for (int m = 0; m < ShapeBatch::METRIC_COUNT; ++m)
+			{
+				if ((options.metrics & (1u << m)) == 0) continue;
+				std::vector<double>& out = b->values[m][k];
+				out.resize(n);
+				if (n != 0) b->batch.compute(static_cast<ShapeBatch::Metric>(m), kind, out.data(), options.precision);
+			}
+		}
+		computed.push(b);
+	}
+}
+
+StreamPipeline::Report StreamPipeline::run(std::istream& in, std::ostream& out) const
+{
+	if (options.metrics == 0 || (options.metrics >> ShapeBatch::METRIC_COUNT) != 0)
+		throw std::invalid_argument("Error: Invalid set of metrics\n");
+	if (options.blockRecords == 0 || options.blocks == 0 || options.readBytes == 0)
+		throw std::invalid_argument("Error: Block size, block count and read size must be positive\n");
+
+	Report report;
+	report.records = 0;
+	report.declared = -1;
+	report.errorCount = 0;
+	std::vector<std::unique_ptr<Block>> blocks;
+	Channel free, parsed, computed;
+	for (size_t i = 0; i < options.blocks; ++i)
+	{
+		blocks.emplace_back(new Block);
+		free.push(blocks.back().get());
+	}
+	// перший виняток будь-якої стадії зупиняє всі
+	std::exception_ptr failure;
+	std::mutex failureLock;
+	auto fail = [&]
+	{
+		{
+			std::lock_guard<std::mutex> guard(failureLock);
+			if (!failure) failure = std::current_exception();
+		}
+		free.cancel();
+		parsed.cancel();
+		computed.cancel();
+	};
+	std::thread reader([&]
+	{
+		try
+		{
+			parse(in, free, parsed, report);
+		}
+		catch (...)
+		{
+			fail();
+		}
+		parsed.close();
+	});
+	std::thread calculator([&]
+	{
+		try
+		{
+			compute(parsed, computed);
+		}
+		catch (...)
+		{
+			fail();
+		}
+		computed.close();
+	});
+	try
+	{
+		Emitter emitter(options, out);
+		Block* b;
+		while (computed.pop(b))
+		{
+			emitter.emit(*b);
+			free.push(b);
+		}
+		reader.join();
+		calculator.join();
+		if (!failure) emitter.finish(report);
+	}
+	catch (...)
+	{
+		fail();
+	}
+	if (reader.joinable()) reader.join();
+	if (calculator.joinable()) calculator.join();
+	if (failure) std::rethrow_exception(failure);
+	return report;
+}
+
+StreamPipeline::Report StreamPipeline::run(const char* path, std::ostream& out) const
+{
+	std::ifstream in(path, std::ios_base::binary);
+	if (!in) throw std::runtime_error(string("Error: Cannot open ") + path + "\n");
+	return run(in, out);
+}
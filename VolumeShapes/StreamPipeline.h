@@ -0,0 +1,106 @@
+/*
+Потокова обробка файлів фігур. Щоб дізнатися об'єм кожної фігури чи загальну
+  площу поверхні, досі весь файл спершу завантажували в контейнер: пам'ять
+  росла разом з файлом, і нічого не виводилося, поки не прочитано останній
+  запис. StreamPipeline читає записи з потоку (файла чи stdin) шматками,
+  рахує обрані характеристики і виводить результати, не тримаючи в пам'яті
+  більше за кілька блоків записів, хоч би який великий був файл.
+
+Три стадії працюють одночасно, кожна у своєму потоці, і передають одна одній
+ блоки по Options::blockRecords записів:
+ - розбір: читає потік шматками по readBytes і розбирає ShapeReader'ом у
+   стовпці блока (як ShapeBatch); блок передається далі, коли заповниться або
+   коли закінчиться прочитаний шматок;
+ - обчислення: ShapeBatch::compute для кожного класу і кожної характеристики;
+ - виведення: рядки результатів через TextWriter у вихідний потік (той потік,
+   що викликав run) і підсумки за класами.
+ Усього блоків Options::blocks; вони ходять по колу розбір - обчислення -
+ виведення - розбір, тож черги між стадіями обмежені самі собою: швидка
+ стадія чекає на вільний блок, а пам'ять - blocks * blockRecords записів
+ разом з результатами плюс шматок вхідного тексту.
+
+Граматика та сама, що в ShapeReader::next: обидва формати (volShapes.txt з
+ кількістю фігур на початку і storage.txt з літерою основи) і лише шість
+ вбудованих класів. Як і для ParallelLoader, запис має займати один рядок,
+ бо шматки тексту межують по перенесенню рядка. Помилковий запис
+ пропускається, а в звіт потрапляють номер рядка і повідомлення винятку.
+
+Виведення - текст, розділений табуляціями. При Options::records - рядок
+ заголовка (class і назви характеристик, див. ShapeBatch::metricName) і рядок
+ на кожен правильний запис у порядку файла: ім'я класу і значення
+ характеристик. При Options::totals - наприкінці таблиця підсумків: для
+ кожного класу, що траплявся, і для всіх разом (total) - кількість і сума,
+ найменше та найбільше значення кожної характеристики. Числа - у форматі, що
+ стоїть у вихідному потоці (як для os << x), тож кількість знаків задає
+ out.precision(). Після кожного блока потік скидається, тож результати
+ з'являються, поки файл ще читається.
+
+Виняток будь-якої стадії (помилка читання чи запису потоку, брак пам'яті)
+ зупиняє решту і повторюється з run.
+*/
+#ifndef _StreamPipelineHeader_
+#define _StreamPipelineHeader_
+
+#include "CatalogStats.h"
+#include "ShapeBatch.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+class StreamPipeline
+{
+public:
+	struct Options
+	{
+		// бітова маска з 1 << ShapeBatch::Metric, як у CatalogStats
+		unsigned metrics;
+		ShapeBatch::Precision precision;
+		bool records;         // рядок на кожен запис
+		bool totals;          // підсумки наприкінці
+		size_t blockRecords;  // найбільше записів у блоці
+		size_t blocks;        // блоків у обігу між стадіями
+		size_t readBytes;     // шматок вхідного тексту
+		size_t maxErrors;     // скільки помилок зберігати у звіті (рахуються всі)
+		Options()
+			: metrics(CatalogStats::DEFAULT), precision(ShapeBatch::REFERENCE), records(true), totals(false),
+			blockRecords(4096), blocks(8), readBytes(1 << 20), maxErrors(100) {}
+	};
+	struct Error
+	{
+		size_t line;          // номер рядка у вхідному тексті, з 1
+		bool badClassname;    // невідоме ім'я класу чи літера основи; інакше - погане число
+		string message;
+	};
+	// підсумки однієї характеристики: як CatalogStats::Summary, сума компенсована
+	typedef CatalogStats::Summary Summary;
+	struct Report
+	{
+		size_t records;       // правильних записів
+		long long declared;   // кількість з першого рядка, -1 - якщо її немає
+		size_t errorCount;    // усіх помилкових записів
+		std::vector<Error> errors;  // перші maxErrors з них
+		size_t count[ShapeBatch::KIND_COUNT];
+		// лише для характеристик з Options::metrics, інакше count = 0
+		Summary of[ShapeBatch::KIND_COUNT][ShapeBatch::METRIC_COUNT];
+		Summary total[ShapeBatch::METRIC_COUNT];
+	};
+
+	explicit StreamPipeline(const Options& opt = Options());
+
+	// обробляє весь потік in; результати - в out. Неправильні Options -
+	// std::invalid_argument, помилка читання in чи запису out - std::runtime_error
+	Report run(std::istream& in, std::ostream& out) const;
+	// те саме для файла; файл, якого не вдалося відкрити, - std::runtime_error
+	Report run(const char* path, std::ostream& out) const;
+private:
+	struct Block;
+	class Channel;
+	class Emitter;
+
+	void parse(std::istream& in, Channel& free, Channel& parsed, Report& report) const;
+	void compute(Channel& parsed, Channel& computed) const;
+
+	Options options;
+};
+
+#endif
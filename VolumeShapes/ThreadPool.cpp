@@ -0,0 +1,140 @@
+#include "ThreadPool.h"
+#include <exception>
+
+namespace
+{
+// пул і черга, до яких належить поточний робочий потік
+thread_local const ThreadPool* ownerPool = nullptr;
+thread_local size_t ownerQueue = 0;
+
+unsigned sharedThreads = 0;
+}
+
+struct ThreadPool::Job
+{
+	void (*call)(void*, size_t);
+	void* body;
+	std::atomic<size_t> remaining;
+	std::mutex errorLock;
+	std::exception_ptr error;
+};
+
+ThreadPool::ThreadPool(unsigned threads) : queued(0), stopping(false)
+{
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	count = threads;
+	queues.reset(new Queue[threads]);
+	workers.reserve(threads - 1);
+	for (size_t i = 1; i < threads; ++i)
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+}
+
+ThreadPool& ThreadPool::shared()
+{
+	static ThreadPool pool(sharedThreads);
+	return pool;
+}
+
+void ThreadPool::setSharedThreads(unsigned threads)
+{
+	sharedThreads = threads;
+}
+
+size_t ThreadPool::queueOf() const
+{
+	return ownerPool == this ? ownerQueue : 0;
+}
+
+void ThreadPool::execute(size_t n, void (*call)(void*, size_t), void* body)
+{
+	if (n == 0) return;
+	Job job;
+	job.call = call;
+	job.body = body;
+	job.remaining.store(n);
+	queued.fetch_add(n);
+	// суцільні відрізки номерів: свій відрізок кожен учасник проходить підряд
+	const size_t parts = size();
+	const size_t self = queueOf();
+	for (size_t p = 0; p < parts; ++p)
+	{
+		// свою частину викликач отримує першою, щоб почати без очікування
+		const size_t q = (self + p) % parts;
+		const size_t from = n * p / parts, to = n * (p + 1) / parts;
+		if (from == to) continue;
+		std::lock_guard<std::mutex> guard(queues[q].lock);
+		for (size_t i = from; i < to; ++i) queues[q].tasks.push_back(Task{ &job, i });
+	}
+	if (!workers.empty())
+	{
+		// порожній захоплений замок - щоб сигнал не загубився між перевіркою і wait
+		{ std::lock_guard<std::mutex> guard(sleepLock); }
+		wake.notify_all();
+	}
+	while (job.remaining.load() != 0)
+		if (!runOne(self)) std::this_thread::yield();
+	if (job.error) std::rethrow_exception(job.error);
+}
+
+bool ThreadPool::runOne(size_t self)
+{
+	const size_t parts = size();
+	Task t = { nullptr, 0 };
+	{
+		Queue& own = queues[self];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.tasks.empty())
+		{
+			t = own.tasks.front();
+			own.tasks.pop_front();
+		}
+	}
+	for (size_t p = 1; t.job == nullptr && p < parts; ++p)
+	{
+		Queue& victim = queues[(self + p) % parts];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.tasks.empty())
+		{
+			t = victim.tasks.back();
+			victim.tasks.pop_back();
+		}
+	}
+	if (t.job == nullptr) return false;
+	queued.fetch_sub(1);
+	Job& job = *t.job;
+	try
+	{
+		job.call(job.body, t.index);
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> guard(job.errorLock);
+		if (!job.error) job.error = std::current_exception();
+	}
+	job.remaining.fetch_sub(1);
+	return true;
+}
+
+void ThreadPool::workerLoop(size_t self)
+{
+	ownerPool = this;
+	ownerQueue = self;
+	for (;;)
+	{
+		while (runOne(self)) {}
+		std::unique_lock<std::mutex> guard(sleepLock);
+		wake.wait(guard, [this] { return stopping || queued.load() != 0; });
+		if (stopping) return;
+	}
+}
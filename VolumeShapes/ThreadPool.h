@@ -0,0 +1,83 @@
+/*
+Пул потоків з перехопленням роботи (work stealing). Завдання - це номери
+  0..n-1, для кожного з яких треба викликати одну й ту саму функцію. run
+  розкладає номери суцільними відрізками по чергах усіх учасників: кожного
+  робочого потоку і потоку, що викликав run. Учасник бере завдання з початку
+  своєї черги, а коли вона спорожніє - забирає з кінця чужої. Так нерівномірні
+  завдання (фігури з тригонометрією поруч з простими) вирівнюються без
+  централізованої черги.
+
+Потік, що викликав run, не чекає склавши руки - він теж виконує завдання, тож
+ ThreadPool(1) не має жодного робочого потоку і працює строго послідовно, а
+ вкладений run з тіла завдання не блокує пул.
+
+Виняток з тіла завдання перехоплюється; решта завдань доробляється, після чого
+ run повторно кидає перший з винятків.
+*/
+#ifndef _ThreadPoolHeader_
+#define _ThreadPoolHeader_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// threads - кількість учасників разом з потоком, що викликає run;
+	// 0 - за кількістю апаратних потоків
+	explicit ThreadPool(unsigned threads = 0);
+	~ThreadPool();
+	unsigned size() const { return count; }
+
+	// викликає body(i) для кожного i з [0, n) і повертається, коли всі виконані
+	template<class F> void run(size_t n, F&& body)
+	{
+		execute(n, &invoke<typename std::remove_reference<F>::type>, &body);
+	}
+
+	// спільний пул програми; кількість потоків задається до першого звертання
+	static ThreadPool& shared();
+	static void setSharedThreads(unsigned threads);
+private:
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	struct Job;
+	struct Task
+	{
+		Job* job;
+		size_t index;
+	};
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<Task> tasks;
+	};
+
+	template<class F> static void invoke(void* f, size_t i) { (*static_cast<F*>(f))(i); }
+	void execute(size_t n, void (*call)(void*, size_t), void* body);
+	// виконує одне завдання зі своєї черги чи вкрадене; false, якщо завдань немає
+	bool runOne(size_t self);
+	void workerLoop(size_t self);
+	// номер черги поточного потоку в цьому пулі
+	size_t queueOf() const;
+
+	// задається до запуску робочих потоків: вони читають size(), поки workers ще заповнюється
+	unsigned count;
+	std::vector<std::thread> workers;
+	// черга 0 - для потоків, що не належать пулу, 1..size()-1 - робочих потоків
+	std::unique_ptr<Queue[]> queues;
+	std::atomic<size_t> queued;
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	bool stopping;
+};
+
+#endif
@@ -1,57 +1,79 @@
 #include "VolumeShapes.h"
+#include "ShapeWriter.h"
+
+// порядок збігається з ShapeBatch::Kind, тож тег вбудованої фігури і є її видом
+template<> void VolShapeRegistry::builtins(VolShapeRegistry& r)
+{
+	r.enroll<Cylinder>("Cylinder", [](std::istream& in) -> VolShape*
+	{
+		double h, radius; in >> h >> radius; return new Cylinder(h, radius);
+	});
+	r.enroll<Parallelepiped>("Parallelepiped", [](std::istream& in) -> VolShape*
+	{
+		double h, a, b; in >> h >> a >> b; return new Parallelepiped(h, a, b);
+	});
+	r.enroll<TriPrizm>("TriPrizm", [](std::istream& in) -> VolShape*
+	{
+		double h, a, b; int y; in >> h >> a >> b >> y; return new TriPrizm(h, a, b, y);
+	});
+	r.enroll<Conus>("Conus", [](std::istream& in) -> VolShape*
+	{
+		double h, radius; in >> h >> radius; return new Conus(h, radius);
+	});
+	r.enroll<RectPiramid>("RectPiramid", [](std::istream& in) -> VolShape*
+	{
+		double h, a, b; in >> h >> a >> b; return new RectPiramid(h, a, b);
+	});
+	r.enroll<TriPiramid>("TriPiramid", [](std::istream& in) -> VolShape*
+	{
+		double h, a, b; int y; in >> h >> a >> b >> y; return new TriPiramid(h, a, b, y);
+	});
+}
 
 VolShape* VolShape::CopyInstance(VolShape* v)
 {
-	if (typeid(*v) == typeid(Cylinder))      return new Cylinder(*dynamic_cast<Cylinder*>(v));
-	if (typeid(*v) == typeid(Parallelepiped))return new Parallelepiped(*dynamic_cast<Parallelepiped*>(v));
-	if (typeid(*v) == typeid(TriPrizm))      return new TriPrizm(*dynamic_cast<TriPrizm*>(v));
-	if (typeid(*v) == typeid(Conus))         return new Conus(*dynamic_cast<Conus*>(v));
-	if (typeid(*v) == typeid(RectPiramid))   return new RectPiramid(*dynamic_cast<RectPiramid*>(v));
-	if (typeid(*v) == typeid(TriPiramid))    return new TriPiramid(*dynamic_cast<TriPiramid*>(v));
-	return nullptr;
+	// фіктивний вузол у LinkedList::insert/remove створюється з nullptr
+	if (v == nullptr) return nullptr;
+	SHAPES_COUNT(COPY_INSTANCE);
+	SHAPES_TIME(COPY_TIME);
+	return VolShapeRegistry::type(v->typeTag()).copy(*v);
 }
 
 VolShape* VolShape::MakeInstance(std::ifstream& fin)
 {
-	int y; double h, r, a, b;
+	SHAPES_COUNT(RECORDS_PARSED);
+	SHAPES_TIME(PARSE_TIME);
 	string name;
 	fin >> name;
-	if (name == "Cylinder")
-	{
-		fin >> h >> r;
-		return new Cylinder(h,r);
-	}
-	if (name == "Parallelepiped")
-	{
-		fin >> h >> a >> b; return new Parallelepiped(h,a,b);
-	}
-	if (name == "TriPrizm")
-	{
-		fin >> h >> a >> b >> y; return new TriPrizm(h,a,b,y);
-	}
-	if (name == "Conus")
-	{
-		fin >> h >> r; return new Conus(h,r);
-	}
-	if (name == "RectPiramid")
-	{
-		fin >> h >> a >> b; return new RectPiramid(h,a,b);
-	}
-	if (name == "TriPiramid")
-	{
-		fin >> h >> a >> b >> y; return new TriPiramid(h,a,b,y);
-	}
-	throw BadClassname(name.c_str());
+	const VolShapeRegistry::Type* type = VolShapeRegistry::find(name);
+	if (type == nullptr || type->make == nullptr) throw BadClassname(name.c_str());
+	return type->make(fin);
+}
+
+const char* VolShape::getClassName() const
+{
+	return VolShapeRegistry::type(typeTag()).name;
 }
 //-----------------------------------------------------------
 void VolShape::storeOn(ofstream& fout) const
 {
-	const char* line = this->getClassName();
-	for (int i = 6; line[i] != '\0'; ++i) fout << line[i];
-	fout << ' ' << this->h << ' ';
+	fout << this->getClassName() << ' ' << this->h << ' ';
 	this->base->storeOn(fout);
 }
 
+size_t VolShape::hash() const
+{
+	// у перенесеної фігури основи немає
+	return ShapeHash::mix(ShapeHash::mix(typeTag(), ShapeHash::of(h)), base != nullptr ? base->hash() : 0);
+}
+
+bool VolShape::sameAs(const VolShape& v) const
+{
+	if (h != v.h) return false;
+	if (base == nullptr || v.base == nullptr) return base == v.base;
+	return *base == *v.base;
+}
+
 ostream& operator<<(ostream& os, const VolShape& s)
 {
 	s.printOn(os);
@@ -69,13 +91,15 @@ Cylinder& Cylinder::operator=(const Cylinder& c)
 	if (this != &c)
 	{
 		h = c.h;
-		delete base;
-		base = new Circle(*static_cast<Circle*>(c.base));
+		makeBase<Circle>(*static_cast<const Circle*>(c.base));
+		invalidate();
 	}
 	return *this;
 }
 VolShape* Cylinder::Clone() const
 {
+	SHAPES_COUNT(CLONE);
+	SHAPES_TIME(COPY_TIME);
 	return new Cylinder(*this);
 }
 Parallelepiped& Parallelepiped::operator=(const Parallelepiped& p)
@@ -83,19 +107,15 @@ Parallelepiped& Parallelepiped::operator=(const Parallelepiped& p)
 	if (this != &p)
 	{
 		h = p.h;
-		delete base;
-		base = new Rectangle(*dynamic_cast<Rectangle*>(p.base));
+		makeBase<Rectangle>(*static_cast<const Rectangle*>(p.base));
+		invalidate();
 	}
 	return *this;
 }
-bool Parallelepiped::operator == (const Parallelepiped& p) const noexcept
-{
-	if (h == p.h && base->area() == p.base->area() && volume() == p.volume() && base->perim() == p.base->perim()) return true;
-	return false;
-}
-
 VolShape* Parallelepiped::Clone() const
 {
+	SHAPES_COUNT(CLONE);
+	SHAPES_TIME(COPY_TIME);
 	return new Parallelepiped(*this);
 }
 
@@ -104,13 +124,15 @@ TriPrizm& TriPrizm::operator=(const TriPrizm& t)
 	if (this != &t)
 	{
 		h = t.h;
-		delete base;
-		base = new Triangle(*dynamic_cast<Triangle*>(t.base));
+		makeBase<Triangle>(*static_cast<const Triangle*>(t.base));
+		invalidate();
 	}
 	return *this;
 }
 VolShape* TriPrizm::Clone() const
 {
+	SHAPES_COUNT(CLONE);
+	SHAPES_TIME(COPY_TIME);
 	return new TriPrizm(*this);
 }
 //-----------------------------------------------------------
@@ -124,44 +146,128 @@ void PiramidalShape::printOn(ostream& os) const
 
 double Conus::sideArea() const
 {
-/*    = Pi R L,  L - .     H i R.
-   ,    () ==>       
+/* Площа бічної поверхні = Pi R L, де L - твірна. Її можна обчислити через H i R.
+   Однозначно, потрібен радіус основи (круга) ==> потрібно привести абстрактний тип основи до конкретного
 */
-	double r = static_cast<Circle*>(base)->radius();
-	return M_PI*r*sqrt(h*h+r*r);
+	SHAPES_COUNT(SIDE_AREA);
+	return cached(CACHED_SIDE, [this]
+	{
+		double r = static_cast<Circle*>(base)->radius();
+		return M_PI*r*MetricStats::sqrt(h*h+r*r);
+	});
+}
+
+Conus& Conus::operator=(const Conus& c)
+{
+	if (this != &c)
+	{
+		h = c.h;
+		makeBase<Circle>(*static_cast<const Circle*>(c.base));
+		invalidate();
+	}
+	return *this;
 }
 
 VolShape* Conus::Clone() const
 {
+	SHAPES_COUNT(CLONE);
+	SHAPES_TIME(COPY_TIME);
 	return new Conus(*this);
 }
 
 double RectPiramid::sideArea() const
 {
-/*       ,
-      
+/* Щоб обчислити площу бічної поверхні прямокутної піраміди,
+   потрібно знати сторони основ
 */
-	double a = static_cast<RectAB*>(base)->getA();
-	double b = static_cast<RectAB*>(base)->getB();
-	return a*sqrt(h*h+b*b*0.25)+b*sqrt(h*h+a*a*0.25);
+	SHAPES_COUNT(SIDE_AREA);
+	return cached(CACHED_SIDE, [this]
+	{
+		double a = static_cast<RectAB*>(base)->getA();
+		double b = static_cast<RectAB*>(base)->getB();
+		return a*MetricStats::sqrt(h*h+b*b*0.25)+b*MetricStats::sqrt(h*h+a*a*0.25);
+	});
+}
+
+RectPiramid& RectPiramid::operator=(const RectPiramid& p)
+{
+	if (this != &p)
+	{
+		h = p.h;
+		makeBase<RectAB>(*static_cast<const RectAB*>(p.base));
+		invalidate();
+	}
+	return *this;
 }
 
 VolShape* RectPiramid::Clone() const
 {
+	SHAPES_COUNT(CLONE);
+	SHAPES_TIME(COPY_TIME);
 	return new RectPiramid(*this);
 }
 
 double TriPiramid::sideArea() const
 {
-/* ,        ,
-          
+/* Вважається, що вершина піраміди проектується в центр вписаного кола,
+   тому можна обчислити апофему через радіус вписаного кола
 */
-	double r = 2. * base->area() / base->perim();
-	return 0.5 * base->perim() * sqrt(h*h+r*r);
+	SHAPES_COUNT(SIDE_AREA);
+	return cached(CACHED_SIDE, [this]
+	{
+		double r = 2. * base->area() / base->perim();
+		return 0.5 * base->perim() * MetricStats::sqrt(h*h+r*r);
+	});
+}
+
+TriPiramid& TriPiramid::operator=(const TriPiramid& t)
+{
+	if (this != &t)
+	{
+		h = t.h;
+		makeBase<Triangle>(*static_cast<const Triangle*>(t.base));
+		invalidate();
+	}
+	return *this;
 }
 
 VolShape* TriPiramid::Clone() const
 {
+	SHAPES_COUNT(CLONE);
+	SHAPES_TIME(COPY_TIME);
 	return new TriPiramid(*this);
 }
 
+//-----------------------------------------------------------
+
+void LinkedList::printAll() const
+{
+    if (head == nullptr)
+    {
+        std::cout << "List is empty :(\n";
+        return;
+    }
+    {
+        ShapeWriter out(std::cout);
+        for (Node* curr = head; curr != nullptr; curr = curr->next)
+        {
+            out.print(*curr->data);
+            out << " \n";
+        }
+    }
+    std::cout.flush();
+}
+
+void LinkedList::storeOn(ofstream& os)
+{
+    SHAPES_STORED(os);
+    {
+        ShapeWriter out(os);
+        for (Node* curr = head; curr != nullptr; curr = curr->next)
+        {
+            out.store(*curr->data);
+            out << '\n';
+        }
+    }
+    os.flush();
+}
@@ -1,106 +1,223 @@
 /*
-'       -  . 
-  VolShape   䳿:     
-  , ',  . ϳ  - PiramidalShape
-  i DirectShape -      ' 
-   ' :        .  
-        , 
-  .         
-  PiramidalShape:     .
+Об'ємна фігура складається з висоти і основи - плоскої фігури. Базовий
+  VolShape задає протокол взаємодії: обчислення площ основи та бічної
+  поверхні, об'єму, друкування фігури. Підкласи базового - PiramidalShape
+  i DirectShape - визначають способи обчислення площ і об'єму відповідних
+  груп об'ємних фігур: конуса і піраміди та циліндра і прямої призми. А вже
+  їхні підкласи визначають створення відповідних різновидів призм, пірамід
+  тощо. Окрема увага методові обчислення площі бічної поверхні в ієрархії
+  PiramidalShape: кожен з підкласів перевизначає його.
 
- '   -  ""  / Գ
- pRintOn()    '
- ' -      '  ,  
-     '.  storeOn()  
-     ,     
- getClassName()      (   
-  typeid(pointer),     ).
+Друкування об'єкта в потік - відповідальність "проміжних" класів Пряма/Конічна Фігура
+ pRintOn(потік) надає зовнішнє зображення об'єкта
+Зберігання об'Єкта - виведення в потік даних про об'єкт у викляді, зручному для
+ наступного зчитування і створення об'єкта. Метод storeOn(потік) можна визначити
+ вже в абстрактному базовому класі, заховавши попередньо у віртуальному методі
+ typeTag() отримання інфи про клас екземпляра: тег класу в VolShapeRegistry, за
+ яким getClassName() бере стале ім'я класу (див. TypeRegistry).
 
-  ( )      
-   '       
-   
+Статичні методи (методи класу) виконують роботу класу щодо коректного створення
+ екземплярів своїх об'єктів при копіюванні за поліморфним вказівником чи при
+ завантаженні з файла. Обидва звертаються до реєстру: новий клас фігури досить
+ зареєструвати, і CopyInstance та MakeInstance працюватимуть і з ним
+
+Основа шести вбудованих класів лежить у самій фігурі (VolShape::Place), а base
+ вказує туди. Отже фігура - це одне виділення пам'яті замість двох (у комірці
+ ShapeVector - жодного), копіювання не звертається до купи, а основа поруч з
+ висотою в тих самих рядках кешу. Клас, що передає конструкторові VolShape
+ основу, створену new, як і раніше віддає її фігурі у власність.
+
+Фігури можна переносити. Основу в купі перенесений об'єкт забирає собі, не
+ копіюючи її, і від фігури-джерела лишається "порожня" оболонка без основи, яку
+ можна лише знищити або присвоїти їй іншу фігуру; основу в самій фігурі
+ перенесення копіює, і джерело лишається цілим. Переносять фігури контейнери:
+ ShapeVector при зсуві і розширенні масиву, а методи addtoEnd/insert з
+ std::unique_ptr і emplace<T> - при додаванні фігури, створеної в купі або
+ одразу на місці.
 */
 #ifndef _VolumeShapeHeader_
 #define _VolumeShapeHeader_
 
-#include "..\FlatShapes\FlatShapes.h"
+#include "../FlatShapes/FlatShapes.h"
+#include "ShapeObserver.h"
 #include <exception>
+#include <memory>
+#include <new>
 #include <stdexcept>
-// ---------------------   
-class VolShape
+#include <type_traits>
+#include <utility>
+class VolShape;
+typedef TypeRegistry<VolShape> VolShapeRegistry;
+
+// --------------------- абстрактний базовий клас
+// об'єм і бічна поверхня запам'ятовуються в режимі SHAPES_CACHE_METRICS (див. MetricCache)
+class VolShape : protected MetricCache<2>
 {
 protected:
+	enum { CACHED_VOLUME, CACHED_SIDE };
+	// місце для основи будь-якого з вбудованих класів
+	typedef std::aligned_union<0, Circle, Rectangle, Triangle>::type Place;
 	double h;
     Shape* base;
+	Place place;
 	string baseToStr() const { return base->toStr(); }
+	// основа класу B створюється в place; попередня основа знищується
+	template<class B, class... Args> void makeBase(Args&&... args)
+	{
+		static_assert(sizeof(B) <= sizeof(Place) && alignof(B) <= alignof(Place), "base class does not fit VolShape::Place");
+		dropBase();
+		base = ::new(static_cast<void*>(&place)) B(std::forward<Args>(args)...);
+	}
+	void dropBase()
+	{
+		if (inlineBase()) base->~Shape();
+		else delete base;
+		base = nullptr;
+	}
+	// основу копіюють конструктори підкласів, бо лише вони знають її тип; присвоєння за посиланням на базовий клас "розрізало" б фігуру,
+	// тому копіювання і перенесення VolShape доступні тільки підкласам. Основу з place
+	// конструктор перенесення лишає підкласам, а присвоєння переносить через ShapeRegistry
+	VolShape(const VolShape& v) : MetricCache<2>(v), h(v.h), base(nullptr) {}
+	VolShape(VolShape&& v) noexcept : MetricCache<2>(v), h(v.h), base(v.inlineBase() ? nullptr : v.base)
+	{
+		if (base != nullptr) v.base = nullptr;
+	}
+	VolShape& operator=(VolShape&& v) noexcept
+	{
+		if (this != &v)
+		{
+			h = v.h;
+			if (v.inlineBase())
+			{
+				// основа з place лишається у v, а сюди переноситься її тип і значення
+				dropBase();
+				base = ShapeRegistry::type(v.base->typeTag()).move(&place, *v.base);
+			}
+			else if (inlineBase())
+			{
+				dropBase();
+				base = v.base;
+				v.base = nullptr;
+			}
+			else std::swap(base, v.base);
+			MetricCache<2>::operator=(v);
+			v.invalidate();
+		}
+		return *this;
+	}
 public:
-	//    ,       
+	// клас для опису винятка, що сигналізує про неправильне задання імені класу
+	// конструктор exception(const char*) є лише в MSVC, тому повідомлення зберігається тут
 	class BadClassname : public std::exception
 	{
+		string message;
 	public:
-		BadClassname(const char* mess) :exception(mess){};
+		BadClassname(const char* mess) : message(mess) { SHAPES_COUNT(BAD_CLASSNAME); }
+		virtual const char* what() const noexcept override { return message.c_str(); }
 	};
-	//        
+	// методи класу відповідають за копіювання та створення екземплярів
 	static VolShape* CopyInstance(VolShape*);
 	static VolShape* MakeInstance(std::ifstream&);
 	VolShape(double high=1., Shape* s=nullptr) : h(high), base(s) {}
 	virtual ~VolShape() 
     { 
-        delete base; 
+        dropBase(); 
     }
-	virtual double baseArea() const { return base->area(); }
-	virtual double sideArea() const abstract;
-	virtual double surfaceArea() const abstract;
-	virtual double volume() const abstract;
-	//      '
-	virtual void printOn(ostream&) const abstract;
-	//  '    ,   
+	// розміщення в поточному пулі ShapeArena, якщо він є
+	static void* operator new(size_t size) { return ShapeArena::allocate(size); }
+	static void operator delete(void* p) { ShapeArena::deallocate(p); }
+	// параметри фігури для пакетних обчислень (див. ShapeBatch)
+	double high() const { return h; }
+	const Shape* getBase() const { return base; }
+	// основа лежить у самій фігурі, а не окремо в купі
+	bool inlineBase() const { return base == reinterpret_cast<const Shape*>(&place); }
+	// фігура і її основа, якщо та не в place, видані пулом a (nullptr - купою); фігура
+	// має бути створена через operator new. Контейнери перевіряють так, чи можна
+	// забрати фігуру у власність, не копіюючи
+	bool placedIn(const ShapeArena* a) const
+	{
+		return ShapeArena::owner(this) == a && (inlineBase() || base == nullptr || ShapeArena::owner(base) == a);
+	}
+	virtual double baseArea() const
+	{
+		SHAPES_COUNT(BASE_AREA);
+		return base->area();
+	}
+	virtual double sideArea() const = 0;
+	virtual double surfaceArea() const = 0;
+	virtual double volume() const = 0;
+	// виведення в потік зовнішнього вигляду об'єкта
+	virtual void printOn(ostream&) const = 0;
+	// зберігання об'єкта до файла у вигляді, придатному для створення
 	virtual void storeOn(ofstream&) const;
-	// '       
-	virtual const char * getClassName() const { return typeid(*this).name(); }
-    virtual VolShape* Clone() const abstract;
+	// тег класу в VolShapeRegistry; ім'я класу потрібне для методу зберігання до файла
+	virtual int typeTag() const = 0;
+	const char * getClassName() const;
+    virtual VolShape* Clone() const = 0;
+	// рівність і хеш за параметрами - класом, висотою і основою (див. Shape::sameAs);
+	// підклас з власними параметрами доповнює обидва методи. sameAs викликається
+	// лише для фігури того самого класу
+	virtual size_t hash() const;
+	virtual bool sameAs(const VolShape& v) const;
+	bool operator==(const VolShape& v) const { return this == &v || (typeTag() == v.typeTag() && sameAs(v)); }
+	bool operator!=(const VolShape& v) const { return !(*this == v); }
 };
 
 ostream& operator<<(ostream& os, const VolShape& s);
 
-// ---------------------   
-// DirectShape    .   (  ).
-//       '
+// шість вбудованих класів, у порядку ShapeBatch::Kind (VolumeShapes.cpp)
+template<> void VolShapeRegistry::builtins(VolShapeRegistry& r);
+
+// --------------------- ієрархія прямих фігур
+// DirectShape може виконати всю роботу. Навіть надрукувати (в загальному вигляді).
+// В підкласах потрібно тільки правильно сконструювати об'єкти
 
-class DirectShape abstract : public VolShape
+class DirectShape : public VolShape
 {
 public:
 	DirectShape(double high=1., Shape* s=nullptr) : VolShape(high,s) {}
+protected:
+	DirectShape(const DirectShape&) = default;
+	DirectShape(DirectShape&&) = default;
+	DirectShape& operator=(DirectShape&&) = default;
+public:
 	virtual double sideArea() const override
 	{
-		return base->perim() * h;
+		SHAPES_COUNT(SIDE_AREA);
+		return cached(CACHED_SIDE, [this] { return base->perim() * h; });
 	}
 	virtual double surfaceArea() const
 	{
+		SHAPES_COUNT(SURFACE_AREA);
 		return baseArea() * 2 + sideArea();
 	}
 	virtual double volume() const override
 	{
-		return base->area() * h;
+		SHAPES_COUNT(VOLUME);
+		return cached(CACHED_VOLUME, [this] { return base->area() * h; });
 	}
 	virtual void printOn(ostream&) const override;
-	const char * getClassName() const override { return typeid(*this).name(); }
 };
 
-// ϳ    ,   '
+// Підкласи фіксують потрібний тип основи, створюють відповідний об'єкт
 class Cylinder : public DirectShape
 {
 public:
 	Cylinder(double high=1., double radius=1.): DirectShape(high)
 	{
-		base = new Circle(radius);
+		SHAPES_COUNT(CYLINDER_CREATED);
+		makeBase<Circle>(radius);
 	}
 	Cylinder(const Cylinder& c): DirectShape(c)
 	{
-		base = new Circle(*dynamic_cast<Circle*>(c.base));
+		SHAPES_COUNT(CYLINDER_CREATED);
+		makeBase<Circle>(*static_cast<const Circle*>(c.base));
 	}
+	// основа в place лише копіюється
+	Cylinder(Cylinder&& c) noexcept : Cylinder(static_cast<const Cylinder&>(c)) {}
 	Cylinder& operator=(const Cylinder& c);
-	const char * getClassName() const override { return typeid(*this).name(); }
+	Cylinder& operator=(Cylinder&& c) noexcept { return *this = static_cast<const Cylinder&>(c); }
+	int typeTag() const override { return VolShapeRegistry::tagOf<Cylinder>(); }
     virtual VolShape* Clone() const override;
 };
 
@@ -109,15 +226,18 @@ class Parallelepiped : public DirectShape
 public:
     Parallelepiped(double high = 1., double sideA = 1., double sideB = 1.) : DirectShape(high)
     {
-        base = new Rectangle(sideA, sideB);
+        SHAPES_COUNT(PARALLELEPIPED_CREATED);
+        makeBase<Rectangle>(sideA, sideB);
     }
     Parallelepiped(const Parallelepiped& p) : DirectShape(p)
     {
-        base = new Rectangle(*dynamic_cast<Rectangle*>(p.base));
+        SHAPES_COUNT(PARALLELEPIPED_CREATED);
+        makeBase<Rectangle>(*static_cast<const Rectangle*>(p.base));
     }
+    Parallelepiped(Parallelepiped&& p) noexcept : Parallelepiped(static_cast<const Parallelepiped&>(p)) {}
     Parallelepiped& operator=(const Parallelepiped& p);
-    bool operator ==(const Parallelepiped& p) const noexcept;
-	const char * getClassName() const override { return typeid(*this).name(); }
+    Parallelepiped& operator=(Parallelepiped&& p) noexcept { return *this = static_cast<const Parallelepiped&>(p); }
+	int typeTag() const override { return VolShapeRegistry::tagOf<Parallelepiped>(); }
     virtual VolShape* Clone() const override;
 };
 
@@ -126,57 +246,75 @@ class TriPrizm : public DirectShape
 public:
 	TriPrizm(double high=1., double sideA=3., double sideB=4., int angle=90): DirectShape(high)
 	{
-		base = new Triangle(sideA,sideB,angle);
+		SHAPES_COUNT(TRIPRIZM_CREATED);
+		makeBase<Triangle>(sideA,sideB,angle);
 	}
 	TriPrizm(const TriPrizm& t): DirectShape(t)
 	{
-		base = new Triangle(*dynamic_cast<Triangle*>(t.base));
+		SHAPES_COUNT(TRIPRIZM_CREATED);
+		makeBase<Triangle>(*static_cast<const Triangle*>(t.base));
 	}
+	TriPrizm(TriPrizm&& t) noexcept : TriPrizm(static_cast<const TriPrizm&>(t)) {}
 	TriPrizm& operator=(const TriPrizm& t);
-	const char * getClassName() const override { return typeid(*this).name(); }
+	TriPrizm& operator=(TriPrizm&& t) noexcept { return *this = static_cast<const TriPrizm&>(t); }
+	int typeTag() const override { return VolShapeRegistry::tagOf<TriPrizm>(); }
     virtual VolShape* Clone() const override;
 };
 
-// ---------------------   
-// PiramidalShape     ',
-//       ,  -  .
-//     ,       .
-//        -      
+// --------------------- ієрархія конічних фігур
+// PiramidalShape може надрукувати та обчислити об'єм,
+// але бічна поверхня залежить від типу фігури, тому - в підкласах.
+// Як і в прямих фігурах, конструктори підкласів відповідальні за правильне створення основи.
+// Але знищенням основи займається деструктор базового класу - це просто інший спосіб організації роботи
 
 class PiramidalShape : public VolShape
 {
 public:
 	PiramidalShape(double high=1., Shape* s=nullptr) : VolShape(high,s) {}
+protected:
+	PiramidalShape(const PiramidalShape&) = default;
+	PiramidalShape(PiramidalShape&&) = default;
+	PiramidalShape& operator=(PiramidalShape&&) = default;
+public:
 	virtual double surfaceArea() const override
 	{
+		SHAPES_COUNT(SURFACE_AREA);
 		return baseArea() + sideArea();
 	}
 	virtual double volume() const override
 	{
-		return base->area() * h/3.;
+		SHAPES_COUNT(VOLUME);
+		return cached(CACHED_VOLUME, [this] { return base->area() * h/3.; });
 	}
 	virtual void printOn(ostream&) const override;
-	const char * getClassName() const override { return typeid(*this).name(); }
 };
 
 class Conus : public PiramidalShape
 {
 public:
 	Conus(double high=1., double radius=1.)
-		: PiramidalShape(high, new Circle(radius)) {}
+		: PiramidalShape(high)
+	{
+		SHAPES_COUNT(CONUS_CREATED);
+		makeBase<Circle>(radius);
+	}
 	Conus(const Conus& c): PiramidalShape(c)
 	{
-		base = new Circle(*dynamic_cast<Circle*>(c.base));
+		SHAPES_COUNT(CONUS_CREATED);
+		makeBase<Circle>(*static_cast<const Circle*>(c.base));
 	}
+	Conus(Conus&& c) noexcept : Conus(static_cast<const Conus&>(c)) {}
+	Conus& operator=(const Conus& c);
+	Conus& operator=(Conus&& c) noexcept { return *this = static_cast<const Conus&>(c); }
 	virtual double sideArea() const override;
-	const char * getClassName() const override { return typeid(*this).name(); }
+	int typeTag() const override { return VolShapeRegistry::tagOf<Conus>(); }
     virtual VolShape* Clone() const override;
 };
 
-//  Rectangle         -  ,
-//     .   ,   
-// .     ,   
-//  RectPiramid
+// Клас Rectangle не має методів доступу до своїх полів даних - сторін прямокутника,
+// а вони потрібні для обчислень. Тому оголошено підклас, який таку функціональність
+// підтримує. Такий підклас потрібен тільки піраміді, тому оголошення розташовано
+// всередині RectPiramid
 class RectPiramid : public PiramidalShape
 {
 	class RectAB : public Rectangle
@@ -188,13 +326,21 @@ class RectPiramid : public PiramidalShape
 	};
 public:
 	RectPiramid(double high=1., double sideA=1., double sideB=1.)
-		: PiramidalShape(high, new RectAB(sideA,sideB)) {}
+		: PiramidalShape(high)
+	{
+		SHAPES_COUNT(RECTPIRAMID_CREATED);
+		makeBase<RectAB>(sideA,sideB);
+	}
 	RectPiramid(const RectPiramid& p): PiramidalShape(p)
 	{
-		base = new Rectangle(*dynamic_cast<Rectangle*>(p.base));
+		SHAPES_COUNT(RECTPIRAMID_CREATED);
+		makeBase<RectAB>(*static_cast<const RectAB*>(p.base));
 	}
+	RectPiramid(RectPiramid&& p) noexcept : RectPiramid(static_cast<const RectPiramid&>(p)) {}
+	RectPiramid& operator=(const RectPiramid& p);
+	RectPiramid& operator=(RectPiramid&& p) noexcept { return *this = static_cast<const RectPiramid&>(p); }
 	virtual double sideArea() const override;
-	const char * getClassName() const override { return typeid(*this).name(); }
+	int typeTag() const override { return VolShapeRegistry::tagOf<RectPiramid>(); }
     virtual VolShape* Clone() const override;
 };
 
@@ -202,13 +348,21 @@ class TriPiramid : public PiramidalShape
 {
 public:
 	TriPiramid(double high=1., double sideA=3., double sideB=4., int angle=90)
-		: PiramidalShape(high, new Triangle(sideA,sideB,angle)) {}
+		: PiramidalShape(high)
+	{
+		SHAPES_COUNT(TRIPIRAMID_CREATED);
+		makeBase<Triangle>(sideA,sideB,angle);
+	}
 	TriPiramid(const TriPiramid& t): PiramidalShape(t)
 	{
-		base = new Triangle(*dynamic_cast<Triangle*>(t.base));
+		SHAPES_COUNT(TRIPIRAMID_CREATED);
+		makeBase<Triangle>(*static_cast<const Triangle*>(t.base));
 	}
+	TriPiramid(TriPiramid&& t) noexcept : TriPiramid(static_cast<const TriPiramid&>(t)) {}
+	TriPiramid& operator=(const TriPiramid& t);
+	TriPiramid& operator=(TriPiramid&& t) noexcept { return *this = static_cast<const TriPiramid&>(t); }
 	virtual double sideArea() const override;
-	const char * getClassName() const { return typeid(*this).name(); }
+	int typeTag() const override { return VolShapeRegistry::tagOf<TriPiramid>(); }
     virtual VolShape* Clone() const override;
 };
 
@@ -221,22 +375,102 @@ public:
         {
             data = VolShape::CopyInstance(val);
         }
+        // вузол забирає фігуру собі, без копіювання
+        Node(std::unique_ptr<VolShape>&& val, Node* p = nullptr) : data(val.release()), next(p) {}
         ~Node() 
         {
             delete data; 
         }
+        static void* operator new(size_t size) { return ShapeArena::allocate(size); }
+        static void operator delete(void* p) { ShapeArena::deallocate(p); }
     };
+    // HEAP - кожен вузол і фігура окремо в купі; POOLED - у власному ShapeArena
+    // списку, який звільняється одразу весь разом зі списком
+    enum Allocation { HEAP, POOLED };
 private:
     Node* head;
+    ShapeArena* pool;
+    ShapeObservers observers;
+
+    // вузол для фігури, яку передають списку у власність. Пул звільняє пам'ять, не
+    // викликаючи деструкторів, тож список POOLED забирає лише фігуру, що разом з основою
+    // розміщена в його пулі; іншу він копіює в пул, а оригінал знищується
+    Node* adopt(std::unique_ptr<VolShape>& val)
+    {
+        ShapeArena::Scope scope(pool);
+        if (pool == nullptr || val->placedIn(pool))
+            return new Node(std::move(val));
+        return new Node(val.get());
+    }
+    void link(Node* newNode)
+    {
+        if (head == nullptr) 
+        {
+            head = newNode;
+            observers.added(*head->data);
+            return;
+        }
+        Node* curr = head;
+        size_t steps = 0;
+        while (curr->next != nullptr) 
+        {
+            curr = curr->next;
+            ++steps;
+        }
+        SHAPES_TRAVERSED(steps);
+        curr->next = newNode;
+        observers.added(*curr->next->data);
+    }
+    void link(Node* newNode, int index)
+    {
+        Node phantom(nullptr, head);
+        Node* curr = &phantom;
+        for (int i = 0; i < index && curr != nullptr; ++i) 
+        {
+            curr = curr->next;
+        }
+        if (curr == nullptr) 
+        {
+            delete newNode;
+            throw std::out_of_range("Error: Cannot insert at specified position\n");
+        }
+        SHAPES_TRAVERSED(index);
+        
+        newNode->next = curr->next;
+        curr->next = newNode;
+        head = phantom.next;
+        observers.added(*newNode->data);
+    }
 public:
-    LinkedList(): head() {}
+    LinkedList(): head(), pool() {}
+    explicit LinkedList(Allocation mode) : head(), pool(mode == POOLED ? new ShapeArena : nullptr) {}
+
+    const Node* first() const { return head; }
+    // пул списку (nullptr для HEAP); завантажувач може зробити його поточним,
+    // щоб і тимчасові фігури MakeInstance не зверталися до купи
+    ShapeArena* arena() const { return pool; }
+    // спостерігач одразу отримує attached з фігурами, що вже є в списку;
+    // від'єднаний спостерігач отримує cleared
+    void attach(ShapeObserver* o)
+    {
+        observers.attach(o);
+        std::vector<const VolShape*> all;
+        for (Node* curr = head; curr != nullptr; curr = curr->next) all.push_back(curr->data);
+        o->attached(all);
+    }
+    void detach(ShapeObserver* o)
+    {
+        observers.detach(o);
+        o->cleared();
+    }
 
-    LinkedList(VolShape* val, Node* next = nullptr) { head = new Node(val, next); }
+    LinkedList(VolShape* val, Node* next = nullptr) : pool() { head = new Node(val, next); }
 
-    LinkedList(const LinkedList& other) : head(nullptr) {
+    LinkedList(const LinkedList& other) : head(nullptr), pool(other.pool ? new ShapeArena : nullptr) {
         if (other.head == nullptr) {
             return;
         }
+        ShapeArena::Scope scope(pool);
         head = new Node(other.head->data);
         Node* curr = head;
         Node* otherCurr = other.head->next;
@@ -255,16 +489,13 @@ public:
         if (this == &other) {
             return *this;
         }
-        while (head != nullptr) {
-            Node* temp = head;
-            head = head->next;
-            delete temp;
-        }
+        removeAll();
 
         if (other.head == nullptr) 
         {
             return *this;
         }
+        ShapeArena::Scope scope(pool);
         head = new Node(other.head->data);
         Node* curr = head;
         Node* otherCurr = other.head->next;
@@ -274,61 +505,47 @@ public:
             curr = curr->next;
             otherCurr = otherCurr->next;
         }
+        if (!observers.empty())
+        {
+            for (curr = head; curr != nullptr; curr = curr->next) observers.added(*curr->data);
+        }
         return *this;
     }
 
+    // копія фігури додається в кінець; фігура-аргумент залишається власністю того, хто викликав
     void addtoEnd(VolShape* val)
     {
-        if (head == nullptr) 
-        {
-            head = new Node(val);
-            return;
-        }
-        Node* curr = head;
-        while (curr->next != nullptr) 
-        {
-            curr = curr->next;
-        }
-        curr->next = new Node(val);
+        ShapeArena::Scope scope(pool);
+        link(new Node(val));
     }
-
-    void printAll() const
+    // фігура переходить у власність списку:
+    //     list.addtoEnd(std::unique_ptr<VolShape>(VolShape::MakeInstance(fin)));
+    void addtoEnd(std::unique_ptr<VolShape> val)
     {
-
-        Node* curr = head;
-        if (curr == nullptr)
-        {
-            std::cout << "List is empty :(\n";
-        }
-        else
-        {
-            while (curr != nullptr)
-            {
-                
-                std::cout << *curr->data << " ";
-                curr = curr->next;
-                std::cout << std::endl;
-            }
-        }
+        link(adopt(val));
+    }
+    // фігура класу T створюється одразу у списку (в його пулі, якщо він є)
+    template<class T, class... Args> T& emplace(Args&&... args)
+    {
+        ShapeArena::Scope scope(pool);
+        std::unique_ptr<VolShape> made(new T(std::forward<Args>(args)...));
+        T& result = static_cast<T&>(*made);
+        link(new Node(std::move(made)));
+        return result;
     }
+
+    // через ShapeWriter: текст той самий, що дав би std::cout << фігура, але
+    // std::cout скидається один раз, а не після кожної фігури
+    void printAll() const;
     void insert(VolShape* val, int index) 
     {
-        Node* newNode = new Node(val);
-        Node phantom(nullptr, head);
-        Node* curr = &phantom;
-        for (int i = 0; i < index && curr != nullptr; ++i) 
-        {
-            curr = curr->next;
-        }
-        if (curr == nullptr) 
-        {
-            delete newNode;
-            throw std::out_of_range("Error: Cannot insert at specified position\n");
-        }
-        
-        newNode->next = curr->next;
-        curr->next = newNode;
-        head = phantom.next;
+        ShapeArena::Scope scope(pool);
+        link(new Node(val), index);
+    }
+    // якщо позиція неправильна, фігура знищується разом з винятком
+    void insert(std::unique_ptr<VolShape> val, int index)
+    {
+        link(adopt(val), index);
     }
     VolShape& getShape(int index) const
     {
@@ -341,6 +558,7 @@ public:
         {
             throw std::out_of_range("Error: Cannot get element at specified position\n");
         }
+        SHAPES_TRAVERSED(index);
         return *curr->data;
     }
     void remove(int index) {
@@ -358,13 +576,23 @@ public:
         {
             throw std::out_of_range("Error: Cannot get element at specified position\n");
         }
+        SHAPES_TRAVERSED(index);
         Node* temp = curr->next;
+        observers.removed(*temp->data);
         curr->next = curr->next->next;
         delete temp;
         head = phantom.next;
     }
     void removeAll()
     {
+        if (head != nullptr) observers.cleared();
+        if (pool != nullptr)
+        {
+            // фігури і вузли не володіють нічим, крім пам'яті пулу
+            head = nullptr;
+            pool->release();
+            return;
+        }
         while (head != nullptr) 
         {
             Node* temp = head;
@@ -372,16 +600,7 @@ public:
             delete temp;
         }
     }
-    void storeOn(ofstream& os)
-    {
-        Node* curr = head;
-        while (curr != nullptr)
-        {
-            curr->data->storeOn(os);
-            os << std::endl;
-            curr = curr->next;
-        }
-    }   
+    void storeOn(ofstream& os);
     Node* findFirst_if(bool(*p)(VolShape*))
     {
         Node* curr = head;
@@ -393,6 +612,7 @@ public:
             }
             curr = curr->next;
         }
+        return nullptr;
     }
     void ForEach(void (*do_something)(VolShape*)) const
     {
@@ -405,13 +625,11 @@ public:
     }
     ~LinkedList() 
     {
-        while (head != nullptr) 
-        {
-            Node* temp = head;
-            head = head->next;
-            delete temp;
-        }
+        removeAll();
+        delete pool;
     }
 };
+// вузли теж розміщує ShapeArena (фігури перевіряє реєстр)
+static_assert(alignof(LinkedList::Node) <= ShapeArena::ALIGNMENT, "LinkedList::Node alignment exceeds ShapeArena::ALIGNMENT");
 
 #endif
\ No newline at end of file